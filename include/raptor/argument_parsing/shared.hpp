@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <charconv>
+
 #include <raptor/argument_parsing/validators.hpp>
 #include <raptor/shared.hpp>
 
@@ -24,12 +26,46 @@ void init_shared_options(seqan3::argument_parser & parser, arguments_t & argumen
 {
     static_assert(std::same_as<arguments_t, build_arguments> || std::same_as<arguments_t, search_arguments>);
 
-    parser.add_option(arguments.threads,
+    arguments.resources = detect_resources();
+
+    parser.add_option(arguments.threads_string,
                       '\0',
                       "threads",
-                      "The numer of threads to use.",
+                      "The number of threads to use. Use \"auto\" for the number of available CPUs, taking CPU "
+                      "affinity and cgroup quotas into account.",
                       seqan3::option_spec::standard,
-                      positive_integer_validator{});
+                      seqan3::regex_validator{"auto|[0-9]+"});
+    parser.add_flag(arguments.dry_run,
+                    '\0',
+                    "dry-run",
+                    "Do not run, but print the predicted peak memory, disk I/O and run time.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+}
+
+//!\brief Sets `arguments.threads` from the value passed to `--threads`.
+template <typename arguments_t>
+void parse_threads(arguments_t & arguments)
+{
+    if (arguments.threads_string == "auto")
+    {
+        arguments.threads = default_threads(arguments.resources);
+        return;
+    }
+
+    size_t threads{};
+    auto const [end, error] = std::from_chars(arguments.threads_string.data(),
+                                              arguments.threads_string.data() + arguments.threads_string.size(),
+                                              threads);
+
+    if (error != std::errc{} || end != arguments.threads_string.data() + arguments.threads_string.size() ||
+        threads == 0u)
+        throw seqan3::argument_parser_error{"Validation failed for option --threads: The value must be a positive "
+                                            "integer."};
+
+    if (threads > 255u)
+        throw seqan3::argument_parser_error{"Validation failed for option --threads: The value must be at most 255."};
+
+    arguments.threads = threads;
 }
 
 } // namespace raptor
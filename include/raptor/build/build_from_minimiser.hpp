@@ -36,6 +36,7 @@ void build_from_minimiser(build_arguments const & arguments)
         };
 
     call_parallel_on_bins(std::move(worker), arguments);
+    index.compute_fill_rates(arguments.threads);
 
     if constexpr (compressed)
     {
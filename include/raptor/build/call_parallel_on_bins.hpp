@@ -15,6 +15,16 @@
 namespace raptor
 {
 
+//!\brief Calls `worker` in parallel on chunks of `chunk_size` consecutive bins.
+template <typename algorithm_t>
+void call_parallel_on_bins(algorithm_t && worker, build_arguments const & arguments, size_t const chunk_size)
+{
+    auto chunked_view = seqan3::views::zip(arguments.bin_path, std::views::iota(0u)) |
+                        seqan3::views::chunk(chunk_size);
+    seqan3::detail::execution_handler_parallel executioner{arguments.threads};
+    executioner.bulk_execute(std::move(worker), std::move(chunked_view), [](){});
+}
+
 template <typename algorithm_t>
 void call_parallel_on_bins(algorithm_t && worker, build_arguments const & arguments)
 {
@@ -23,10 +33,7 @@ void call_parallel_on_bins(algorithm_t && worker, build_arguments const & argume
                                                  8u,
                                                  64u);
 // LCOV_EXCL_END
-    auto chunked_view = seqan3::views::zip(arguments.bin_path, std::views::iota(0u)) |
-                        seqan3::views::chunk(chunk_size);
-    seqan3::detail::execution_handler_parallel executioner{arguments.threads};
-    executioner.bulk_execute(std::move(worker), std::move(chunked_view), [](){});
+    call_parallel_on_bins(std::forward<algorithm_t>(worker), arguments, chunk_size);
 }
 
 } // namespace raptor
@@ -7,10 +7,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+
 #include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
-#include <seqan3/search/views/minimiser_hash.hpp>
 
 #include <raptor/build/call_parallel_on_bins.hpp>
+#include <raptor/detail/bit_matrix.hpp>
+#include <raptor/detail/for_each_minimiser.hpp>
+#include <raptor/detail/ibf_layout.hpp>
+#include <raptor/detail/streaming_minimiser.hpp>
 
 namespace raptor
 {
@@ -28,10 +35,16 @@ public:
 
     explicit index_factory(build_arguments const & args) : arguments{std::addressof(args)} {}
 
-    template <typename view_t = int>
-    [[nodiscard]] auto operator()(view_t && hash_filter_view = 0) const
+    [[nodiscard]] auto operator()() const
     {
-        auto tmp = construct(std::move(hash_filter_view));
+        return (*this)([] (uint64_t const) { return true; });
+    }
+
+    //!\brief Only inserts the minimisers for which `hash_filter` returns true.
+    template <typename predicate_t>
+    [[nodiscard]] auto operator()(predicate_t && hash_filter) const
+    {
+        auto tmp = construct(hash_filter);
 
         if constexpr (!compressed)
             return tmp;
@@ -42,46 +55,239 @@ public:
 private:
     build_arguments const * const arguments{nullptr};
 
-    template <typename view_t>
-    auto construct(view_t && hash_filter_view) const
+    template <typename predicate_t>
+    auto construct(predicate_t const & hash_filter) const
     {
-        using sequence_file_t = seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>>;
-
         assert(arguments != nullptr);
 
         raptor_index<> index{*arguments};
 
-        auto hash_view = [&] ()
+        if (arguments->strategy == "transpose")
+            construct_transposed(index, hash_filter);
+        else if (arguments->strategy == "rows")
+            construct_row_owned(index, hash_filter);
+        else
+            construct_bin_parallel(index, hash_filter);
+
+        index.compute_fill_rates(arguments->threads);
+
+        return index;
+    }
+
+    detail::streaming_minimiser make_minimiser() const
+    {
+        return detail::streaming_minimiser{arguments->shape,
+                                           arguments->window_size,
+                                           adjust_seed(arguments->shape.count())};
+    }
+
+    //!\brief Each thread inserts the minimisers of a chunk of bins directly into the shared IBF.
+    template <typename predicate_t>
+    void construct_bin_parallel(raptor_index<> & index, predicate_t const & hash_filter) const
+    {
+        auto worker = [&] (auto && zipped_view, auto &&)
         {
-            if constexpr (std::same_as<view_t, int>)
-            {
-                return seqan3::views::minimiser_hash(arguments->shape,
-                                                     seqan3::window_size{arguments->window_size},
-                                                     seqan3::seed{adjust_seed(arguments->shape.count())});
-            }
-            else
+            auto & ibf = index.ibf();
+            detail::streaming_minimiser minimiser = make_minimiser();
+
+            for (auto && [file_names, bin_number] : zipped_view)
             {
-                return seqan3::views::minimiser_hash(arguments->shape,
-                                                     seqan3::window_size{arguments->window_size},
-                                                     seqan3::seed{adjust_seed(arguments->shape.count())})
-                       | hash_filter_view;
+                seqan3::bin_index const bin{bin_number};
+
+                auto insert = [&] (uint64_t const value, uint64_t const)
+                {
+                    if (hash_filter(value))
+                        ibf.emplace(value, bin);
+                };
+
+                for (auto && file_name : file_names)
+                    detail::for_each_minimiser(file_name, minimiser, insert);
             }
         };
 
+        call_parallel_on_bins(worker, *arguments);
+    }
+
+    /*!\brief Each thread fills private bit vectors for 64 bins and transposes them into the interleaved layout.
+     * \details
+     * A chunk of 64 bins corresponds to one word in each row of the IBF. The bins are first filled bin-major, i.e.,
+     * each bin has its own bit vector of `bin_size` bits, without any synchronisation. Afterwards, blocks of 64 rows
+     * are transposed and written to the column of the chunk. Threads never write to the same word.
+     */
+    template <typename predicate_t>
+    void construct_transposed(raptor_index<> & index, predicate_t const & hash_filter) const
+    {
+        detail::ibf_layout const layout{index.ibf()};
+        uint64_t * const data = index.ibf().raw_data().data();
+        size_t const words_per_bin = (layout.bin_size + 63u) / 64u;
+
         auto worker = [&] (auto && zipped_view, auto &&)
         {
-            auto & ibf = index.ibf();
+            detail::streaming_minimiser minimiser = make_minimiser();
+            std::vector<uint64_t> bin_major(64u * words_per_bin, 0u);
+            std::array<uint64_t, 64> block{};
+            size_t column{};
 
             for (auto && [file_names, bin_number] : zipped_view)
+            {
+                column = bin_number / 64u;
+                uint64_t * const bin_bits = bin_major.data() + (bin_number % 64u) * words_per_bin;
+
+                auto insert = [&] (uint64_t const value, uint64_t const)
+                {
+                    if (!hash_filter(value))
+                        return;
+
+                    for (size_t i = 0; i < layout.hash_funs; ++i)
+                    {
+                        size_t const row = layout.row(value, i);
+                        bin_bits[row / 64u] |= 1ULL << (row % 64u);
+                    }
+                };
+
                 for (auto && file_name : file_names)
-                    for (auto && [seq] : sequence_file_t{file_name})
-                        for (auto && value : seq | hash_view())
-                            ibf.emplace(value, seqan3::bin_index{bin_number});
+                    detail::for_each_minimiser(file_name, minimiser, insert);
+            }
+
+            for (size_t row_block = 0; row_block < words_per_bin; ++row_block)
+            {
+                for (size_t bin = 0; bin < 64u; ++bin)
+                    block[bin] = bin_major[bin * words_per_bin + row_block];
+
+                detail::transpose_64x64(block);
+
+                size_t const rows_in_block = std::min<size_t>(64u, layout.bin_size - row_block * 64u);
+                uint64_t * const out = data + row_block * 64u * layout.bin_words + column;
+                for (size_t row = 0; row < rows_in_block; ++row)
+                    out[row * layout.bin_words] = block[row];
+            }
         };
 
-        call_parallel_on_bins(worker, *arguments);
+        call_parallel_on_bins(worker, *arguments, 64u);
+    }
 
-        return index;
+    /*!\brief Each thread owns a contiguous range of IBF rows and is the only one setting bits in it.
+     * \details
+     * Threads take single bins from a shared counter. Bits in rows owned by other threads are sent to the owner's
+     * queue in batches. Each thread regularly drains its own queue. This avoids contention on shared words when there
+     * are many small bins.
+     * A queue holds at most `max_queue_size` + `batch_size` bits. A thread sending to a full queue drains its own queue
+     * until there is space again. Hence, two threads waiting for each other's queue both make progress.
+     */
+    template <typename predicate_t>
+    void construct_row_owned(raptor_index<> & index, predicate_t const & hash_filter) const
+    {
+        struct queue_t
+        {
+            std::mutex mutex{};
+            std::vector<uint64_t> bits{};
+        };
+
+        static constexpr size_t batch_size{4096u};
+        static constexpr size_t max_queue_size{16u * batch_size};
+        size_t const thread_count{arguments->threads};
+        detail::ibf_layout const layout{index.ibf()};
+        uint64_t * const data = index.ibf().raw_data().data();
+        size_t const rows_per_thread = (layout.bin_size + thread_count - 1u) / thread_count;
+
+        std::vector<queue_t> queues(thread_count);
+        std::atomic<size_t> next_bin{0u};
+        std::atomic<size_t> finished_threads{0u};
+
+        // A bit is identified by its position within the IBF's bit vector.
+        auto set_bits = [data] (std::vector<uint64_t> const & bits)
+        {
+            for (uint64_t const bit : bits)
+                data[bit / 64u] |= 1ULL << (bit % 64u);
+        };
+
+        auto worker = [&] (size_t const thread_id)
+        {
+            detail::streaming_minimiser minimiser = make_minimiser();
+            std::vector<std::vector<uint64_t>> outgoing(thread_count);
+            std::vector<uint64_t> incoming{};
+
+            auto drain = [&] ()
+            {
+                {
+                    std::lock_guard<std::mutex> lock{queues[thread_id].mutex};
+                    std::swap(incoming, queues[thread_id].bits);
+                }
+                set_bits(incoming);
+                incoming.clear();
+            };
+
+            auto send = [&] (size_t const owner)
+            {
+                while (true)
+                {
+                    {
+                        std::lock_guard<std::mutex> lock{queues[owner].mutex};
+                        auto & target = queues[owner].bits;
+                        if (target.size() < max_queue_size)
+                        {
+                            target.insert(target.end(), outgoing[owner].begin(), outgoing[owner].end());
+                            outgoing[owner].clear();
+                            return;
+                        }
+                    }
+                    drain();
+                    std::this_thread::yield();
+                }
+            };
+
+            for (size_t bin = next_bin++; bin < arguments->bins; bin = next_bin++)
+            {
+                auto insert = [&] (uint64_t const value, uint64_t const)
+                {
+                    if (!hash_filter(value))
+                        return;
+
+                    for (size_t i = 0; i < layout.hash_funs; ++i)
+                    {
+                        size_t const row = layout.row(value, i);
+                        uint64_t const bit = row * layout.technical_bins + bin;
+                        size_t const owner = row / rows_per_thread;
+
+                        if (owner == thread_id)
+                        {
+                            data[bit / 64u] |= 1ULL << (bit % 64u);
+                        }
+                        else
+                        {
+                            outgoing[owner].push_back(bit);
+                            if (outgoing[owner].size() >= batch_size)
+                                send(owner);
+                        }
+                    }
+                };
+
+                for (auto && file_name : arguments->bin_path[bin])
+                    detail::for_each_minimiser(file_name, minimiser, insert);
+
+                drain();
+            }
+
+            for (size_t owner = 0; owner < thread_count; ++owner)
+                if (!outgoing[owner].empty())
+                    send(owner);
+
+            // Once all threads have sent their bits, a last drain empties the queue.
+            ++finished_threads;
+            while (finished_threads.load() < thread_count)
+            {
+                drain();
+                std::this_thread::yield();
+            }
+            drain();
+        };
+
+        std::vector<std::thread> threads{};
+        for (size_t thread_id = 0; thread_id < thread_count; ++thread_id)
+            threads.emplace_back(worker, thread_id);
+
+        for (auto && thread : threads)
+            thread.join();
     }
 };
 
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <future>
+
 #include <raptor/build/index_factory.hpp>
 #include <raptor/build/store_index.hpp>
 
@@ -16,15 +18,26 @@ namespace raptor
 template <bool compressed>
 void run_program(build_arguments const & arguments)
 {
-    index_factory<compressed> generator{arguments};
-
     if (arguments.parts == 1u)
     {
+        index_factory<compressed> generator{arguments};
         auto index = generator();
         store_index(arguments.out_path, index, arguments);
     }
     else
     {
+        // A part is written while the next part is built, hence the threads are split between writing and building.
+        // With a single thread, parts are written synchronously.
+        bool const asynchronous_write{arguments.threads > 1u};
+        build_arguments build_part_arguments{arguments};
+        build_arguments write_part_arguments{arguments};
+        if (asynchronous_write)
+        {
+            write_part_arguments.threads = arguments.threads / 2u;
+            build_part_arguments.threads = arguments.threads - write_part_arguments.threads;
+        }
+
+        index_factory<compressed> generator{build_part_arguments};
         std::vector<std::vector<size_t>> association(arguments.parts);
         size_t next_power_of_four{4u};
 
@@ -51,17 +64,37 @@ void run_program(build_arguments const & arguments)
                 association[i/prefixes_per_part].push_back(i);
         }
 
+        // At most two parts are in memory: The one being written and the one being built.
+        std::future<void> pending_write{};
+
         for (size_t part : std::views::iota(0u, arguments.parts))
         {
             size_t const mask{next_power_of_four - 1};
-            auto filter_view = std::views::filter([&] (auto && hash)
-                { return std::ranges::find(association[part], hash & mask) != association[part].end(); });
+            auto filter = [&] (uint64_t const hash)
+                { return std::ranges::find(association[part], hash & mask) != association[part].end(); };
 
-            auto index = generator(std::move(filter_view));
+            auto index = generator(filter);
             std::filesystem::path out_path{arguments.out_path};
             out_path += "_" + std::to_string(part);
-            store_index(out_path, index, arguments);
+
+            if (pending_write.valid())
+                pending_write.get();
+
+            if (!asynchronous_write)
+            {
+                store_index(out_path, index, write_part_arguments);
+                continue;
+            }
+
+            pending_write = std::async(std::launch::async,
+                                       [&write_part_arguments, out_path, index = std::move(index)] ()
+            {
+                store_index(out_path, index, write_part_arguments);
+            });
         }
+
+        if (pending_write.valid())
+            pending_write.get();
     }
 }
 
@@ -9,20 +9,86 @@
 
 #include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
 
+#include <raptor/detail/block_compression.hpp>
+#include <raptor/detail/parallel_ostreambuf.hpp>
+#include <raptor/detail/version_store.hpp>
 #include <raptor/index.hpp>
 #include <raptor/shared.hpp>
 
 namespace raptor
 {
 
+namespace detail
+{
+
+template <typename arguments_t>
+inline index_ostream open_index_ostream(std::filesystem::path const & path, arguments_t const & arguments)
+{
+    if constexpr (std::same_as<arguments_t, build_arguments>)
+        return index_ostream{path, arguments.block_compress, arguments.threads};
+    else
+        return index_ostream{path, false};
+}
+
+/*!\brief Writes `index` to `path`; as a version of a version_store if `--versioned` was passed to `raptor build`.
+ * \details Uncompressed indices that are neither versioned nor block-compressed are written with `--threads` threads.
+ */
+template <seqan3::data_layout layout, typename arguments_t>
+inline void write_index(std::filesystem::path const & path,
+                        raptor_index<layout> const & index,
+                        arguments_t const & arguments)
+{
+    if constexpr (std::same_as<arguments_t, build_arguments> && layout == seqan3::data_layout::uncompressed)
+    {
+        if (arguments.versioned)
+        {
+            versioned_ostreambuf buffer{path,
+                                        index.ibf().raw_data().data(),
+                                        index.ibf().bin_size(),
+                                        (index.ibf().bin_count() + 63u) >> 6,
+                                        arguments.threads};
+            {
+                std::ostream os{&buffer};
+                cereal::BinaryOutputArchive oarchive{os};
+                oarchive(index);
+            }
+            buffer.close();
+            return;
+        }
+
+        if (!arguments.block_compress && arguments.threads > 1u)
+        {
+            auto const & payload = index.ibf().raw_data();
+            parallel_ostreambuf buffer{path,
+                                       reinterpret_cast<char const *>(payload.data()),
+                                       ((payload.size() + 63u) >> 6) * sizeof(uint64_t),
+                                       arguments.threads};
+            {
+                std::ostream os{&buffer};
+                cereal::BinaryOutputArchive oarchive{os};
+                oarchive(index);
+            }
+            buffer.close();
+            return;
+        }
+    }
+
+    index_ostream os = open_index_ostream(path, arguments);
+    {
+        cereal::BinaryOutputArchive oarchive{os};
+        oarchive(index);
+    }
+    os.close();
+}
+
+} // namespace detail
+
 template <seqan3::data_layout layout, typename arguments_t>
 static inline void store_index(std::filesystem::path const & path,
                                raptor_index<layout> const & index,
                                arguments_t const & arguments)
 {
-    std::ofstream os{path, std::ios::binary};
-    cereal::BinaryOutputArchive oarchive{os};
-    oarchive(index);
+    detail::write_index(path, index, arguments);
 }
 
 template <seqan3::data_layout layout, typename arguments_t>
@@ -36,10 +102,9 @@ static inline void store_index(std::filesystem::path const & path,
                                arguments.compressed,
                                arguments.bin_path,
                                std::move(ibf)};
+    index.compute_fill_rates();
 
-    std::ofstream os{path, std::ios::binary};
-    cereal::BinaryOutputArchive oarchive{os};
-    oarchive(index);
+    detail::write_index(path, index, arguments);
 }
 
 } // namespace raptor
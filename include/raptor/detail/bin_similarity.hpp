@@ -0,0 +1,154 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <vector>
+
+#include <raptor/detail/bit_matrix.hpp>
+#include <raptor/detail/parallel_for.hpp>
+#include <raptor/index.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Estimates the pairwise similarity of the bins of an index from a sample of its rows.
+ * \details
+ * Each part of the index contributes `words_per_part` words of samples per bin, see sample(). For partitioned
+ * indices, the parts store different k-mers of the same bins, hence their samples are concatenated.
+ */
+class bin_similarity
+{
+public:
+    bin_similarity() = delete;
+    bin_similarity(bin_similarity const &) = default;
+    bin_similarity(bin_similarity &&) = default;
+    bin_similarity & operator=(bin_similarity const &) = default;
+    bin_similarity & operator=(bin_similarity &&) = default;
+    ~bin_similarity() = default;
+
+    /*!\brief Prepares sampling `sample_rows` rows of each of `parts` parts.
+     * \param index Any part of the index. Determines the number of bins and rows.
+     */
+    bin_similarity(raptor_index<> const & index, size_t const sample_rows, size_t const parts, size_t const threads) :
+        bin_count{index.ibf().bin_count()},
+        sample_rows{std::min<size_t>(sample_rows, index.ibf().bin_size())},
+        words_per_part{(this->sample_rows + 63u) / 64u},
+        sample_words{words_per_part * parts},
+        threads{std::max<size_t>(1u, threads)},
+        columns(bin_count * sample_words, 0u)
+    {}
+
+    /*!\brief Samples `sample_rows` evenly spaced rows of `part` and stores them as one bitvector per bin.
+     * \details
+     * The sampled rows are processed in blocks of 64. Each word of a block is transposed, such that bit `i` of
+     * `columns[bin * sample_words + first_word + block]` is set if `bin` has a set bit in the `i`-th sampled row of
+     * the block.
+     */
+    void sample(raptor_index<> const & index, size_t const part)
+    {
+        auto const & ibf = index.ibf();
+        size_t const bin_size{ibf.bin_size()};
+        size_t const bin_words{(bin_count + 63u) >> 6};
+        size_t const first_word{part * words_per_part};
+        uint64_t const * const data = ibf.raw_data().data();
+
+        parallel_for(words_per_part, threads, [&] (size_t const block)
+        {
+            std::array<uint64_t, 64> matrix{};
+            size_t const first_sample = block * 64u;
+            size_t const samples = std::min<size_t>(64u, sample_rows - first_sample);
+
+            for (size_t word = 0; word < bin_words; ++word)
+            {
+                matrix.fill(0u);
+                for (size_t sample = 0; sample < samples; ++sample)
+                {
+                    size_t const row = (first_sample + sample) * bin_size / sample_rows;
+                    matrix[sample] = data[row * bin_words + word];
+                }
+
+                transpose_64x64(matrix);
+
+                for (size_t column = 0; column < 64u && word * 64u + column < bin_count; ++column)
+                    columns[(word * 64u + column) * sample_words + first_word + block] = matrix[column];
+            }
+        });
+    }
+
+    /*!\brief The similarity of all pairs of bins. Entry `lhs * bin_count + rhs` is the similarity of `lhs` and `rhs`.
+     * \param containment If set, the fraction of the sampled bits of `lhs` that are also set in `rhs`. Otherwise, the
+     *                    Jaccard index of the sampled bits.
+     */
+    std::vector<double> matrix(bool const containment) const
+    {
+        std::vector<uint64_t> set_bits(bin_count);
+        for (size_t bin = 0; bin < bin_count; ++bin)
+            for (size_t word = 0; word < sample_words; ++word)
+                set_bits[bin] += std::popcount(columns[bin * sample_words + word]);
+
+        std::vector<double> similarity(bin_count * bin_count, 0.0);
+
+        parallel_for(bin_count, threads, [&] (size_t const lhs)
+        {
+            uint64_t const * const lhs_column = columns.data() + lhs * sample_words;
+
+            for (size_t rhs = 0; rhs < bin_count; ++rhs)
+            {
+                uint64_t const * const rhs_column = columns.data() + rhs * sample_words;
+                uint64_t shared{};
+                for (size_t word = 0; word < sample_words; ++word)
+                    shared += std::popcount(lhs_column[word] & rhs_column[word]);
+
+                uint64_t const total = containment ? set_bits[lhs] : set_bits[lhs] + set_bits[rhs] - shared;
+                similarity[lhs * bin_count + rhs] = total ? static_cast<double>(shared) / total : 0.0;
+            }
+        });
+
+        return similarity;
+    }
+
+    /*!\brief Orders the bins such that similar bins are adjacent.
+     * \details Starting with bin 0, the most similar bin that has not been placed yet is appended to the order.
+     */
+    static std::vector<size_t> greedy_order(std::vector<double> const & similarity, size_t const bin_count)
+    {
+        std::vector<size_t> order{0u};
+        std::vector<bool> placed(bin_count, false);
+        order.reserve(bin_count);
+        placed[0] = true;
+
+        while (order.size() < bin_count)
+        {
+            size_t const last = order.back();
+            size_t best{bin_count};
+
+            for (size_t bin = 0; bin < bin_count; ++bin)
+                if (!placed[bin] && (best == bin_count || similarity[last * bin_count + bin] >
+                                                          similarity[last * bin_count + best]))
+                    best = bin;
+
+            order.push_back(best);
+            placed[best] = true;
+        }
+
+        return order;
+    }
+
+private:
+    size_t bin_count{};
+    size_t sample_rows{};
+    size_t words_per_part{};
+    size_t sample_words{};
+    size_t threads{1u};
+    std::vector<uint64_t> columns{};
+};
+
+} // namespace raptor::detail
@@ -0,0 +1,37 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace raptor::detail
+{
+
+/*!\brief Transposes a 64x64 bit matrix in place.
+ * \details
+ * Bit `j` of `matrix[i]` is the entry in row `i` and column `j`. Afterwards, bit `i` of `matrix[j]` holds this entry.
+ * The matrix is transposed by recursively swapping off-diagonal blocks of size 32, 16, ..., 1 (Hacker's Delight,
+ * 7-3). Each step only uses shifts and XORs on whole words, such that the compiler can vectorise the inner loop.
+ */
+inline void transpose_64x64(std::array<uint64_t, 64> & matrix) noexcept
+{
+    uint64_t mask{0x00000000FFFFFFFFULL};
+
+    for (size_t width = 32u; width != 0u; width >>= 1, mask ^= mask << width)
+    {
+        for (size_t row = 0u; row < 64u; row = ((row | width) + 1u) & ~width)
+        {
+            uint64_t const swap = ((matrix[row] >> width) ^ matrix[row | width]) & mask;
+            matrix[row] ^= swap << width;
+            matrix[row | width] ^= swap;
+        }
+    }
+}
+
+} // namespace raptor::detail
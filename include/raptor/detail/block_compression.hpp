@@ -0,0 +1,132 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <future>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+namespace raptor::detail
+{
+
+/*!\brief Writes data as independently compressed blocks.
+ * \details
+ * The data is buffered until `threads` blocks are complete. These blocks are compressed in parallel and written to
+ * the underlying stream buffer. The last, possibly incomplete, block is written by close().
+ *
+ * The container starts with a magic string, the format version, and the block size. Each block consists of its
+ * compressed size, its uncompressed size, and the compressed data. A block with sizes 0 marks the end.
+ */
+class block_compressed_ostreambuf : public std::streambuf
+{
+public:
+    static constexpr size_t default_block_size{1ULL << 24};
+
+    block_compressed_ostreambuf() = delete;
+    block_compressed_ostreambuf(block_compressed_ostreambuf const &) = delete;
+    block_compressed_ostreambuf(block_compressed_ostreambuf &&) = delete;
+    block_compressed_ostreambuf & operator=(block_compressed_ostreambuf const &) = delete;
+    block_compressed_ostreambuf & operator=(block_compressed_ostreambuf &&) = delete;
+    ~block_compressed_ostreambuf() override;
+
+    block_compressed_ostreambuf(std::streambuf * sink, size_t const threads, size_t const block_size = default_block_size);
+
+    /*!\brief Writes the remaining data and the end marker. Throws if a write fails.
+     * \details Called by the destructor, which cannot report errors. Call close() explicitly to detect them.
+     */
+    void close();
+
+protected:
+    int_type overflow(int_type character) override;
+
+private:
+    std::streambuf * sink{nullptr};
+    size_t threads{1u};
+    size_t block_size{default_block_size};
+    bool closed{false};
+    std::vector<char> buffer{};
+
+    void write_blocks(size_t const size);
+};
+
+/*!\brief Reads data written by block_compressed_ostreambuf.
+ * \details
+ * Up to `threads` blocks are decompressed in parallel. While the data of these blocks is consumed, the next blocks
+ * are already read and decompressed in the background.
+ */
+class block_compressed_istreambuf : public std::streambuf
+{
+public:
+    block_compressed_istreambuf() = delete;
+    block_compressed_istreambuf(block_compressed_istreambuf const &) = delete;
+    block_compressed_istreambuf(block_compressed_istreambuf &&) = delete;
+    block_compressed_istreambuf & operator=(block_compressed_istreambuf const &) = delete;
+    block_compressed_istreambuf & operator=(block_compressed_istreambuf &&) = delete;
+    ~block_compressed_istreambuf() override;
+
+    block_compressed_istreambuf(std::streambuf * source, size_t const threads);
+
+protected:
+    int_type underflow() override;
+
+private:
+    std::streambuf * source{nullptr};
+    size_t threads{1u};
+    size_t block_size{};
+    bool finished{false};
+    std::vector<char> current{};
+    std::vector<char> next{};
+    std::future<size_t> pending{};
+
+    size_t read_blocks(std::vector<char> & output);
+};
+
+//!\brief Whether the stream starts with the magic string of a block-compressed container. Does not consume input.
+bool is_block_compressed(std::istream & stream);
+
+/*!\brief The size in bytes of the serialised index in the file, i.e., the size after decompression for
+ *        block-compressed files and versions. This is approximately the memory needed to load the index.
+ */
+uint64_t index_size(std::filesystem::path const & path);
+
+/*!\brief An input file stream that transparently decompresses block-compressed index files and assembles index
+ *        versions (see version_store).
+ */
+class index_istream : public std::istream
+{
+public:
+    explicit index_istream(std::filesystem::path const & path, size_t const threads = 1u);
+
+private:
+    std::ifstream file{};
+    std::unique_ptr<std::streambuf> decompressor{};
+};
+
+/*!\brief An output file stream that optionally writes a block-compressed container.
+ * \details Write errors are only detected reliably by close(), which must be called after the index is written.
+ */
+class index_ostream : public std::ostream
+{
+public:
+    index_ostream(std::filesystem::path const & path, bool const compress, size_t const threads = 1u);
+
+    //!\brief Writes all remaining data and closes the file. Throws if any write failed.
+    void close();
+
+private:
+    std::filesystem::path path{};
+    std::ofstream file{};
+    std::unique_ptr<block_compressed_ostreambuf> compressor{};
+};
+
+} // namespace raptor::detail
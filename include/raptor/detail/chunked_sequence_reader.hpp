@@ -0,0 +1,286 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <seqan3/std/algorithm>
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <seqan3/io/detail/misc_input.hpp>
+#include <seqan3/io/exception.hpp>
+#include <seqan3/io/sequence_file/format_fasta.hpp>
+#include <seqan3/io/sequence_file/format_fastq.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Reads FASTA and FASTQ files in chunks of fixed size without materialising whole records.
+ * \details
+ * The file is read in chunks of `chunk_size` bytes. (Compressed files are decompressed on the fly.)
+ * For each record, `on_record_begin` is called with the ID, `on_bases` is called with consecutive parts of the
+ * sequence (line breaks removed), and `on_record_end` is called after the last part of the sequence.
+ * Hence, the memory consumption does not depend on the length of the records.
+ *
+ * Like seqan3, whitespace within the sequence, and digits within FASTA sequences, are skipped. Other characters that
+ * are not IUPAC nucleotide codes cause a seqan3::parse_error.
+ */
+class chunked_sequence_reader
+{
+public:
+    chunked_sequence_reader() = default;
+    chunked_sequence_reader(chunked_sequence_reader const &) = default;
+    chunked_sequence_reader(chunked_sequence_reader &&) = default;
+    chunked_sequence_reader & operator=(chunked_sequence_reader const &) = default;
+    chunked_sequence_reader & operator=(chunked_sequence_reader &&) = default;
+    ~chunked_sequence_reader() = default;
+
+    static constexpr size_t default_chunk_size{1ULL << 20};
+
+    explicit chunked_sequence_reader(std::filesystem::path file_path, size_t const chunk_size = default_chunk_size) :
+        file_path{std::move(file_path)},
+        buffer(chunk_size)
+    {}
+
+    //!\brief Whether the file is a (possibly compressed) FASTA or FASTQ file.
+    static bool is_supported(std::filesystem::path file_path)
+    {
+        static constexpr std::array<std::string_view, 3> compression_extensions{".gz", ".bgzf", ".bz2"};
+        if (std::ranges::find(compression_extensions, file_path.extension().string()) != compression_extensions.end())
+            file_path = file_path.stem();
+
+        std::string extension = file_path.extension().string();
+        if (extension.empty())
+            return false;
+        extension = extension.substr(1);
+
+        auto matches = [&extension] (auto const & valid_extensions)
+        {
+            return std::ranges::find(valid_extensions, extension) != valid_extensions.end();
+        };
+
+        return matches(seqan3::format_fasta::file_extensions) || matches(seqan3::format_fastq::file_extensions);
+    }
+
+    template <typename on_record_begin_t, typename on_bases_t, typename on_record_end_t>
+    void read(on_record_begin_t && on_record_begin, on_bases_t && on_bases, on_record_end_t && on_record_end)
+    {
+        std::ifstream primary_stream{file_path, std::ios::binary};
+        if (!primary_stream.good())
+            throw seqan3::file_open_error{"Could not open file " + file_path.string() + " for reading."};
+
+        std::filesystem::path tmp_path{file_path};
+        auto stream = seqan3::detail::make_secondary_istream(primary_stream, tmp_path);
+
+        state current{state::record_start};
+        bool is_fastq{false};
+        size_t sequence_length{};
+        size_t quality_length{};
+        std::string id{};
+
+        // Passes the bases in `[begin, end)` to `on_bases`, skipping whitespace and, for FASTA, digits.
+        auto emit_bases = [&] (char const * begin, char const * const end)
+        {
+            size_t count{};
+
+            for (char const * it = begin; it != end; ++it)
+            {
+                character_class const type = character_classes[static_cast<uint8_t>(*it)];
+
+                if (type == character_class::base)
+                    continue;
+
+                if (type == character_class::invalid || (type == character_class::digit && is_fastq))
+                    throw seqan3::parse_error{"Encountered an unexpected letter in the sequence of " +
+                                              file_path.string() + ": '" + *it + "'."};
+
+                if (it != begin)
+                    on_bases(std::string_view{begin, static_cast<size_t>(it - begin)});
+                count += it - begin;
+                begin = it + 1;
+            }
+
+            if (end != begin)
+                on_bases(std::string_view{begin, static_cast<size_t>(end - begin)});
+            return count + (end - begin);
+        };
+
+        while (*stream)
+        {
+            stream->read(buffer.data(), buffer.size());
+            size_t const size = stream->gcount();
+            char const * const buffer_end = buffer.data() + size;
+            char const * it = buffer.data();
+
+            while (it != buffer_end)
+            {
+                char const * const line_end = static_cast<char const *>(std::memchr(it, '\n', buffer_end - it));
+                char const * const end = line_end ? line_end : buffer_end;
+
+                switch (current)
+                {
+                    case state::record_start:
+                    {
+                        if (*it == '>' || *it == '@')
+                        {
+                            is_fastq = *it == '@';
+                            id.clear();
+                            current = state::header;
+                        }
+                        else if (!std::isspace(static_cast<unsigned char>(*it)))
+                        {
+                            throw seqan3::parse_error{"Expected '>' or '@' at the beginning of a record in " +
+                                                      file_path.string() + '.'};
+                        }
+                        ++it;
+                        continue;
+                    }
+                    case state::header:
+                    {
+                        id.append(it, end);
+                        if (line_end)
+                        {
+                            if (!id.empty() && id.back() == '\r')
+                                id.pop_back();
+                            on_record_begin(std::string_view{id});
+                            sequence_length = 0u;
+                            current = state::line_start;
+                        }
+                        break;
+                    }
+                    case state::line_start:
+                    {
+                        if (!is_fastq && *it == '>')
+                        {
+                            on_record_end();
+                            id.clear();
+                            current = state::header;
+                            ++it;
+                        }
+                        else if (is_fastq && *it == '+')
+                        {
+                            current = state::plus_line;
+                            ++it;
+                        }
+                        else
+                        {
+                            current = state::sequence;
+                        }
+                        continue;
+                    }
+                    case state::sequence:
+                    {
+                        sequence_length += emit_bases(it, end);
+                        if (line_end)
+                            current = state::line_start;
+                        break;
+                    }
+                    case state::plus_line:
+                    {
+                        if (line_end)
+                        {
+                            quality_length = 0u;
+                            current = state::quality;
+                        }
+                        break;
+                    }
+                    case state::quality:
+                    {
+                        quality_length += end - it;
+                        if (line_end)
+                        {
+                            if (end != it && *(end - 1) == '\r')
+                                --quality_length;
+                            if (quality_length >= sequence_length)
+                            {
+                                on_record_end();
+                                current = state::record_start;
+                            }
+                        }
+                        break;
+                    }
+                }
+
+                it = line_end ? line_end + 1 : buffer_end;
+            }
+        }
+
+        switch (current)
+        {
+            case state::header: // A record without sequence and line break.
+                on_record_begin(std::string_view{id});
+                on_record_end();
+                break;
+            case state::line_start:
+            case state::sequence:
+                if (!is_fastq)
+                {
+                    on_record_end();
+                    break;
+                }
+                throw seqan3::parse_error{"Unexpected end of file in " + file_path.string() + '.'};
+            case state::quality:
+                if (quality_length >= sequence_length)
+                {
+                    on_record_end();
+                    break;
+                }
+                [[fallthrough]];
+            case state::plus_line:
+                throw seqan3::parse_error{"Unexpected end of file in " + file_path.string() + '.'};
+            case state::record_start:
+                break;
+        }
+    }
+
+private:
+    enum class character_class : uint8_t
+    {
+        base,
+        space,
+        digit,
+        invalid
+    };
+
+    //!\brief Classifies the characters of a sequence line. Bases are the IUPAC nucleotide codes in both cases.
+    static constexpr std::array<character_class, 256> character_classes = [] ()
+    {
+        std::array<character_class, 256> table{};
+        table.fill(character_class::invalid);
+        for (char const c : std::string_view{"ACGTUNRYSWKMBDHV"})
+        {
+            table[static_cast<uint8_t>(c)] = character_class::base;
+            table[static_cast<uint8_t>(c - 'A' + 'a')] = character_class::base;
+        }
+        for (char const c : std::string_view{" \t\r\v\f"})
+            table[static_cast<uint8_t>(c)] = character_class::space;
+        for (char c = '0'; c <= '9'; ++c)
+            table[static_cast<uint8_t>(c)] = character_class::digit;
+        return table;
+    }();
+
+    enum class state
+    {
+        record_start,
+        header,
+        line_start,
+        sequence,
+        plus_line,
+        quality
+    };
+
+    std::filesystem::path file_path{};
+    std::vector<char> buffer{};
+};
+
+} // namespace raptor::detail
@@ -0,0 +1,59 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <seqan3/std/filesystem>
+#include <string_view>
+
+#include <seqan3/io/sequence_file/input.hpp>
+
+#include <raptor/detail/chunked_sequence_reader.hpp>
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/shared.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Calls `callback(value, kmer_begin)` for each minimiser of each record in `file_name`.
+ * \details
+ * FASTA and FASTQ files are hashed while being read in chunks of `chunk_size` bytes, hence the memory consumption does
+ * not depend on the length of the records, e.g., whole chromosomes. Other formats are read via seqan3. Ambiguous
+ * bases break the k-mers.
+ */
+template <typename callback_t>
+void for_each_minimiser(std::filesystem::path const & file_name,
+                        streaming_minimiser & minimiser,
+                        callback_t && callback,
+                        size_t const chunk_size = chunked_sequence_reader::default_chunk_size)
+{
+    using sequence_file_t = seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::seq>>;
+
+    if (chunked_sequence_reader::is_supported(file_name))
+    {
+        chunked_sequence_reader reader{file_name, chunk_size};
+        reader.read([&] (std::string_view) { minimiser.reset(); },
+                    [&] (std::string_view bases)
+                    {
+                        for (char const base : bases)
+                            minimiser.push(nucleotide_rank_table[static_cast<uint8_t>(base)], callback);
+                    },
+                    [&] () { minimiser.finish(callback); });
+    }
+    else
+    {
+        for (auto && [seq] : sequence_file_t{file_name})
+        {
+            minimiser.reset();
+            for (auto const base : seq)
+                minimiser.push(nucleotide_rank_table[static_cast<uint8_t>(seqan3::to_char(base))], callback);
+            minimiser.finish(callback);
+        }
+    }
+}
+
+} // namespace raptor::detail
@@ -0,0 +1,90 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cassert>
+
+#include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Describes how the bits of a seqan3::interleaved_bloom_filter are arranged in memory.
+ * \details
+ * The IBF stores one row per hash value. Each row consists of `bin_words` 64-bit words, the bits of which correspond
+ * to the (technical) bins. This class reproduces the hashing of the IBF such that kernels can work on the raw data,
+ * e.g., to only access a subset of the columns or to access rows in a specific order.
+ * The hashing must be kept in sync with seqan3::interleaved_bloom_filter::hash_and_fit.
+ */
+class ibf_layout
+{
+public:
+    size_t bins{};
+    size_t technical_bins{};
+    size_t bin_size{};
+    size_t hash_shift{};
+    size_t bin_words{};
+    size_t hash_funs{};
+
+    static constexpr std::array<size_t, 5> hash_seeds{13572355802537770549ULL,
+                                                      13043817825332782213ULL,
+                                                      10650232656628343401ULL,
+                                                      16499269484942379435ULL,
+                                                      4893150838803335377ULL};
+
+    ibf_layout() = default;
+    ibf_layout(ibf_layout const &) = default;
+    ibf_layout(ibf_layout &&) = default;
+    ibf_layout & operator=(ibf_layout const &) = default;
+    ibf_layout & operator=(ibf_layout &&) = default;
+    ~ibf_layout() = default;
+
+    ibf_layout(size_t const bin_count, size_t const bin_size_, size_t const hash_function_count) :
+        bins{bin_count},
+        technical_bins{((bin_count + 63u) >> 6) << 6},
+        bin_size{bin_size_},
+        hash_shift{static_cast<size_t>(std::countl_zero(bin_size_))},
+        bin_words{(bin_count + 63u) >> 6},
+        hash_funs{hash_function_count}
+    {}
+
+    template <seqan3::data_layout data_layout_mode>
+    explicit ibf_layout(seqan3::interleaved_bloom_filter<data_layout_mode> const & ibf) :
+        ibf_layout{ibf.bin_count(), ibf.bin_size(), ibf.hash_function_count()}
+    {}
+
+    //!\brief Returns the row that the `i`-th hash function assigns to `value`.
+    size_t row(size_t value, size_t const i) const noexcept
+    {
+        assert(i < hash_funs);
+        value *= hash_seeds[i];
+        value ^= value >> hash_shift;
+        value *= 11400714819323198485ULL;
+#ifdef __SIZEOF_INT128__
+        return static_cast<uint64_t>((static_cast<__uint128_t>(value) * static_cast<__uint128_t>(bin_size)) >> 64);
+#else
+        return value % bin_size;
+#endif
+    }
+
+    //!\brief Returns the offset of the first word of the row that the `i`-th hash function assigns to `value`.
+    size_t row_word(size_t const value, size_t const i) const noexcept
+    {
+        return row(value, i) * bin_words;
+    }
+
+    //!\brief The number of 64-bit words of the whole bit vector.
+    size_t word_count() const noexcept
+    {
+        return bin_size * bin_words;
+    }
+};
+
+} // namespace raptor::detail
@@ -0,0 +1,41 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <vector>
+
+namespace raptor::detail
+{
+
+/*!\brief Calls `worker(i)` for all `i` in `[0, count)`, distributed dynamically over at most `threads` threads.
+ * \details Exceptions thrown by `worker` are rethrown after all threads have finished.
+ */
+template <typename worker_t>
+void parallel_for(size_t const count, size_t const threads, worker_t && worker)
+{
+    std::atomic<size_t> next{};
+    std::vector<std::future<void>> tasks{};
+
+    for (size_t thread_id = 0; thread_id < std::min(count, std::max<size_t>(1u, threads)); ++thread_id)
+        tasks.push_back(std::async(std::launch::async, [&] ()
+        {
+            for (size_t i = next++; i < count; i = next++)
+                worker(i);
+        }));
+
+    for (auto && task : tasks)
+        task.wait();
+
+    for (auto && task : tasks)
+        task.get();
+}
+
+} // namespace raptor::detail
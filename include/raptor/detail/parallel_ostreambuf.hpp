@@ -0,0 +1,59 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <seqan3/std/filesystem>
+
+#include <raptor/detail/payload_ostreambuf.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Writes a serialised index to a file, writing the payload with several threads.
+ * \details
+ * The file is byte-identical to the one written by a std::ofstream. All bytes are buffered in memory, except for the
+ * payload, see payload_ostreambuf. Once the payload has been serialised, the bytes before the payload are written,
+ * and the payload is split into chunks of `chunk_size` bytes. The chunk boundaries are aligned to multiples of
+ * `chunk_size` within the file, and each thread writes whole chunks via `pwrite`. The bytes after the payload are
+ * written by close().
+ */
+class parallel_ostreambuf : public payload_ostreambuf
+{
+public:
+    static constexpr size_t default_chunk_size{1ULL << 26};
+
+    parallel_ostreambuf() = delete;
+    parallel_ostreambuf(parallel_ostreambuf const &) = delete;
+    parallel_ostreambuf(parallel_ostreambuf &&) = delete;
+    parallel_ostreambuf & operator=(parallel_ostreambuf const &) = delete;
+    parallel_ostreambuf & operator=(parallel_ostreambuf &&) = delete;
+    ~parallel_ostreambuf() override;
+
+    parallel_ostreambuf(std::filesystem::path const & path,
+                        char const * const payload,
+                        size_t const payload_size,
+                        size_t const threads,
+                        size_t const chunk_size = default_chunk_size);
+
+    //!\brief Writes the bytes after the payload and closes the file. Must be called after the serialisation.
+    void close();
+
+protected:
+    void write_payload() override;
+
+private:
+    std::filesystem::path path{};
+    int file_descriptor{-1};
+    size_t threads{1u};
+    size_t chunk_size{default_chunk_size};
+
+    //!\brief Writes `[data, data + size)` at `offset` of the file.
+    void write(char const * data, size_t size, size_t offset) const;
+};
+
+} // namespace raptor::detail
@@ -0,0 +1,58 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <streambuf>
+#include <vector>
+
+namespace raptor::detail
+{
+
+/*!\brief Base of the stream buffers that store the payload of a serialised index, i.e., the bit vector of the IBF,
+ *        separately from the other bytes.
+ * \details
+ * The payload is recognised by its address, which relies on how cereal and sdsl write an index:
+ *   * The stream buffer has no put area, hence every write reaches xsputn() or overflow().
+ *   * sdsl writes the bit vector directly from its memory, i.e., `[payload, payload + payload_size)` arrives in one
+ *     or more consecutive writes in ascending order and is not copied before.
+ *   * No other write points into the memory of the bit vector.
+ *
+ * The bytes before the payload are collected in `header` and the bytes after it in `trailer`. When the last byte of
+ * the payload has been written, write_payload() is called. A write into the payload that does not continue the
+ * previous one or that exceeds the payload breaks these assumptions and throws.
+ */
+class payload_ostreambuf : public std::streambuf
+{
+public:
+    payload_ostreambuf() = delete;
+    payload_ostreambuf(payload_ostreambuf const &) = delete;
+    payload_ostreambuf(payload_ostreambuf &&) = delete;
+    payload_ostreambuf & operator=(payload_ostreambuf const &) = delete;
+    payload_ostreambuf & operator=(payload_ostreambuf &&) = delete;
+    ~payload_ostreambuf() override = default;
+
+protected:
+    char const * payload{nullptr};
+    size_t payload_size{};
+    size_t payload_bytes_written{};
+    std::vector<char> header{};
+    std::vector<char> trailer{};
+
+    payload_ostreambuf(char const * const payload, size_t const payload_size);
+
+    //!\brief Called once the whole payload has been written. `header` is complete at this point.
+    virtual void write_payload() = 0;
+
+    //!\brief Throws if the payload has not been written completely, i.e., if the IBF was not serialised.
+    void check_payload_written() const;
+
+    int_type overflow(int_type character) override;
+    std::streamsize xsputn(char const * data, std::streamsize count) override;
+};
+
+} // namespace raptor::detail
@@ -0,0 +1,296 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <seqan3/std/ranges>
+#include <vector>
+
+#include <seqan3/alphabet/concept.hpp>
+#include <seqan3/alphabet/nucleotide/dna4.hpp>
+#include <seqan3/search/kmer_index/shape.hpp>
+
+namespace raptor::detail
+{
+
+//!\brief Maps a character to its seqan3::dna4 rank. Like seqan3::dna4, characters other than ACGTU are mapped to A.
+inline constexpr std::array<uint8_t, 256> dna4_rank_table = [] ()
+{
+    std::array<uint8_t, 256> table{};
+    for (size_t i = 0; i < 256; ++i)
+        table[i] = seqan3::assign_char_to(static_cast<char>(i), seqan3::dna4{}).to_rank();
+    return table;
+}();
+
+//!\brief The rank of ambiguous bases in nucleotide_rank_table.
+inline constexpr uint8_t ambiguous_rank{4u};
+
+//!\brief Maps ACGTU (both cases) to its seqan3::dna4 rank and all other characters, e.g., N, to ambiguous_rank.
+inline constexpr std::array<uint8_t, 256> nucleotide_rank_table = [] ()
+{
+    std::array<uint8_t, 256> table{};
+    table.fill(ambiguous_rank);
+    for (char const base : {'A', 'C', 'G', 'T', 'U', 'a', 'c', 'g', 't', 'u'})
+        table[static_cast<uint8_t>(base)] = dna4_rank_table[static_cast<uint8_t>(base)];
+    return table;
+}();
+
+/*!\brief Computes the same canonical minimisers as seqan3::views::minimiser_hash, one base at a time.
+ * \details
+ * The k-mer and window state is kept between calls of push(), hence a sequence can be processed in arbitrary chunks
+ * without materialising it. After reset(), the next base starts a new sequence. finish() must be called at the end of
+ * each sequence.
+ * Every emitted minimiser is reported via a callback that receives the hash value and the begin position of the
+ * corresponding k-mer within the sequence. The k-mer covers the positions `[begin, begin + shape.size())`.
+ * An ambiguous base (ambiguous_rank) ends the current k-mer and window, like the end of a sequence, but positions keep
+ * counting. Hence, runs of N do not produce poly-A minimisers, and the parts between ambiguous bases yield the same
+ * minimisers as separate sequences.
+ * No memory is allocated after construction.
+ */
+class streaming_minimiser
+{
+public:
+    streaming_minimiser() = default;
+    streaming_minimiser(streaming_minimiser const &) = default;
+    streaming_minimiser(streaming_minimiser &&) = default;
+    streaming_minimiser & operator=(streaming_minimiser const &) = default;
+    streaming_minimiser & operator=(streaming_minimiser &&) = default;
+    ~streaming_minimiser() = default;
+
+    streaming_minimiser(seqan3::shape const & shape, uint32_t const window_size, uint64_t const seed) :
+        kmer_size{shape.size()},
+        is_ungapped{shape.all()},
+        window_kmers{window_size - shape.size() + 1u},
+        seed{seed},
+        kmer_mask{shape.size() == 32u ? ~0ULL : (1ULL << (2u * shape.size())) - 1u},
+        window_values(window_kmers),
+        window_positions(window_kmers)
+    {
+        assert(window_size >= shape.size());
+
+        for (uint8_t i = 0; i < kmer_size; ++i)
+            if (shape[i])
+                shape_positions.push_back(i);
+    }
+
+    //!\brief Starts a new sequence.
+    void reset() noexcept
+    {
+        position = 0u;
+        skipped = 0u;
+        restart();
+    }
+
+    //!\brief The number of k-mers of the current sequence that were skipped because they contain an ambiguous base.
+    uint64_t skipped_kmers() const noexcept
+    {
+        return skipped;
+    }
+
+    /*!\brief Appends a base, given as seqan3::dna4 rank or ambiguous_rank, to the current sequence.
+     * \details Use nucleotide_rank_table to obtain the rank of a character.
+     */
+    template <typename callback_t>
+    void push(uint8_t const rank, callback_t && callback)
+    {
+        assert(rank <= ambiguous_rank);
+
+        if (rank == ambiguous_rank)
+        {
+            if (window_count > 0u && window_count < window_kmers)
+                find_minimiser(callback);
+
+            restart();
+            skipped += ++position >= kmer_size;
+            return;
+        }
+
+        forward_kmer = ((forward_kmer << 2) | rank) & kmer_mask;
+        reverse_kmer = (reverse_kmer >> 2) | (static_cast<uint64_t>(3u - rank) << (2u * (kmer_size - 1u)));
+        ++position;
+
+        if (++kmer_bases < kmer_size)
+        {
+            skipped += position >= kmer_size;
+            return;
+        }
+
+        push_kmer(callback);
+    }
+
+    //!\brief Finishes the current sequence. Sequences shorter than a window report the minimum of all their k-mers.
+    template <typename callback_t>
+    void finish(callback_t && callback)
+    {
+        if (window_count > 0u && window_count < window_kmers)
+            find_minimiser(callback);
+
+        reset();
+    }
+
+private:
+    uint8_t kmer_size{};
+    bool is_ungapped{true};
+    size_t window_kmers{};
+    uint64_t seed{};
+    uint64_t kmer_mask{};
+    std::vector<uint8_t> shape_positions{};
+
+    uint64_t position{};
+    //!\brief The number of unambiguous bases since the last ambiguous base.
+    uint64_t kmer_bases{};
+    uint64_t skipped{};
+    uint64_t forward_kmer{};
+    uint64_t reverse_kmer{};
+
+    //!\brief The hash values of the current window as ring buffer starting at window_begin.
+    std::vector<uint64_t> window_values{};
+    std::vector<uint64_t> window_positions{};
+    size_t window_begin{};
+    size_t window_count{};
+    uint64_t minimiser_value{};
+    //!\brief Position of the minimiser relative to the start of the window.
+    size_t minimiser_offset{};
+
+    //!\brief Discards the current k-mer and window.
+    void restart() noexcept
+    {
+        kmer_bases = 0u;
+        forward_kmer = 0u;
+        reverse_kmer = 0u;
+        window_begin = 0u;
+        window_count = 0u;
+    }
+
+    //!\brief Adds the k-mer ending at the current position to the window.
+    template <typename callback_t>
+    void push_kmer(callback_t && callback)
+    {
+        uint64_t const value = kmer_value();
+        uint64_t const kmer_begin = position - kmer_size;
+
+        if (window_count < window_kmers) // The first window is not complete yet.
+        {
+            window_values[window_count] = value;
+            window_positions[window_count] = kmer_begin;
+
+            if (++window_count == window_kmers)
+                find_minimiser(callback);
+
+            return;
+        }
+
+        // Replace the oldest value of the window.
+        window_values[window_begin] = value;
+        window_positions[window_begin] = kmer_begin;
+        window_begin = window_begin + 1u == window_kmers ? 0u : window_begin + 1u;
+
+        if (minimiser_offset == 0u) // The minimiser left the window.
+        {
+            find_minimiser(callback);
+        }
+        else if (value < minimiser_value)
+        {
+            minimiser_value = value;
+            minimiser_offset = window_kmers - 1u;
+            callback(value, kmer_begin);
+        }
+        else
+        {
+            --minimiser_offset;
+        }
+    }
+
+    //!\brief The canonical hash value of the current k-mer.
+    uint64_t kmer_value() const noexcept
+    {
+        if (is_ungapped)
+            return std::min(forward_kmer ^ seed, reverse_kmer ^ seed);
+
+        uint64_t forward{};
+        uint64_t reverse{};
+        for (uint8_t const i : shape_positions)
+        {
+            forward = (forward << 2) | ((forward_kmer >> (2u * (kmer_size - 1u - i))) & 3u);
+            reverse = (reverse << 2) | ((reverse_kmer >> (2u * (kmer_size - 1u - i))) & 3u);
+        }
+
+        return std::min(forward ^ seed, reverse ^ seed);
+    }
+
+    //!\brief Reports the rightmost minimum of the (possibly incomplete) window.
+    template <typename callback_t>
+    void find_minimiser(callback_t && callback)
+    {
+        size_t const count = window_count;
+        size_t best = window_begin;
+        size_t best_offset = 0u;
+
+        for (size_t offset = 0u, i = window_begin; offset < count; ++offset, i = i + 1u == window_kmers ? 0u : i + 1u)
+        {
+            if (window_values[i] <= window_values[best])
+            {
+                best = i;
+                best_offset = offset;
+            }
+        }
+
+        minimiser_value = window_values[best];
+        minimiser_offset = best_offset;
+        callback(minimiser_value, window_positions[best]);
+    }
+};
+
+/*!\brief Computes the minimisers of whole sequences, e.g., reads, like seqan3::views::minimiser_hash.
+ * \details
+ * Accepts ranges of any seqan3 nucleotide alphabet. Ambiguous bases, e.g., N of seqan3::dna5, break the sequence as
+ * described for streaming_minimiser. Each worker needs its own instance.
+ */
+class sequence_minimiser
+{
+public:
+    sequence_minimiser() = default;
+    sequence_minimiser(sequence_minimiser const &) = default;
+    sequence_minimiser(sequence_minimiser &&) = default;
+    sequence_minimiser & operator=(sequence_minimiser const &) = default;
+    sequence_minimiser & operator=(sequence_minimiser &&) = default;
+    ~sequence_minimiser() = default;
+
+    sequence_minimiser(seqan3::shape const & shape, uint32_t const window_size, uint64_t const seed) :
+        kernel{shape, window_size, seed}
+    {}
+
+    //!\brief Stores the minimisers of `sequence` in `minimiser`.
+    template <std::ranges::input_range sequence_t>
+    void operator()(sequence_t && sequence, std::vector<uint64_t> & minimiser)
+    {
+        minimiser.clear();
+        auto store = [&minimiser] (uint64_t const hash, uint64_t const) { minimiser.push_back(hash); };
+
+        kernel.reset();
+        for (auto const base : sequence)
+            kernel.push(nucleotide_rank_table[static_cast<uint8_t>(seqan3::to_char(base))], store);
+        skipped = kernel.skipped_kmers();
+        kernel.finish(store);
+    }
+
+    //!\brief The number of k-mers of the last sequence that contain an ambiguous base.
+    uint64_t skipped_kmers() const noexcept
+    {
+        return skipped;
+    }
+
+private:
+    streaming_minimiser kernel{};
+    uint64_t skipped{};
+};
+
+} // namespace raptor::detail
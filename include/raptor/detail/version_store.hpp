@@ -0,0 +1,129 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <array>
+#include <seqan3/std/filesystem>
+#include <future>
+#include <istream>
+#include <streambuf>
+#include <vector>
+
+#include <raptor/detail/payload_ostreambuf.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Index versions whose IBF payload is stored in content-addressed blocks.
+ * \details
+ * A version consists of a manifest file and blocks in the directory `blocks` next to the manifest. All versions in
+ * the same directory share this block directory; a block that is contained in several versions is stored only once.
+ *
+ * The payload, i.e., the bit vector of the IBF, is split into groups of `block_rows` rows. Within a group, each
+ * 64-bit column (64 bins) is a separate block. Hence, a block only changes if one of its 64 bins changes, as long as
+ * the number of bins and the bin size stay the same. A block is named after the hash of its content.
+ *
+ * The manifest contains the bytes of the serialised index before and after the payload and the hashes of all blocks.
+ */
+struct version_store
+{
+    //!\brief The SHA-256 hash of the content of a block.
+    using block_hash = std::array<uint8_t, 32>;
+
+    //!\brief The number of rows in a block. Keeps blocks at most 1 MiB and a group of rows at most 64 MiB.
+    static size_t block_rows(size_t const bin_words);
+
+    //!\brief The SHA-256 hash of the `size` words at `data`, taken as bytes in memory order.
+    static block_hash hash(uint64_t const * const data, size_t const size);
+
+    static std::filesystem::path block_path(std::filesystem::path const & block_directory, block_hash const & hash);
+
+    static std::filesystem::path block_directory(std::filesystem::path const & manifest);
+};
+
+/*!\brief Writes a serialised index as a version of a version_store.
+ * \details
+ * All bytes are buffered in memory, except for the payload, see payload_ostreambuf. Once the payload has been
+ * serialised, the blocks are hashed and written in parallel. Blocks that already exist with the expected size and hash
+ * are not written again; other existing blocks are replaced. The manifest is written by close().
+ */
+class versioned_ostreambuf : public payload_ostreambuf
+{
+public:
+    versioned_ostreambuf() = delete;
+    versioned_ostreambuf(versioned_ostreambuf const &) = delete;
+    versioned_ostreambuf(versioned_ostreambuf &&) = delete;
+    versioned_ostreambuf & operator=(versioned_ostreambuf const &) = delete;
+    versioned_ostreambuf & operator=(versioned_ostreambuf &&) = delete;
+    ~versioned_ostreambuf() override = default;
+
+    versioned_ostreambuf(std::filesystem::path const & manifest,
+                         uint64_t const * const payload,
+                         size_t const rows,
+                         size_t const bin_words,
+                         size_t const threads);
+
+    //!\brief Writes the manifest. Must be called after the index has been serialised.
+    void close();
+
+protected:
+    //!\brief Writes the blocks.
+    void write_payload() override;
+
+private:
+    std::filesystem::path manifest{};
+    size_t rows{};
+    size_t bin_words{};
+    size_t threads{1u};
+    std::vector<version_store::block_hash> hashes{};
+};
+
+/*!\brief Reads a version written by versioned_ostreambuf.
+ * \details
+ * The payload is assembled one group of rows at a time. The blocks of a group are read in parallel, and the next
+ * group is assembled in the background while the current one is consumed. The content of each block is verified.
+ */
+class versioned_istreambuf : public std::streambuf
+{
+public:
+    versioned_istreambuf() = delete;
+    versioned_istreambuf(versioned_istreambuf const &) = delete;
+    versioned_istreambuf(versioned_istreambuf &&) = delete;
+    versioned_istreambuf & operator=(versioned_istreambuf const &) = delete;
+    versioned_istreambuf & operator=(versioned_istreambuf &&) = delete;
+    ~versioned_istreambuf() override;
+
+    versioned_istreambuf(std::streambuf * manifest, std::filesystem::path const & block_directory, size_t const threads);
+
+protected:
+    int_type underflow() override;
+
+private:
+    std::filesystem::path block_directory{};
+    size_t threads{1u};
+    size_t rows{};
+    size_t bin_words{};
+    size_t group_count{};
+    size_t next_segment{};
+    std::vector<char> header{};
+    std::vector<char> trailer{};
+    std::vector<version_store::block_hash> hashes{};
+    std::vector<char> current{};
+    std::vector<char> next{};
+    std::future<void> pending{};
+
+    void read_group(size_t const group, std::vector<char> & output) const;
+};
+
+//!\brief Whether the stream starts with the magic string of a version manifest. Does not consume input.
+bool is_versioned(std::istream & stream);
+
+//!\brief The size in bytes of the serialised index described by the version manifest. Consumes the input.
+uint64_t versioned_size(std::streambuf * manifest);
+
+} // namespace raptor::detail
@@ -0,0 +1,31 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <ostream>
+
+#include <raptor/shared.hpp>
+
+namespace raptor
+{
+
+/*!\brief Prints the predicted peak memory, disk I/O and run time of `raptor build` without building the index.
+ * \details
+ * The memory and I/O volume are derived from the arguments and the input file sizes. The run time is extrapolated
+ * from the time it takes to compute the minimisers of the smallest input files.
+ */
+void dry_run(build_arguments const & arguments, std::ostream & out);
+
+/*!\brief Prints the predicted peak memory, disk I/O and run time of `raptor search` without searching.
+ * \details
+ * The memory and I/O volume are derived from the header of the index and a sample of the reads. The run time is
+ * extrapolated from the time it takes to process the sample with an IBF of the same shape, capped at 256 MiB.
+ */
+void dry_run(search_arguments const & arguments, std::ostream & out);
+
+} // namespace raptor
@@ -7,9 +7,17 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <type_traits>
+
 #include <seqan3/argument_parser/exceptions.hpp>
 #include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
 
+#include <raptor/detail/bit_matrix.hpp>
+#include <raptor/detail/parallel_for.hpp>
 #include <raptor/shared.hpp>
 
 namespace raptor
@@ -29,12 +37,13 @@ private:
     uint8_t parts_{};
     bool compressed_{};
     std::vector<std::vector<std::string>> bin_path_{};
+    std::vector<double> fill_rates_{};
     ibf_t ibf_{};
 
 public:
     static constexpr seqan3::data_layout data_layout_mode = data_layout_mode_;
 
-    static constexpr uint32_t version{1u};
+    static constexpr uint32_t version{2u};
 
     raptor_index() = default;
     raptor_index(raptor_index const &) = default;
@@ -79,6 +88,7 @@ public:
         parts_ = other.parts_;
         compressed_ = true;
         bin_path_ = other.bin_path_;
+        fill_rates_ = other.fill_rates_;
         ibf_ = ibf_t{other.ibf_};
     }
 
@@ -90,6 +100,7 @@ public:
         parts_ = std::move(other.parts_);
         compressed_ = true;
         bin_path_ = std::move(other.bin_path_);
+        fill_rates_ = std::move(other.fill_rates_);
         ibf_ = std::move(ibf_t{std::move(other.ibf_)});
     }
 
@@ -118,6 +129,128 @@ public:
         return bin_path_;
     }
 
+    /*!\brief The fraction of set bits of each bin. Empty for indices of version 1.
+     * \details The probability of a false positive in bin `b` is `fill_rates()[b]` to the power of the number of
+     *          hash functions.
+     */
+    std::vector<double> const & fill_rates() const
+    {
+        return fill_rates_;
+    }
+
+    /*!\brief Computes the fill rates of all bins.
+     * \details For compressed indices, the set bits are enumerated sequentially; `threads` is ignored.
+     */
+    void compute_fill_rates(size_t const threads = 1u)
+    {
+        size_t const bin_count{ibf_.bin_count()};
+        size_t const bin_size{ibf_.bin_size()};
+        size_t const bin_words{(bin_count + 63u) >> 6};
+        std::vector<std::vector<size_t>> set_bits{};
+
+        if constexpr (data_layout_mode == seqan3::data_layout::compressed)
+        {
+            auto const & data = ibf_.raw_data();
+            using data_t = std::remove_cvref_t<decltype(data)>;
+            typename data_t::rank_1_type const rank{&data};
+            typename data_t::select_1_type const select{&data};
+            auto & counts = set_bits.emplace_back(bin_words * 64u, 0u);
+
+            // The bits have the same positions as in the uncompressed layout.
+            for (size_t i = 1u, ones = rank(data.size()); i <= ones; ++i)
+                ++counts[select(i) % (bin_words * 64u)];
+        }
+        else
+        {
+            size_t const thread_count{std::max<size_t>(1u, std::min(threads, bin_size))};
+            size_t const rows_per_thread{(bin_size + thread_count - 1u) / thread_count};
+            uint64_t const * const data = ibf_.raw_data().data();
+
+            set_bits.assign(thread_count, std::vector<size_t>(bin_words * 64u, 0u));
+
+            // Each range of rows has its own counts, hence no synchronisation is needed.
+            detail::parallel_for(thread_count, thread_count, [&] (size_t const range)
+            {
+                size_t const first_row = range * rows_per_thread;
+                size_t const last_row = std::min(bin_size, first_row + rows_per_thread);
+                auto & counts = set_bits[range];
+
+                for (size_t row = first_row; row < last_row; ++row)
+                    for (size_t word = 0; word < bin_words; ++word)
+                        for (uint64_t bits = data[row * bin_words + word]; bits; bits &= bits - 1u)
+                            ++counts[word * 64u + std::countr_zero(bits)];
+            });
+        }
+
+        fill_rates_.assign(bin_count, 0.0);
+        for (size_t bin = 0; bin < bin_count; ++bin)
+        {
+            for (auto const & counts : set_bits)
+                fill_rates_[bin] += counts[bin];
+            fill_rates_[bin] /= bin_size;
+        }
+    }
+
+    /*!\brief Reorders the bins such that the new bin `i` is the old bin `order[i]`.
+     * \details
+     * The IBF is processed in blocks of 64 rows. Each word of a block is transposed, such that each bin becomes a
+     * 64 bit word, these words are permuted, and transposed back. The bin paths and fill rates are permuted
+     * accordingly.
+     */
+    void permute_bins(std::vector<size_t> const & order, size_t const threads = 1u)
+        requires (data_layout_mode == seqan3::data_layout::uncompressed)
+    {
+        size_t const bin_count{ibf_.bin_count()};
+        size_t const bin_size{ibf_.bin_size()};
+        size_t const bin_words{(bin_count + 63u) >> 6};
+        size_t const blocks{(bin_size + 63u) / 64u};
+        uint64_t * const data = ibf_.raw_data().data();
+
+        assert(order.size() == bin_count);
+
+        detail::parallel_for(blocks, threads, [&] (size_t const block)
+        {
+            std::vector<uint64_t> columns(bin_words * 64u);
+            std::array<uint64_t, 64> matrix{};
+            size_t const first_row = block * 64u;
+            size_t const rows = std::min<size_t>(64u, bin_size - first_row);
+
+            for (size_t word = 0; word < bin_words; ++word)
+            {
+                matrix.fill(0u);
+                for (size_t row = 0; row < rows; ++row)
+                    matrix[row] = data[(first_row + row) * bin_words + word];
+                detail::transpose_64x64(matrix);
+                std::ranges::copy(matrix, columns.begin() + word * 64u);
+            }
+
+            for (size_t word = 0; word < bin_words; ++word)
+            {
+                for (size_t column = 0; column < 64u; ++column)
+                {
+                    size_t const bin = word * 64u + column;
+                    matrix[column] = bin < bin_count ? columns[order[bin]] : 0u;
+                }
+                detail::transpose_64x64(matrix);
+                for (size_t row = 0; row < rows; ++row)
+                    data[(first_row + row) * bin_words + word] = matrix[row];
+            }
+        });
+
+        std::vector<std::vector<std::string>> bin_path(bin_count);
+        for (size_t bin = 0; bin < bin_count; ++bin)
+            bin_path[bin] = std::move(bin_path_[order[bin]]);
+        bin_path_ = std::move(bin_path);
+
+        if (!fill_rates_.empty())
+        {
+            std::vector<double> fill_rates(bin_count);
+            for (size_t bin = 0; bin < bin_count; ++bin)
+                fill_rates[bin] = fill_rates_[order[bin]];
+            fill_rates_ = std::move(fill_rates);
+        }
+    }
+
     ibf_t & ibf()
     {
         return ibf_;
@@ -139,7 +272,7 @@ public:
     template <seqan3::cereal_archive archive_t>
     void CEREAL_SERIALIZE_FUNCTION_NAME(archive_t & archive, uint32_t const version)
     {
-        if (version == 1u)
+        if (version == 1u || version == 2u)
         {
             try
             {
@@ -153,6 +286,8 @@ public:
                     throw seqan3::argument_parser_error{"Data layouts of serialised and specified index differ."};
                 }
                 archive(bin_path_);
+                if (version == 2u)
+                    archive(fill_rates_);
                 archive(ibf_);
             }
             catch (std::exception const & e)
@@ -178,7 +313,7 @@ public:
     {
         uint32_t version{};
         archive(version);
-        if (version == 1u)
+        if (version == 1u || version == 2u)
         {
             try
             {
@@ -187,6 +322,8 @@ public:
                 archive(parts_);
                 archive(compressed_);
                 archive(bin_path_);
+                if (version == 2u)
+                    archive(fill_rates_);
             }
 // LCOV_EXCL_START
             catch (std::exception const & e)
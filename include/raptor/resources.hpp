@@ -0,0 +1,50 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <seqan3/std/filesystem>
+#include <optional>
+
+namespace raptor
+{
+
+//!\brief The hardware available to this process.
+struct system_resources
+{
+    //!\brief The number of CPUs this process may run on, limited by the CPU affinity and the cgroup CPU quota.
+    size_t cpus{1u};
+    //!\brief The main memory in bytes, limited by the cgroup memory limit. 0 if unknown.
+    uint64_t memory{};
+    //!\brief The number of NUMA nodes.
+    size_t numa_nodes{1u};
+    //!\brief The size of the L3 cache in bytes. 0 if unknown.
+    uint64_t l3_cache{};
+};
+
+//!\brief Where detect_resources() reads its information from. The defaults describe the running system.
+struct resource_sources
+{
+    //!\brief The directory containing `proc` and `sys`.
+    std::filesystem::path root{"/"};
+    //!\brief The number of CPUs in the CPU affinity mask. If not set, the affinity of this process is used.
+    std::optional<size_t> affinity_cpus{};
+};
+
+/*!\brief Detects the resources available to this process.
+ * \details
+ * Supports cgroup v1 and v2. Values that cannot be determined, e.g., on systems other than Linux, fall back to the
+ * hardware concurrency, the physical memory, one NUMA node, and an unknown cache size.
+ */
+system_resources detect_resources(resource_sources const & sources = {});
+
+//!\brief The default number of threads: One per available CPU.
+uint8_t default_threads(system_resources const & resources);
+
+} // namespace raptor
@@ -0,0 +1,186 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include <seqan3/utility/views/slice.hpp>
+
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/search/do_parallel.hpp>
+#include <raptor/shared.hpp>
+
+namespace raptor::detail
+{
+
+//!\brief The name of this machine.
+inline std::string host_name()
+{
+    std::array<char, 256> buffer{};
+    if (gethostname(buffer.data(), buffer.size() - 1u) != 0)
+        return "unknown";
+    return buffer.data();
+}
+
+/*!\brief Stores the thread counts chosen by `--auto-tune` in `<index>.tuning`.
+ * \details
+ * Each line contains a key and the number of threads. The key consists of the host name, the absolute path of the
+ * index, its size and modification time, the number of bins, and the thread limit (`--threads`) of the calibration.
+ * An entry is only used if the whole key matches, hence rebuilding the index, moving it to another machine, or
+ * changing `--threads` triggers a new calibration. The cached value never exceeds `--threads`.
+ */
+class tuning_cache
+{
+public:
+    tuning_cache() = default;
+    tuning_cache(tuning_cache const &) = default;
+    tuning_cache(tuning_cache &&) = default;
+    tuning_cache & operator=(tuning_cache const &) = default;
+    tuning_cache & operator=(tuning_cache &&) = default;
+    ~tuning_cache() = default;
+
+    explicit tuning_cache(search_arguments const & arguments) :
+        path{arguments.index_file.string() + ".tuning"},
+        key{compute_key(arguments)},
+        max_threads{arguments.threads}
+    {}
+
+    //!\brief The cached number of threads for this key, if any.
+    std::optional<uint8_t> get() const
+    {
+        std::ifstream file{path};
+        std::string line{};
+
+        while (std::getline(file, line))
+        {
+            size_t const separator = line.rfind('\t');
+            if (separator == std::string::npos || line.substr(0, separator) != key)
+                continue;
+
+            size_t const entry_threads = std::strtoull(line.c_str() + separator + 1u, nullptr, 10);
+            if (entry_threads > 0u)
+                return static_cast<uint8_t>(std::min<size_t>(entry_threads, max_threads));
+        }
+
+        return std::nullopt;
+    }
+
+    //!\brief Stores the number of threads for this key. Entries with other keys are kept.
+    void set(uint8_t const threads) const
+    {
+        std::vector<std::string> lines{};
+        {
+            std::ifstream file{path};
+            for (std::string line{}; std::getline(file, line);)
+                if (line.substr(0, line.rfind('\t')) != key)
+                    lines.push_back(line);
+        }
+
+        // Failing to write the cache is not an error; the next run will calibrate again.
+        std::ofstream file{path};
+        for (auto const & line : lines)
+            file << line << '\n';
+        file << key << '\t' << static_cast<size_t>(threads) << '\n';
+    }
+
+private:
+    std::filesystem::path path{};
+    std::string key{};
+    uint8_t max_threads{1u};
+
+    static std::string compute_key(search_arguments const & arguments)
+    {
+        std::error_code ec{};
+        uint64_t size{};
+        uint64_t modified{};
+
+        for (size_t part{0}; part < arguments.parts; ++part)
+        {
+            std::filesystem::path const part_path = arguments.parts == 1u ? arguments.index_file :
+                                                                            std::filesystem::path{
+                                                                                arguments.index_file.string() + "_" +
+                                                                                std::to_string(part)};
+            size += std::filesystem::file_size(part_path, ec);
+            modified ^= std::filesystem::last_write_time(part_path, ec).time_since_epoch().count();
+        }
+
+        std::ostringstream key{};
+        key << host_name() << '\t'
+            << std::filesystem::absolute(arguments.index_file, ec).string() << '\t'
+            << size << '\t'
+            << modified << '\t'
+            << arguments.bin_path.size() << '\t'
+            << static_cast<size_t>(arguments.threads);
+        return key.str();
+    }
+};
+
+/*!\brief Measures the throughput of the counting kernel on a sample of `records` for different thread counts.
+ * \details
+ * The thread counts 1, 2, 4, ... up to `arguments.threads` are tried after a warm-up run. More threads are only
+ * chosen if they are at least 5% faster, such that hyper-threads and memory-bound machines do not waste resources.
+ * \returns The number of threads with the highest throughput.
+ */
+template <typename ibf_t, typename records_t>
+uint8_t calibrate_threads(ibf_t const & ibf, records_t const & records, search_arguments const & arguments)
+{
+    size_t const max_threads = arguments.threads;
+    size_t const sample_size = std::min<size_t>(records.size(), 1ULL << 14);
+
+    if (max_threads == 1u || sample_size == 0u)
+        return max_threads;
+
+    auto count_task = [&] (size_t const start, size_t const end)
+    {
+        auto counter = ibf.template counting_agent<uint16_t>();
+        std::vector<uint64_t> minimiser{};
+        sequence_minimiser hasher{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)};
+
+        for (auto && [id, seq] : records | seqan3::views::slice(start, end))
+        {
+            (void) id;
+            hasher(seq, minimiser);
+            counter.bulk_count(minimiser);
+        }
+    };
+
+    double warm_up_time{};
+    do_parallel(count_task, sample_size, max_threads, warm_up_time);
+
+    uint8_t best_threads{1u};
+    double best_time{};
+
+    for (size_t threads = 1u;; threads = std::min(2u * threads, max_threads))
+    {
+        double time{};
+        do_parallel(count_task, sample_size, threads, time);
+
+        if (threads == 1u || time * 1.05 < best_time)
+        {
+            best_time = time;
+            best_threads = threads;
+        }
+
+        if (threads == max_threads)
+            break;
+    }
+
+    return best_threads;
+}
+
+} // namespace raptor::detail
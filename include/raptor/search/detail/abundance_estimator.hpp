@@ -0,0 +1,199 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <robin_hood.h>
+
+#include <raptor/search/sync_out.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Estimates the relative abundance of each bin from the sets of bins that the reads hit.
+ * \details
+ * Reads that hit the same set of bins form an equivalence class. Each worker counts the classes of its reads in its
+ * own agent, keyed by the sorted bin numbers. The agents are merged when they are destroyed.
+ * write() runs an expectation-maximisation over the classes: Each read of a class is distributed over the bins of the
+ * class proportionally to the current abundances, and the abundances are updated to the resulting read shares. The
+ * iteration stops when no abundance changes by more than `tolerance`, or after `max_iterations` iterations.
+ */
+class abundance_estimator
+{
+public:
+    static constexpr size_t max_iterations{1000u};
+    static constexpr double tolerance{1e-8};
+
+    //!\brief Counts the equivalence classes of the reads processed by one worker. Merges them on destruction.
+    class agent
+    {
+    public:
+        agent() = delete;
+        agent(agent const &) = delete;
+        agent & operator=(agent const &) = delete;
+        agent & operator=(agent &&) = delete;
+
+        //!\brief Only the new agent is merged.
+        agent(agent && other) noexcept :
+            estimator{std::exchange(other.estimator, nullptr)},
+            key{std::move(other.key)},
+            classes{std::move(other.classes)},
+            unclassified{std::exchange(other.unclassified, 0u)}
+        {}
+
+        ~agent()
+        {
+            if (estimator)
+                estimator->merge(*this);
+        }
+
+        explicit agent(abundance_estimator & estimator) : estimator{&estimator}
+        {}
+
+        //!\brief Reports that the current read hits `bin`. Bins must be reported in increasing order.
+        void add(size_t const bin)
+        {
+            uint32_t const value = bin;
+            key.append(reinterpret_cast<char const *>(&value), sizeof(uint32_t));
+        }
+
+        //!\brief Counts the bins reported since the last call as the equivalence class of one read.
+        void next_read()
+        {
+            if (key.empty())
+                ++unclassified;
+            else
+                ++classes[key];
+
+            key.clear();
+        }
+
+    private:
+        friend abundance_estimator;
+
+        abundance_estimator * estimator{nullptr};
+        std::string key{};
+        robin_hood::unordered_map<std::string, uint64_t> classes{};
+        uint64_t unclassified{};
+    };
+
+    abundance_estimator() = delete;
+    abundance_estimator(abundance_estimator const &) = delete;
+    abundance_estimator(abundance_estimator &&) = delete;
+    abundance_estimator & operator=(abundance_estimator const &) = delete;
+    abundance_estimator & operator=(abundance_estimator &&) = delete;
+    ~abundance_estimator() = default;
+
+    explicit abundance_estimator(size_t const bin_count) : bin_count{bin_count}
+    {}
+
+    /*!\brief Writes the number of unclassified reads and one line per bin: The bin number, the estimated number of
+     *        reads originating from the bin, and the estimated fraction of the classified reads.
+     * \details All agents must have been destroyed.
+     */
+    void write(sync_out & out) const
+    {
+        std::vector<double> const reads = estimate();
+        double const classified = std::accumulate(reads.begin(), reads.end(), 0.0);
+
+        std::ostringstream result{};
+        result << "#UNCLASSIFIED_READS\t" << unclassified << '\n' << "#BIN\tREADS\tABUNDANCE\n";
+        for (size_t bin = 0; bin < bin_count; ++bin)
+        {
+            result << bin << '\t' << std::fixed << std::setprecision(2) << reads[bin] << '\t'
+                   << std::setprecision(6) << (classified > 0.0 ? reads[bin] / classified : 0.0) << '\n';
+        }
+
+        out << result.str();
+    }
+
+private:
+    size_t bin_count{};
+    std::mutex merge_mutex{};
+    robin_hood::unordered_map<std::string, uint64_t> classes{};
+    uint64_t unclassified{};
+
+    void merge(agent & other)
+    {
+        std::lock_guard<std::mutex> lock{merge_mutex};
+
+        for (auto const & [key, count] : other.classes)
+            classes[key] += count;
+        unclassified += other.unclassified;
+        other.classes.clear();
+        other.unclassified = 0u;
+    }
+
+    //!\brief Runs the EM and returns the estimated number of reads per bin.
+    std::vector<double> estimate() const
+    {
+        // Flatten the classes: The bins of class `i` are `bins[offsets[i]]` to `bins[offsets[i + 1] - 1]`.
+        std::vector<uint32_t> bins{};
+        std::vector<size_t> offsets{0u};
+        std::vector<double> counts{};
+        double total{};
+
+        for (auto const & [key, count] : classes)
+        {
+            size_t const size = key.size() / sizeof(uint32_t);
+            bins.resize(bins.size() + size);
+            std::memcpy(bins.data() + offsets.back(), key.data(), key.size());
+            offsets.push_back(offsets.back() + size);
+            counts.push_back(count);
+            total += count;
+        }
+
+        std::vector<double> reads(bin_count, 0.0);
+        if (total == 0.0)
+            return reads;
+
+        std::vector<double> abundance(bin_count, 1.0 / bin_count);
+
+        for (size_t iteration = 0; iteration < max_iterations; ++iteration)
+        {
+            std::ranges::fill(reads, 0.0);
+
+            for (size_t i = 0; i < counts.size(); ++i)
+            {
+                double weight_sum{};
+                for (size_t j = offsets[i]; j < offsets[i + 1]; ++j)
+                    weight_sum += abundance[bins[j]];
+
+                // All bins of the class may have converged to 0; the reads are then distributed evenly.
+                size_t const size = offsets[i + 1] - offsets[i];
+                for (size_t j = offsets[i]; j < offsets[i + 1]; ++j)
+                    reads[bins[j]] += counts[i] * (weight_sum > 0.0 ? abundance[bins[j]] / weight_sum : 1.0 / size);
+            }
+
+            double change{};
+            for (size_t bin = 0; bin < bin_count; ++bin)
+            {
+                double const updated = reads[bin] / total;
+                change = std::max(change, std::abs(updated - abundance[bin]));
+                abundance[bin] = updated;
+            }
+
+            if (change < tolerance)
+                break;
+        }
+
+        return reads;
+    }
+};
+
+} // namespace raptor::detail
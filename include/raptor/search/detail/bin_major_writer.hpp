@@ -0,0 +1,232 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include <raptor/search/sync_out.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Collects the hits of a search per bin and writes one line per bin, listing the IDs of all reads that hit it.
+ * \details
+ * Each worker appends the hits of its reads to its own agent. An agent buffers the read IDs per bin. When the buffers
+ * exceed their share of the memory budget, they are handed to the writer as one segment per bin. The writer keeps the
+ * segments in memory. Only if they exceed half of the memory budget, they are moved to a spill file next to the output,
+ * which is created on demand. write() then concatenates the segments of each bin.
+ * A segment is identified by the first read of its agent and the number of previous flushes of this agent. Since each
+ * agent processes consecutive reads, ordering the segments by this key lists the reads of each bin in input order,
+ * independent of the number of threads.
+ */
+class bin_major_writer
+{
+public:
+    //!\brief Buffers the hits of the consecutive reads processed by one worker. Flushes the buffers on destruction.
+    class agent
+    {
+    public:
+        agent() = delete;
+        agent(agent const &) = delete;
+        agent(agent &&) = default;
+        agent & operator=(agent const &) = delete;
+        agent & operator=(agent &&) = default;
+
+        ~agent()
+        {
+            flush();
+        }
+
+        agent(bin_major_writer & writer, uint64_t const first_read) :
+            writer{&writer},
+            first_read{first_read},
+            buffers(writer.segments.size())
+        {}
+
+        //!\brief Reports that the read `id` hits `bin`.
+        void add(size_t const bin, std::string_view const id)
+        {
+            buffers[bin] += id;
+            buffers[bin] += ',';
+            buffered += id.size() + 1u;
+
+            if (buffered >= writer->agent_buffer_size)
+                flush();
+        }
+
+        //!\brief Hands all buffered hits to the writer.
+        void flush()
+        {
+            for (size_t bin = 0; bin < buffers.size(); ++bin)
+            {
+                if (buffers[bin].empty())
+                    continue;
+
+                writer->append(bin, segment_key{first_read, flushes}, std::move(buffers[bin]));
+                buffers[bin] = std::string{};
+            }
+
+            ++flushes;
+            buffered = 0u;
+        }
+
+    private:
+        bin_major_writer * writer{nullptr};
+        uint64_t first_read{};
+        uint64_t flushes{};
+        size_t buffered{};
+        std::vector<std::string> buffers{};
+    };
+
+    bin_major_writer() = delete;
+    bin_major_writer(bin_major_writer const &) = delete;
+    bin_major_writer(bin_major_writer &&) = delete;
+    bin_major_writer & operator=(bin_major_writer const &) = delete;
+    bin_major_writer & operator=(bin_major_writer &&) = delete;
+
+    ~bin_major_writer()
+    {
+        if (!spill.is_open())
+            return;
+
+        spill.close();
+        std::error_code ec{};
+        std::filesystem::remove(spill_path, ec);
+    }
+
+    /*!\brief Buffers the hits of `bin_count` bins in at most `memory_budget` bytes.
+     * \details Half of the budget is shared by the agents of the `threads` workers, the other half holds segments.
+     */
+    bin_major_writer(std::filesystem::path const & out_file,
+                     size_t const bin_count,
+                     size_t const memory_budget,
+                     size_t const threads) :
+        spill_path{out_file.string() + ".spill"},
+        agent_buffer_size{memory_budget / (2u * threads)},
+        memory_limit{memory_budget / 2u},
+        segments(bin_count)
+    {}
+
+    /*!\brief Writes one line per bin: The bin number, a tab, and the comma-separated IDs of the reads hitting the bin.
+     * \details All agents must have been destroyed.
+     */
+    void write(sync_out & out)
+    {
+        if (spill.is_open())
+            spill.flush();
+        std::string data{};
+
+        for (size_t bin = 0; bin < segments.size(); ++bin)
+        {
+            auto & bin_segments = segments[bin];
+            std::sort(bin_segments.begin(), bin_segments.end(), [] (auto const & lhs, auto const & rhs)
+            {
+                return lhs.key < rhs.key;
+            });
+
+            out << std::to_string(bin) + '\t';
+
+            for (auto & bin_segment : bin_segments)
+            {
+                if (bin_segment.on_disk)
+                {
+                    data.resize(bin_segment.size);
+                    spill.seekg(bin_segment.offset);
+                    spill.read(data.data(), bin_segment.size);
+                }
+                else
+                {
+                    data = std::move(bin_segment.data);
+                }
+
+                if (&bin_segment == &bin_segments.back())
+                    data.pop_back(); // Trailing comma.
+
+                out << data;
+            }
+
+            out << '\n';
+            segments[bin] = std::vector<segment>{};
+        }
+    }
+
+private:
+    //!\brief The first read of the agent and the number of the agent's flush.
+    using segment_key = std::tuple<uint64_t, uint64_t>;
+
+    //!\brief The hits of one bin handed over by one flush of an agent. Kept in `data` unless it is on disk.
+    struct segment
+    {
+        segment_key key{};
+        std::string data{};
+        bool on_disk{};
+        uint64_t offset{};
+        uint64_t size{};
+    };
+
+    std::filesystem::path spill_path{};
+    std::fstream spill{};
+    uint64_t spill_size{};
+    size_t agent_buffer_size{};
+    //!\brief The number of bytes of segments that may be kept in memory.
+    size_t memory_limit{};
+    //!\brief The number of bytes of segments that are kept in memory.
+    size_t memory_size{};
+    std::vector<std::vector<segment>> segments{};
+    std::mutex segments_mutex{};
+
+    void append(size_t const bin, segment_key const key, std::string data)
+    {
+        std::lock_guard<std::mutex> lock{segments_mutex};
+        size_t const size = data.size();
+        segments[bin].push_back(segment{key, std::move(data), false, 0u, size});
+        memory_size += size;
+
+        if (memory_size > memory_limit)
+            spill_segments();
+    }
+
+    //!\brief Moves all segments that are kept in memory to the spill file.
+    void spill_segments()
+    {
+        if (!spill.is_open())
+        {
+            spill.open(spill_path, std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
+            if (!spill.good())
+                throw std::ios_base::failure{"Could not create " + spill_path.string()};
+        }
+
+        for (auto & bin_segments : segments)
+        {
+            for (auto & bin_segment : bin_segments)
+            {
+                if (bin_segment.on_disk)
+                    continue;
+
+                spill.write(bin_segment.data.data(), bin_segment.size);
+                bin_segment.data = std::string{};
+                bin_segment.on_disk = true;
+                bin_segment.offset = spill_size;
+                spill_size += bin_segment.size;
+            }
+        }
+
+        if (!spill.good())
+            throw std::ios_base::failure{"Could not write " + spill_path.string()};
+        memory_size = 0u;
+    }
+};
+
+} // namespace raptor::detail
@@ -0,0 +1,108 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <seqan3/std/ranges>
+#include <vector>
+
+#include <seqan3/alphabet/concept.hpp>
+
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/shared.hpp>
+
+namespace raptor::detail
+{
+
+/*!\brief Computes the threshold of a read from the positions of its minimisers.
+ * \details
+ * Each error destroys all minimisers whose k-mer covers the position of the error. Greedily, each error is placed at
+ * the position that is covered by most of the remaining k-mers, and these k-mers are removed. The threshold is the
+ * number of minimisers that survive `errors` errors.
+ * This follows the heuristic of util/thresholding, but removes exactly the k-mers covering the error. util/thresholding
+ * removes the k-mers beginning or ending in the segment of maximal coverage, hence it may keep k-mers spanning the
+ * segment and remove k-mers not covering the error; both agree for up to one error. The coverage is not materialised:
+ * All k-mers have the same length and are sorted by their begin position, hence the maximal coverage can be found
+ * with a sliding window over the begin positions. K-mers containing an ambiguous base never produce minimisers and are hence not counted.
+ * Each worker needs its own instance. No memory is allocated once the buffers have grown to the longest read.
+ */
+class heuristic_threshold
+{
+public:
+    heuristic_threshold() = default;
+    heuristic_threshold(heuristic_threshold const &) = default;
+    heuristic_threshold(heuristic_threshold &&) = default;
+    heuristic_threshold & operator=(heuristic_threshold const &) = default;
+    heuristic_threshold & operator=(heuristic_threshold &&) = default;
+    ~heuristic_threshold() = default;
+
+    explicit heuristic_threshold(search_arguments const & arguments) :
+        kernel{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)},
+        kmer_size{arguments.shape_size},
+        errors{arguments.errors}
+    {}
+
+    //!\brief Stores the minimisers of `sequence` in `minimiser` and remembers their positions for get().
+    template <std::ranges::input_range sequence_t>
+    void compute_minimiser(sequence_t && sequence, std::vector<uint64_t> & minimiser)
+    {
+        minimiser.clear();
+        minimiser_begin.clear();
+
+        auto store = [&] (uint64_t const hash, uint64_t const begin)
+        {
+            minimiser.push_back(hash);
+            minimiser_begin.push_back(begin);
+        };
+
+        kernel.reset();
+        for (auto const base : sequence)
+            kernel.push(nucleotide_rank_table[static_cast<uint8_t>(seqan3::to_char(base))], store);
+        kernel.finish(store);
+    }
+
+    //!\brief The threshold for the sequence last passed to compute_minimiser().
+    size_t get()
+    {
+        remaining.assign(minimiser_begin.begin(), minimiser_begin.end());
+        size_t destroyed{};
+
+        for (uint8_t error = 0; error < errors && !remaining.empty(); ++error)
+        {
+            // The k-mers [first, last] are exactly those covering the position remaining[last].
+            // The coverage only increases at begin positions, hence one of these positions has maximal coverage.
+            size_t best_first{};
+            size_t best_last{};
+            for (size_t first = 0, last = 0; last < remaining.size(); ++last)
+            {
+                while (remaining[first] + kmer_size <= remaining[last])
+                    ++first;
+                if (last - first > best_last - best_first)
+                {
+                    best_first = first;
+                    best_last = last;
+                }
+            }
+
+            destroyed += best_last - best_first + 1u;
+            remaining.erase(remaining.begin() + best_first, remaining.begin() + best_last + 1u);
+        }
+
+        return minimiser_begin.size() - destroyed;
+    }
+
+private:
+    streaming_minimiser kernel{};
+    uint64_t kmer_size{};
+    uint8_t errors{};
+    //!\brief The begin positions of the k-mers of the minimisers. Strictly increasing.
+    std::vector<uint64_t> minimiser_begin{};
+    //!\brief The begin positions of the k-mers not yet destroyed.
+    std::vector<uint64_t> remaining{};
+};
+
+} // namespace raptor::detail
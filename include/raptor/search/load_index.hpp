@@ -10,6 +10,7 @@
 #include <chrono>
 #include <seqan3/std/filesystem>
 
+#include <raptor/detail/block_compression.hpp>
 #include <raptor/index.hpp>
 #include <raptor/shared.hpp>
 
@@ -22,7 +23,7 @@ void load_index(t & index, search_arguments const & arguments, size_t const part
     std::filesystem::path index_file{arguments.index_file};
     index_file += "_" + std::to_string(part);
 
-    std::ifstream is{index_file, std::ios::binary};
+    detail::index_istream is{index_file, arguments.threads};
     cereal::BinaryInputArchive iarchive{is};
 
     auto start = std::chrono::high_resolution_clock::now();
@@ -35,7 +36,7 @@ void load_index(t & index, search_arguments const & arguments, size_t const part
 template <typename t>
 void load_index(t & index, search_arguments const & arguments, double & index_io_time)
 {
-    std::ifstream is{arguments.index_file, std::ios::binary};
+    detail::index_istream is{arguments.index_file, arguments.threads};
     cereal::BinaryInputArchive iarchive{is};
 
     auto start = std::chrono::high_resolution_clock::now();
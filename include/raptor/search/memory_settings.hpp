@@ -0,0 +1,58 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include <raptor/shared.hpp>
+
+namespace raptor
+{
+
+/*!\brief Sets `parts_resident` and, if `derive_batch_size` is set, `batch_size` from the available memory.
+ * \param arguments The search arguments. `resources.memory`, `pattern_size` and `bin_path` must be set.
+ * \param part_sizes The size of each part of the index in memory (see detail::index_size()).
+ * \param partitioned Whether the index consists of several files.
+ * \param derive_batch_size Whether the batch size should be derived. Otherwise, `batch_size` is kept.
+ * \details
+ * All parts are kept in memory if they take at most half of it. Half of the memory that is not used by the index is
+ * used for reads. The batch size is at least 2^16 and at most the current `batch_size`.
+ * Nothing is changed if the available memory is unknown.
+ */
+inline void derive_memory_settings(search_arguments & arguments,
+                                   std::vector<uint64_t> const & part_sizes,
+                                   bool const partitioned,
+                                   bool const derive_batch_size)
+{
+    uint64_t const memory = arguments.resources.memory;
+
+    if (memory == 0u)
+        return;
+
+    uint64_t index_size{};
+    uint64_t largest_part{};
+    for (uint64_t const part_size : part_sizes)
+    {
+        index_size += part_size;
+        largest_part = std::max(largest_part, part_size);
+    }
+
+    arguments.parts_resident = partitioned && index_size <= memory / 2u;
+
+    if (!derive_batch_size)
+        return;
+
+    uint64_t const index_memory = arguments.parts_resident ? index_size : largest_part;
+    uint64_t const available = memory > index_memory ? (memory - index_memory) / 2u : 0u;
+    // The sequence, the ID, and, for partitioned indices, one 16 bit counter per bin.
+    uint64_t const bytes_per_read = arguments.pattern_size + 64u + (partitioned ? 2u * arguments.bin_path.size() : 0u);
+    arguments.batch_size = std::clamp<uint64_t>(available / bytes_per_read, 1ULL << 16, arguments.batch_size);
+}
+
+} // namespace raptor
@@ -0,0 +1,228 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
+
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/search/do_parallel.hpp>
+#include <raptor/search/load_index.hpp>
+#include <raptor/search/sync_out.hpp>
+#include <raptor/search/write_time.hpp>
+
+namespace raptor
+{
+
+namespace detail
+{
+
+/*!\brief Merges sorted runs of minimisers into a single sorted run without duplicates.
+ * \details Pairs of runs are merged concurrently until only one run is left.
+ */
+inline std::vector<uint64_t> merge_distinct_runs(std::vector<std::vector<uint64_t>> runs)
+{
+    if (runs.empty())
+        return {};
+
+    while (runs.size() > 1u)
+    {
+        std::vector<std::vector<uint64_t>> merged(runs.size() / 2u + runs.size() % 2u);
+        std::vector<std::future<void>> tasks;
+
+        for (size_t i = 0; i + 1u < runs.size(); i += 2u)
+        {
+            tasks.emplace_back(std::async(std::launch::async, [&runs, &merged, i] ()
+            {
+                auto & result = merged[i / 2u];
+                result.reserve(std::max(runs[i].size(), runs[i + 1u].size()));
+                std::set_union(runs[i].begin(), runs[i].end(),
+                               runs[i + 1u].begin(), runs[i + 1u].end(),
+                               std::back_inserter(result));
+                std::vector<uint64_t>{}.swap(runs[i]);
+                std::vector<uint64_t>{}.swap(runs[i + 1u]);
+            }));
+        }
+
+        if (runs.size() % 2u)
+            merged.back() = std::move(runs.back());
+
+        for (auto && task : tasks)
+            task.wait();
+
+        runs = std::move(merged);
+    }
+
+    return std::move(runs[0]);
+}
+
+} // namespace detail
+
+/*!\brief Computes the containment of whole query files in each bin.
+ * \details The distinct minimisers of each query file are collected (sort and deduplicate per thread, followed by a
+ *          parallel merge). Each distinct minimiser is then counted exactly once against the index and the fraction of
+ *          distinct minimisers found in a bin is reported as its containment score.
+ */
+template <bool compressed>
+void run_program_containment(search_arguments const & arguments)
+{
+    constexpr seqan3::data_layout data_layout_mode = compressed ? seqan3::data_layout::compressed :
+                                                                 seqan3::data_layout::uncompressed;
+    auto index = raptor_index<data_layout_mode>{};
+
+    double index_io_time{0.0};
+    double reads_io_time{0.0};
+    double compute_time{0.0};
+
+    sync_out synced_out{arguments.out_file};
+
+    {
+        size_t position{};
+        std::string line{};
+        for (auto const & file_list : arguments.bin_path)
+        {
+            line.clear();
+            line = '#';
+            line += std::to_string(position);
+            line += '\t';
+            for (auto const & filename : file_list)
+            {
+                line += filename;
+                line += ',';
+            }
+            line.back() = '\n';
+            synced_out << line;
+            ++position;
+        }
+        synced_out << "#QUERY_FILE\tDISTINCT_MINIMISERS\tCONTAINMENT\n";
+    }
+
+    auto distinct_minimisers = [&] (std::filesystem::path const & query_file)
+    {
+        seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::seq>> fin{query_file};
+        using record_type = typename decltype(fin)::record_type;
+        std::vector<record_type> records{};
+
+        std::vector<std::vector<uint64_t>> runs(arguments.threads);
+
+        auto worker = [&] (size_t const start, size_t const end)
+        {
+            if (start == end)
+                return;
+
+            // Each thread works on a contiguous slice, hence the slice start identifies the thread.
+            size_t const thread_id = std::min<size_t>(start / std::max<size_t>(1u, records.size() / arguments.threads),
+                                                      arguments.threads - 1u);
+            auto & run = runs[thread_id];
+            size_t const sorted_size = run.size();
+
+            detail::sequence_minimiser hasher{arguments.shape,
+                                              arguments.window_size,
+                                              adjust_seed(arguments.shape_weight)};
+            std::vector<uint64_t> minimiser{};
+
+            for (auto && [seq] : records | seqan3::views::slice(start, end))
+            {
+                hasher(seq, minimiser);
+                run.insert(run.end(), minimiser.begin(), minimiser.end());
+            }
+
+            std::sort(run.begin() + sorted_size, run.end());
+            std::inplace_merge(run.begin(), run.begin() + sorted_size, run.end());
+            run.erase(std::unique(run.begin(), run.end()), run.end());
+        };
+
+        for (auto && chunked_records : fin | seqan3::views::chunk(arguments.batch_size))
+        {
+            records.clear();
+            auto start = std::chrono::high_resolution_clock::now();
+            std::ranges::move(chunked_records, std::cpp20::back_inserter(records));
+            auto end = std::chrono::high_resolution_clock::now();
+            reads_io_time += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            do_parallel(worker, records.size(), arguments.threads, compute_time);
+        }
+
+        auto start = std::chrono::high_resolution_clock::now();
+        std::vector<uint64_t> result = detail::merge_distinct_runs(std::move(runs));
+        auto end = std::chrono::high_resolution_clock::now();
+        compute_time += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        return result;
+    };
+
+    std::vector<std::vector<uint64_t>> minimisers_per_file{};
+    for (auto const & query_file : arguments.query_files)
+        minimisers_per_file.emplace_back(distinct_minimisers(query_file));
+
+    std::vector<std::vector<uint64_t>> counts_per_file(minimisers_per_file.size());
+
+    auto count_part = [&] ()
+    {
+        for (size_t file_id = 0; file_id < minimisers_per_file.size(); ++file_id)
+        {
+            auto const & minimisers = minimisers_per_file[file_id];
+            auto & counts = counts_per_file[file_id];
+            counts.resize(index.ibf().bin_count(), 0u);
+            std::mutex counts_mutex{};
+
+            auto count_task = [&] (size_t const start, size_t const end)
+            {
+                auto counter = index.ibf().template counting_agent<uint64_t>();
+                auto & result = counter.bulk_count(minimisers | seqan3::views::slice(start, end));
+
+                std::lock_guard<std::mutex> lock{counts_mutex};
+                for (size_t bin = 0; bin < counts.size(); ++bin)
+                    counts[bin] += result[bin];
+            };
+
+            do_parallel(count_task, minimisers.size(), arguments.threads, compute_time);
+        }
+    };
+
+    if (arguments.parts == 1u)
+    {
+        load_index(index, arguments, index_io_time);
+        count_part();
+    }
+    else
+    {
+        for (size_t part{0}; part < arguments.parts; ++part)
+        {
+            load_index(index, arguments, part, index_io_time);
+            count_part();
+        }
+    }
+
+    for (size_t file_id = 0; file_id < minimisers_per_file.size(); ++file_id)
+    {
+        size_t const distinct_count{minimisers_per_file[file_id].size()};
+        std::ostringstream result_stream{};
+        result_stream << arguments.query_files[file_id].string() << '\t' << distinct_count << '\t'
+                      << std::fixed << std::setprecision(4);
+
+        for (auto && count : counts_per_file[file_id])
+            result_stream << (distinct_count ? count / static_cast<double>(distinct_count) : 0.0) << ',';
+
+        std::string result_string{result_stream.str()};
+        if (auto & last_char = result_string.back(); last_char == ',')
+            last_char = '\n';
+        else
+            result_string += '\n';
+        synced_out.write(result_string);
+    }
+
+    if (arguments.write_time)
+        write_time(arguments, index_io_time, reads_io_time, compute_time);
+}
+
+} // namespace raptor
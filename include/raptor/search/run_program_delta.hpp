@@ -0,0 +1,403 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+#include <robin_hood.h>
+
+#include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
+
+#include <raptor/detail/ibf_layout.hpp>
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/search/do_parallel.hpp>
+#include <raptor/search/load_index.hpp>
+#include <raptor/search/sync_out.hpp>
+#include <raptor/search/threshold.hpp>
+#include <raptor/search/write_time.hpp>
+
+namespace raptor
+{
+
+namespace detail
+{
+
+//!\brief Joins the file names of a bin in the same way as the header of the search output does.
+inline std::string bin_key(std::vector<std::string> const & file_list)
+{
+    std::string key{};
+    for (auto const & filename : file_list)
+    {
+        key += filename;
+        key += ',';
+    }
+    if (!key.empty())
+        key.pop_back();
+    return key;
+}
+
+/*!\brief The results of a previous search, translated to the bin numbering of the current index.
+ * \details
+ * The header of the previous output states which files were searched. All bins of the current index that are not
+ * listed there are new and need to be searched. Bins listed in the previous output must still be part of the index.
+ *
+ * The previous output lists the reads in the order of the query file, except that the reads of a batch may be
+ * reordered. Hence, the previous output is read alongside the query file: Lines are only read ahead until the
+ * requested read is found, and lines of other reads are kept until they are requested. At most `max_pending` lines
+ * are kept; a read that is not found within this window is reported as an error, since the previous output then
+ * belongs to another query file.
+ */
+class previous_results
+{
+public:
+    //!\brief The bins of the current index that did not take part in the previous search.
+    std::vector<size_t> new_bins{};
+
+    previous_results(std::filesystem::path const & previous_output,
+                     std::vector<std::vector<std::string>> const & bin_path,
+                     size_t const max_pending) :
+        istrm{previous_output},
+        max_pending{max_pending}
+    {
+        robin_hood::unordered_map<std::string, size_t> current_bin_ids{};
+        for (size_t bin = 0; bin < bin_path.size(); ++bin)
+            current_bin_ids.emplace(bin_key(bin_path[bin]), bin);
+
+        std::vector<bool> is_new(bin_path.size(), true);
+
+        while (std::getline(istrm, line) && line.starts_with('#'))
+        {
+            if (line.starts_with("#QUERY_NAME"))
+            {
+                line.clear();
+                break;
+            }
+
+            size_t const tab = line.find('\t');
+            std::string const key = line.substr(tab + 1u);
+            auto it = current_bin_ids.find(key);
+
+            if (tab == std::string::npos || it == current_bin_ids.end())
+                throw seqan3::argument_parser_error{"The bin " + key + " of the previous output is not part of the "
+                                                    "index."};
+
+            old_to_current.push_back(it->second);
+            is_new[it->second] = false;
+        }
+
+        for (size_t bin = 0; bin < is_new.size(); ++bin)
+            if (is_new[bin])
+                new_bins.push_back(bin);
+    }
+
+    /*!\brief Moves the previous hits of the read `id` into `hits`.
+     * \throws seqan3::argument_parser_error If the read is not found or a line cannot be parsed.
+     */
+    void take(std::string const & id, std::vector<size_t> & hits)
+    {
+        hits.clear();
+
+        if (auto it = pending.find(id); it != pending.end())
+        {
+            hits = std::move(it->second);
+            pending.erase(it);
+            return;
+        }
+
+        // The header loop may already have read the first line.
+        bool has_line = !line.empty() || std::getline(istrm, line);
+        for (; has_line; has_line = static_cast<bool>(std::getline(istrm, line)))
+        {
+            size_t const tab = line.find('\t');
+            if (tab == std::string::npos)
+                continue;
+
+            std::string_view const line_id{line.data(), tab};
+            std::string_view const bins = std::string_view{line}.substr(tab + 1u);
+
+            if (line_id == id)
+            {
+                parse_bins(id, bins, hits);
+                line.clear();
+                return;
+            }
+
+            if (pending.size() == max_pending)
+                break;
+
+            parse_bins(line_id, bins, pending.emplace(line_id, std::vector<size_t>{})->second);
+        }
+
+        throw seqan3::argument_parser_error{"The read " + id + " was not found in the previous output within " +
+                                            std::to_string(max_pending) + " reads. The previous output must be the "
+                                            "result of a search of the same query file."};
+    }
+
+private:
+    std::ifstream istrm;
+    //!\brief The maximal number of lines that are read ahead.
+    size_t max_pending{};
+    //!\brief The last line that was read but not yet processed.
+    std::string line{};
+    //!\brief Maps the bin numbers of the previous output to the current index.
+    std::vector<size_t> old_to_current{};
+    //!\brief Lines that were read ahead. A multimap, since the query file may contain a read ID more than once.
+    std::unordered_multimap<std::string, std::vector<size_t>> pending{};
+
+    void parse_bins(std::string_view const id, std::string_view bins, std::vector<size_t> & hits) const
+    {
+        while (!bins.empty())
+        {
+            size_t const comma = std::min(bins.find(','), bins.size());
+            if (comma)
+            {
+                size_t bin_id{};
+                auto const [end, error] = std::from_chars(bins.data(), bins.data() + comma, bin_id);
+
+                if (error != std::errc{} || end != bins.data() + comma || bin_id >= old_to_current.size())
+                    throw seqan3::argument_parser_error{"Cannot parse the bins of read " + std::string{id} +
+                                                        " in the previous output: \"" +
+                                                        std::string{bins.substr(0, comma)} +
+                                                        "\" is not a bin of the previous output."};
+
+                hits.push_back(old_to_current[bin_id]);
+            }
+            bins.remove_prefix(std::min(comma + 1u, bins.size()));
+        }
+    }
+};
+
+} // namespace detail
+
+/*!\brief Searches only the bins that were added to the index since a previous search and merges the results.
+ * \details
+ * Uncompressed indices are queried column-wise: Only the words of the IBF rows that contain new bins are accessed.
+ */
+template <bool compressed>
+void run_program_delta(search_arguments const & arguments)
+{
+    constexpr seqan3::data_layout data_layout_mode = compressed ? seqan3::data_layout::compressed :
+                                                                 seqan3::data_layout::uncompressed;
+    auto index = raptor_index<data_layout_mode>{};
+
+    double index_io_time{0.0};
+    double reads_io_time{0.0};
+    double compute_time{0.0};
+
+    std::future<void> cereal_handle{};
+    if (arguments.parts == 1u)
+    {
+        cereal_handle = std::async(std::launch::async, [&] ()
+        {
+            load_index(index, arguments, index_io_time);
+        });
+    }
+
+    // The reads of a batch may be reordered in the previous output. A few batches leave room for other batch sizes.
+    detail::previous_results previous{arguments.previous_output,
+                                      arguments.bin_path,
+                                      4u * arguments.batch_size};
+    std::vector<size_t> const & new_bins = previous.new_bins;
+    size_t const new_bin_count{new_bins.size()};
+
+    seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::id, seqan3::field::seq>> fin{arguments.query_file};
+    using record_type = typename decltype(fin)::record_type;
+    std::vector<record_type> records{};
+
+    sync_out synced_out{arguments.out_file};
+
+    {
+        size_t position{};
+        std::string line{};
+        for (auto const & file_list : arguments.bin_path)
+        {
+            line.clear();
+            line = '#';
+            line += std::to_string(position);
+            line += '\t';
+            for (auto const & filename : file_list)
+            {
+                line += filename;
+                line += ',';
+            }
+            line.back() = '\n';
+            synced_out << line;
+            ++position;
+        }
+        synced_out << "#QUERY_NAME\tUSER_BINS\n";
+    }
+
+    threshold const thresholder{arguments};
+
+    // The words of an IBF row that contain new bins, and which bits of these words belong to new bins.
+    std::vector<size_t> new_words{};
+    std::vector<uint64_t> new_word_masks{};
+    // Maps a bin to its position within new_bins.
+    std::vector<size_t> compact_id(arguments.bin_path.size(), 0u);
+    for (size_t i = 0; i < new_bin_count; ++i)
+    {
+        size_t const bin = new_bins[i];
+        compact_id[bin] = i;
+        if (new_words.empty() || new_words.back() != bin / 64u)
+        {
+            new_words.push_back(bin / 64u);
+            new_word_masks.push_back(0u);
+        }
+        new_word_masks.back() |= 1ULL << (bin % 64u);
+    }
+
+    std::vector<uint16_t> counts{};
+    std::vector<std::vector<size_t>> previous_hits{};
+    std::vector<size_t> minimiser_counts{};
+    std::vector<size_t> skipped_kmers{};
+
+    auto count_task = [&] (size_t const start, size_t const end)
+    {
+        auto & ibf = index.ibf();
+        std::vector<uint64_t> minimiser;
+
+        detail::sequence_minimiser hasher{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)};
+
+        if constexpr (compressed)
+        {
+            auto counter = ibf.template counting_agent<uint16_t>();
+
+            for (size_t record_id = start; record_id < end; ++record_id)
+            {
+                auto && [id, seq] = records[record_id];
+                (void) id;
+                hasher(seq, minimiser);
+                minimiser_counts[record_id] = minimiser.size();
+                skipped_kmers[record_id] = hasher.skipped_kmers();
+                auto & result = counter.bulk_count(minimiser);
+                uint16_t * const record_counts = counts.data() + record_id * new_bin_count;
+                for (size_t i = 0; i < new_bin_count; ++i)
+                    record_counts[i] += result[new_bins[i]];
+            }
+        }
+        else
+        {
+            detail::ibf_layout const layout{ibf};
+            uint64_t const * const data = ibf.raw_data().data();
+            std::array<size_t, 5> row_words{};
+
+            for (size_t record_id = start; record_id < end; ++record_id)
+            {
+                auto && [id, seq] = records[record_id];
+                (void) id;
+                hasher(seq, minimiser);
+                minimiser_counts[record_id] = minimiser.size();
+                skipped_kmers[record_id] = hasher.skipped_kmers();
+                uint16_t * const record_counts = counts.data() + record_id * new_bin_count;
+
+                for (uint64_t const value : minimiser)
+                {
+                    for (size_t i = 0; i < layout.hash_funs; ++i)
+                        row_words[i] = layout.row_word(value, i);
+
+                    for (size_t w = 0; w < new_words.size(); ++w)
+                    {
+                        uint64_t bits{new_word_masks[w]};
+                        for (size_t i = 0; i < layout.hash_funs; ++i)
+                            bits &= data[row_words[i] + new_words[w]];
+
+                        for (; bits; bits &= bits - 1u)
+                            ++record_counts[compact_id[new_words[w] * 64u + std::countr_zero(bits)]];
+                    }
+                }
+            }
+        }
+    };
+
+    auto output_task = [&] (size_t const start, size_t const end)
+    {
+        std::string result_string{};
+        std::vector<size_t> hits{};
+        std::vector<size_t> thresholds(arguments.bin_path.size());
+
+        for (size_t record_id = start; record_id < end; ++record_id)
+        {
+            auto const & [id, seq] = records[record_id];
+            (void) seq;
+            hits = std::move(previous_hits[record_id]);
+            result_string.clear();
+            result_string += id;
+            result_string += '\t';
+
+            size_t const minimiser_count{minimiser_counts[record_id]};
+            thresholder.get(minimiser_count, thresholds, skipped_kmers[record_id]);
+
+            uint16_t const * const record_counts = counts.data() + record_id * new_bin_count;
+            for (size_t i = 0; i < new_bin_count; ++i)
+                if (record_counts[i] >= thresholds[new_bins[i]])
+                    hits.push_back(new_bins[i]);
+
+            std::sort(hits.begin(), hits.end());
+            for (size_t const bin : hits)
+            {
+                result_string += std::to_string(bin);
+                result_string += ',';
+            }
+
+            if (auto & last_char = result_string.back(); last_char == ',')
+                last_char = '\n';
+            else
+                result_string += '\n';
+            synced_out.write(result_string);
+        }
+    };
+
+    for (auto && chunked_records : fin | seqan3::views::chunk(arguments.batch_size))
+    {
+        records.clear();
+        auto start = std::chrono::high_resolution_clock::now();
+        std::ranges::move(chunked_records, std::cpp20::back_inserter(records));
+        auto end = std::chrono::high_resolution_clock::now();
+        reads_io_time += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        previous_hits.resize(records.size());
+        for (size_t record_id = 0; record_id < records.size(); ++record_id)
+        {
+            auto const & [id, seq] = records[record_id];
+            (void) seq;
+            previous.take(id, previous_hits[record_id]);
+        }
+
+        counts.assign(records.size() * new_bin_count, 0u);
+        minimiser_counts.assign(records.size(), 0u);
+        skipped_kmers.assign(records.size(), 0u);
+
+        if (new_bin_count)
+        {
+            if (arguments.parts == 1u)
+            {
+                cereal_handle.wait();
+                do_parallel(count_task, records.size(), arguments.threads, compute_time);
+            }
+            else
+            {
+                for (size_t part{0}; part < arguments.parts; ++part)
+                {
+                    load_index(index, arguments, part, index_io_time);
+                    do_parallel(count_task, records.size(), arguments.threads, compute_time);
+                }
+            }
+        }
+
+        do_parallel(output_task, records.size(), arguments.threads, compute_time);
+    }
+
+    if (arguments.write_time)
+        write_time(arguments, index_io_time, reads_io_time, compute_time);
+}
+
+} // namespace raptor
@@ -0,0 +1,369 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <future>
+#include <iomanip>
+
+
+#include <raptor/detail/block_compression.hpp>
+#include <raptor/detail/ibf_layout.hpp>
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/detail/version_store.hpp>
+#include <raptor/index.hpp>
+#include <raptor/search/do_parallel.hpp>
+#include <raptor/search/sync_out.hpp>
+#include <raptor/search/threshold.hpp>
+#include <raptor/search/write_time.hpp>
+
+namespace raptor
+{
+
+namespace detail
+{
+
+/*!\brief Gives access to the rows of a serialised, uncompressed IBF without loading it.
+ * \details
+ * The bit vector of the IBF is the last member of a serialised raptor_index. Its words are stored as raw binary data
+ * directly following its size and width. Hence, the file offset of each row is known after reading the parameters.
+ */
+class ibf_file
+{
+public:
+    ibf_layout layout{};
+
+    ibf_file() = default;
+    ibf_file(ibf_file const &) = delete;
+    ibf_file(ibf_file &&) = default;
+    ibf_file & operator=(ibf_file const &) = delete;
+    ibf_file & operator=(ibf_file &&) = default;
+    ~ibf_file() = default;
+
+    explicit ibf_file(std::filesystem::path const & path) : stream{path, std::ios::binary}
+    {
+        if (is_block_compressed(stream))
+            throw seqan3::argument_parser_error{"--out-of-core cannot be used with block-compressed indices."};
+        if (is_versioned(stream))
+            throw seqan3::argument_parser_error{"--out-of-core cannot be used with versioned indices."};
+
+        cereal::BinaryInputArchive iarchive{stream};
+        raptor_index<> index{};
+        index.load_parameters(iarchive);
+
+        if (index.compressed())
+            throw seqan3::argument_parser_error{"--out-of-core can only be used with uncompressed indices."};
+
+        size_t bins{};
+        size_t technical_bins{};
+        size_t bin_size{};
+        size_t hash_shift{};
+        size_t bin_words{};
+        size_t hash_funs{};
+        iarchive(bins, technical_bins, bin_size, hash_shift, bin_words, hash_funs);
+
+        uint64_t bit_count{};
+        uint8_t width{};
+        iarchive(bit_count, width);
+
+        layout = ibf_layout{bins, bin_size, hash_funs};
+        payload_offset = stream.tellg();
+
+        if (layout.bin_words != bin_words || bit_count != layout.word_count() * 64u)
+            throw seqan3::argument_parser_error{"Cannot read index: Unexpected layout of " + path.string() + '.'};
+    }
+
+    //!\brief Reads `row_count` consecutive rows starting at `first_row` into `buffer`.
+    void read_rows(size_t const first_row, size_t const row_count, std::vector<uint64_t> & buffer)
+    {
+        buffer.resize(row_count * layout.bin_words);
+        stream.seekg(payload_offset + static_cast<std::streamoff>(first_row * layout.bin_words * sizeof(uint64_t)));
+        stream.read(reinterpret_cast<char *>(buffer.data()), buffer.size() * sizeof(uint64_t));
+
+        if (!stream)
+            throw seqan3::argument_parser_error{"Cannot read index: Unexpected end of file."}; // LCOV_EXCL_LINE
+    }
+
+private:
+    std::ifstream stream{};
+    std::streamoff payload_offset{};
+};
+
+/*!\brief Computes the AND of the rows of each value, i.e., the bins each value is contained in.
+ * \param[in] file The IBF on disk.
+ * \param[in] values The sorted, distinct values to look up.
+ * \param[out] membership For each value, `bin_words` words in which a set bit means that the value is in the bin.
+ * \details
+ * All (row, value) lookups are sorted by row, such that the file is read sequentially in blocks. Blocks that contain
+ * no requested row are skipped. The next block is read while the current one is processed.
+ */
+inline void resolve_rows(ibf_file & file, std::vector<uint64_t> const & values, std::vector<uint64_t> & membership)
+{
+    static constexpr size_t block_bytes{64ULL << 20};
+
+    ibf_layout const & layout = file.layout;
+    size_t const block_rows = std::max<size_t>(1u, block_bytes / (layout.bin_words * sizeof(uint64_t)));
+
+    struct lookup
+    {
+        size_t row;
+        size_t value_id;
+
+        bool operator<(lookup const & other) const noexcept
+        {
+            return row < other.row;
+        }
+    };
+
+    std::vector<lookup> lookups{};
+    lookups.reserve(values.size() * layout.hash_funs);
+    for (size_t value_id = 0; value_id < values.size(); ++value_id)
+        for (size_t i = 0; i < layout.hash_funs; ++i)
+            lookups.push_back(lookup{layout.row(values[value_id], i), value_id});
+    std::sort(lookups.begin(), lookups.end());
+
+    membership.assign(values.size() * layout.bin_words, ~0ULL);
+    if (lookups.empty())
+        return;
+
+    auto block_of = [&] (size_t const position) { return lookups[position].row / block_rows; };
+    auto read_block = [&] (size_t const block, std::vector<uint64_t> & buffer)
+    {
+        size_t const first_row = block * block_rows;
+        file.read_rows(first_row, std::min(block_rows, layout.bin_size - first_row), buffer);
+    };
+
+    std::vector<uint64_t> current{};
+    std::vector<uint64_t> next{};
+    size_t current_block = block_of(0u);
+    read_block(current_block, current);
+
+    for (size_t begin = 0, end = 0; begin < lookups.size(); begin = end)
+    {
+        while (end < lookups.size() && block_of(end) == current_block)
+            ++end;
+
+        size_t next_block{};
+        std::future<void> prefetch{};
+        if (end < lookups.size())
+        {
+            next_block = block_of(end);
+            prefetch = std::async(std::launch::async, read_block, next_block, std::ref(next));
+        }
+
+        size_t const first_row = current_block * block_rows;
+        for (size_t position = begin; position < end; ++position)
+        {
+            uint64_t const * const row = current.data() + (lookups[position].row - first_row) * layout.bin_words;
+            uint64_t * const target = membership.data() + lookups[position].value_id * layout.bin_words;
+            for (size_t word = 0; word < layout.bin_words; ++word)
+                target[word] &= row[word];
+        }
+
+        if (prefetch.valid())
+        {
+            prefetch.get();
+            std::swap(current, next);
+            current_block = next_block;
+        }
+    }
+}
+
+} // namespace detail
+
+/*!\brief Searches an uncompressed index without loading it into memory.
+ * \details
+ * Reads are processed in batches that fit into `arguments.memory_budget` MiB. For each batch, the distinct minimisers
+ * of all reads are resolved with one sequential pass over each index file (see detail::resolve_rows). Afterwards,
+ * the bin memberships of the minimisers of each read are counted.
+ */
+inline void run_program_out_of_core(search_arguments const & arguments)
+{
+    seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::id, seqan3::field::seq>> fin{arguments.query_file};
+    using record_type = typename decltype(fin)::record_type;
+    std::vector<record_type> records{};
+
+    double index_io_time{0.0};
+    double reads_io_time{0.0};
+    double compute_time{0.0};
+
+    std::vector<detail::ibf_file> files{};
+    if (arguments.parts == 1u)
+    {
+        files.emplace_back(arguments.index_file);
+    }
+    else
+    {
+        for (size_t part{0}; part < arguments.parts; ++part)
+            files.emplace_back(arguments.index_file.string() + "_" + std::to_string(part));
+    }
+
+    size_t const bin_count{arguments.bin_path.size()};
+    size_t const bin_words{files[0].layout.bin_words};
+
+    threshold const thresholder{arguments};
+
+    sync_out synced_out{arguments.out_file};
+
+    {
+        size_t position{};
+        std::string line{};
+        for (auto const & file_list : arguments.bin_path)
+        {
+            line.clear();
+            line = '#';
+            line += std::to_string(position);
+            line += '\t';
+            for (auto const & filename : file_list)
+            {
+                line += filename;
+                line += ',';
+            }
+            line.back() = '\n';
+            synced_out << line;
+            ++position;
+        }
+        synced_out << "#QUERY_NAME\tUSER_BINS\n";
+    }
+
+    // Upper bound for the memory needed per minimiser: its value, the lookups, and its bin memberships.
+    size_t const bytes_per_minimiser = 2u * sizeof(uint64_t) +
+                                       files[0].layout.hash_funs * 2u * sizeof(size_t) +
+                                       bin_words * sizeof(uint64_t);
+    size_t const memory_budget = arguments.memory_budget << 20;
+
+    std::vector<std::vector<uint64_t>> minimisers{};
+    std::vector<size_t> skipped_kmers{};
+    std::vector<uint64_t> distinct_minimisers{};
+    std::vector<uint64_t> membership{};
+    std::vector<uint16_t> counts{};
+
+    auto hash_task = [&] (size_t const start, size_t const end)
+    {
+        detail::sequence_minimiser hasher{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)};
+
+        for (size_t record_id = start; record_id < end; ++record_id)
+        {
+            auto && [id, seq] = records[record_id];
+            (void) id;
+            hasher(seq, minimisers[record_id]);
+            skipped_kmers[record_id] = hasher.skipped_kmers();
+        }
+    };
+
+    auto count_task = [&] (size_t const start, size_t const end)
+    {
+        for (size_t record_id = start; record_id < end; ++record_id)
+        {
+            uint16_t * const record_counts = counts.data() + record_id * bin_count;
+
+            for (uint64_t const value : minimisers[record_id])
+            {
+                size_t const value_id = std::lower_bound(distinct_minimisers.begin(),
+                                                         distinct_minimisers.end(),
+                                                         value) - distinct_minimisers.begin();
+                uint64_t const * const bins = membership.data() + value_id * bin_words;
+
+                for (size_t word = 0; word < bin_words; ++word)
+                    for (uint64_t bits = bins[word]; bits; bits &= bits - 1u)
+                        ++record_counts[word * 64u + std::countr_zero(bits)];
+            }
+        }
+    };
+
+    auto output_task = [&] (size_t const start, size_t const end)
+    {
+        std::string result_string{};
+        std::vector<size_t> thresholds(bin_count);
+
+        for (size_t record_id = start; record_id < end; ++record_id)
+        {
+            auto const & [id, seq] = records[record_id];
+            (void) seq;
+            result_string.clear();
+            result_string += id;
+            result_string += '\t';
+
+            size_t const minimiser_count{minimisers[record_id].size()};
+            thresholder.get(minimiser_count, thresholds, skipped_kmers[record_id]);
+
+            uint16_t const * const record_counts = counts.data() + record_id * bin_count;
+            for (size_t bin = 0; bin < bin_count; ++bin)
+            {
+                if (record_counts[bin] >= thresholds[bin])
+                {
+                    result_string += std::to_string(bin);
+                    result_string += ',';
+                }
+            }
+
+            if (auto & last_char = result_string.back(); last_char == ',')
+                last_char = '\n';
+            else
+                result_string += '\n';
+            synced_out.write(result_string);
+        }
+    };
+
+    auto record_it = fin.begin();
+    while (record_it != fin.end())
+    {
+        records.clear();
+        size_t estimated_bytes{};
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (; record_it != fin.end() && (records.empty() || estimated_bytes < memory_budget); ++record_it)
+        {
+            auto && [id, seq] = *record_it;
+            (void) id;
+            size_t const sequence_length = std::ranges::size(seq);
+            size_t const max_minimisers = sequence_length > arguments.window_size ?
+                                              sequence_length - arguments.window_size + 1u :
+                                              1u;
+            estimated_bytes += max_minimisers * bytes_per_minimiser + bin_count * sizeof(uint16_t);
+            records.push_back(std::move(*record_it));
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        reads_io_time += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        minimisers.assign(records.size(), std::vector<uint64_t>{});
+        skipped_kmers.assign(records.size(), 0u);
+        do_parallel(hash_task, records.size(), arguments.threads, compute_time);
+
+        start = std::chrono::high_resolution_clock::now();
+        distinct_minimisers.clear();
+        for (auto const & record_minimisers : minimisers)
+            distinct_minimisers.insert(distinct_minimisers.end(), record_minimisers.begin(), record_minimisers.end());
+        std::sort(distinct_minimisers.begin(), distinct_minimisers.end());
+        distinct_minimisers.erase(std::unique(distinct_minimisers.begin(), distinct_minimisers.end()),
+                                  distinct_minimisers.end());
+        end = std::chrono::high_resolution_clock::now();
+        compute_time += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+        counts.assign(records.size() * bin_count, 0u);
+
+        for (auto & file : files)
+        {
+            start = std::chrono::high_resolution_clock::now();
+            detail::resolve_rows(file, distinct_minimisers, membership);
+            end = std::chrono::high_resolution_clock::now();
+            index_io_time += std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
+
+            do_parallel(count_task, records.size(), arguments.threads, compute_time);
+        }
+
+        do_parallel(output_task, records.size(), arguments.threads, compute_time);
+    }
+
+    if (arguments.write_time)
+        write_time(arguments, index_io_time, reads_io_time, compute_time);
+}
+
+} // namespace raptor
@@ -7,13 +7,19 @@
 
 #pragma once
 
+#include <optional>
+
 #include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
-#include <seqan3/search/views/minimiser_hash.hpp>
 
-#include <raptor/search/compute_simple_model.hpp>
+#include <raptor/search/auto_tune.hpp>
+#include <raptor/search/detail/abundance_estimator.hpp>
+#include <raptor/search/detail/bin_major_writer.hpp>
+#include <raptor/search/detail/heuristic_threshold.hpp>
 #include <raptor/search/do_parallel.hpp>
 #include <raptor/search/load_index.hpp>
 #include <raptor/search/sync_out.hpp>
+#include <raptor/search/threshold.hpp>
+#include <raptor/search/write_time.hpp>
 
 namespace raptor
 {
@@ -35,7 +41,7 @@ void run_program_single(search_arguments const & arguments)
     };
     auto cereal_handle = std::async(std::launch::async, cereal_worker);
 
-    seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::id, seqan3::field::seq>> fin{arguments.query_file};
+    seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::id, seqan3::field::seq>> fin{arguments.query_file};
     using record_type = typename decltype(fin)::record_type;
     std::vector<record_type> records{};
 
@@ -59,18 +65,28 @@ void run_program_single(search_arguments const & arguments)
             synced_out << line;
             ++position;
         }
-        synced_out << "#QUERY_NAME\tUSER_BINS\n";
+        if (arguments.bin_major)
+            synced_out << "#BIN\tQUERY_NAMES\n";
+        else if (!arguments.abundance) // The estimator writes its own column names.
+            synced_out << "#QUERY_NAME\tUSER_BINS\n";
     }
 
-    size_t const kmers_per_window = arguments.window_size - arguments.shape_size + 1;
-    size_t const kmers_per_pattern = arguments.pattern_size - arguments.shape_size + 1;
-    size_t const min_number_of_minimisers = kmers_per_window == 1 ? kmers_per_pattern :
-                                                std::ceil(kmers_per_pattern / static_cast<double>(kmers_per_window));
-    size_t const kmer_lemma = arguments.pattern_size + 1u > (arguments.errors + 1u) * arguments.shape_size ?
-                                arguments.pattern_size + 1u - (arguments.errors + 1u) * arguments.shape_size :
-                                0;
-    size_t const max_number_of_minimisers = arguments.pattern_size - arguments.window_size + 1;
-    std::vector<size_t> const precomp_thresholds = compute_simple_model(arguments);
+    std::optional<detail::bin_major_writer> bin_major_writer{};
+    if (arguments.bin_major)
+        bin_major_writer.emplace(arguments.out_file,
+                                 arguments.bin_path.size(),
+                                 arguments.memory_budget << 20,
+                                 arguments.threads);
+    std::optional<detail::abundance_estimator> abundance_estimator{};
+    if (arguments.abundance)
+        abundance_estimator.emplace(arguments.bin_path.size());
+    size_t processed_records{};
+
+    // With --auto-tune, the number of threads is calibrated on the first batch of reads.
+    uint8_t threads{arguments.threads};
+    bool calibrate{arguments.auto_tune};
+
+    threshold const thresholder{arguments};
 
     auto worker = [&] (size_t const start, size_t const end)
     {
@@ -78,10 +94,16 @@ void run_program_single(search_arguments const & arguments)
         auto counter = ibf.template counting_agent<uint16_t>();
         std::string result_string{};
         std::vector<uint64_t> minimiser;
+        std::vector<size_t> thresholds(arguments.bin_path.size());
+        detail::heuristic_threshold heuristic{arguments};
+        std::optional<detail::bin_major_writer::agent> agent{};
+        if (bin_major_writer)
+            agent.emplace(*bin_major_writer, processed_records + start);
+        std::optional<detail::abundance_estimator::agent> abundance_agent{};
+        if (abundance_estimator)
+            abundance_agent.emplace(*abundance_estimator);
 
-        auto hash_view = seqan3::views::minimiser_hash(arguments.shape,
-                                                       seqan3::window_size{arguments.window_size},
-                                                       seqan3::seed{adjust_seed(arguments.shape_weight)});
+        detail::sequence_minimiser hasher{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)};
 
         for (auto && [id, seq] : records | seqan3::views::slice(start, end))
         {
@@ -90,29 +112,47 @@ void run_program_single(search_arguments const & arguments)
             result_string += id;
             result_string += '\t';
 
-            minimiser = seq | hash_view | seqan3::views::to<std::vector<uint64_t>>;
+            if (arguments.heuristic_threshold)
+                heuristic.compute_minimiser(seq, minimiser);
+            else
+                hasher(seq, minimiser);
             auto & result = counter.bulk_count(minimiser);
             size_t const minimiser_count{minimiser.size()};
             size_t current_bin{0};
 
-            size_t const threshold = arguments.treshold_was_set ?
-                                         static_cast<size_t>(minimiser_count * arguments.threshold) :
-                                         kmers_per_window == 1 ? kmer_lemma :
-                                         precomp_thresholds[std::min(minimiser_count < min_number_of_minimisers ?
-                                                                         0 :
-                                                                         minimiser_count - min_number_of_minimisers,
-                                                                     max_number_of_minimisers -
-                                                                         min_number_of_minimisers)] + 2;
+            if (arguments.heuristic_threshold)
+                thresholder.get(minimiser_count, heuristic.get(), thresholds);
+            else
+                thresholder.get(minimiser_count, thresholds, hasher.skipped_kmers());
 
             for (auto && count : result)
             {
-                if (count >= threshold)
+                if (count >= thresholds[current_bin])
                 {
-                    result_string += std::to_string(current_bin);
-                    result_string += ',';
+                    if (agent)
+                    {
+                        agent->add(current_bin, id);
+                    }
+                    else if (abundance_agent)
+                    {
+                        abundance_agent->add(current_bin);
+                    }
+                    else
+                    {
+                        result_string += std::to_string(current_bin);
+                        result_string += ',';
+                    }
                 }
                 ++current_bin;
             }
+            if (abundance_agent)
+            {
+                abundance_agent->next_read();
+                continue;
+            }
+            if (agent)
+                continue;
+
             if (auto & last_char = result_string.back(); last_char == ',')
                 last_char = '\n';
             else
@@ -121,7 +161,7 @@ void run_program_single(search_arguments const & arguments)
         }
     };
 
-    for (auto && chunked_records : fin | seqan3::views::chunk((1ULL<<20)*10))
+    for (auto && chunked_records : fin | seqan3::views::chunk(arguments.batch_size))
     {
         records.clear();
         auto start = std::chrono::high_resolution_clock::now();
@@ -131,23 +171,25 @@ void run_program_single(search_arguments const & arguments)
 
         cereal_handle.wait();
 
-        do_parallel(worker, records.size(), arguments.threads, compute_time);
+        if (calibrate)
+        {
+            threads = detail::calibrate_threads(index.ibf(), records, arguments);
+            detail::tuning_cache{arguments}.set(threads);
+            calibrate = false;
+        }
+
+        do_parallel(worker, records.size(), threads, compute_time);
+        processed_records += records.size();
     }
 
-// LCOV_EXCL_START
+    if (bin_major_writer)
+        bin_major_writer->write(synced_out);
+
+    if (abundance_estimator)
+        abundance_estimator->write(synced_out);
+
     if (arguments.write_time)
-    {
-        std::filesystem::path file_path{arguments.out_file};
-        file_path += ".time";
-        std::ofstream file_handle{file_path};
-        file_handle << "Index I/O\tReads I/O\tCompute\n";
-        file_handle << std::fixed
-                    << std::setprecision(2)
-                    << index_io_time << '\t'
-                    << reads_io_time << '\t'
-                    << compute_time;
-    }
-// LCOV_EXCL_END
+        write_time(arguments, index_io_time, reads_io_time, compute_time);
 }
 
 } // namespace raptor
@@ -8,12 +8,13 @@
 #pragma once
 
 #include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
-#include <seqan3/search/views/minimiser_hash.hpp>
 
+#include <raptor/detail/streaming_minimiser.hpp>
 #include <raptor/search/compute_simple_model.hpp>
 #include <raptor/search/do_parallel.hpp>
 #include <raptor/search/load_index.hpp>
 #include <raptor/search/sync_out.hpp>
+#include <raptor/search/write_time.hpp>
 
 namespace raptor
 {
@@ -35,7 +36,7 @@ void run_program_single_socks(search_arguments const & arguments)
     };
     auto cereal_handle = std::async(std::launch::async, cereal_worker);
 
-    std::vector<std::vector<seqan3::dna4>> records{};
+    std::vector<std::vector<seqan3::dna5>> records{};
 
     std::ifstream fin{arguments.query_file};
 
@@ -46,10 +47,9 @@ void run_program_single_socks(search_arguments const & arguments)
         auto & ibf = index.ibf();
         auto counter = ibf.template counting_agent<uint8_t>();
         std::string result_string{};
+        std::vector<uint64_t> minimiser{};
 
-        auto hash_view = seqan3::views::minimiser_hash(arguments.shape,
-                                                       seqan3::window_size{arguments.window_size},
-                                                       seqan3::seed{adjust_seed(arguments.shape_weight)});
+        detail::sequence_minimiser hasher{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)};
 
         for (auto && seq : records | seqan3::views::slice(start, end))
         {
@@ -58,7 +58,8 @@ void run_program_single_socks(search_arguments const & arguments)
                 result_string += seqan3::to_char(elem);
             result_string += ": ";
 
-            auto & result = counter.bulk_count(seq | hash_view);
+            hasher(seq, minimiser);
+            auto & result = counter.bulk_count(minimiser);
 
             constexpr int8_t int_to_char_offset{'0'}; // ASCII offset (usually 48), std::to_string is slow
             for (auto const & elem : result)
@@ -76,9 +77,9 @@ void run_program_single_socks(search_arguments const & arguments)
         size_t entries{};
 
         auto start = std::chrono::high_resolution_clock::now();
-        while (entries < (1ULL<<20)*10 && std::getline(fin, line))
+        while (entries < arguments.batch_size && std::getline(fin, line))
         {
-            auto v = line | seqan3::views::char_to<seqan3::dna4>;
+            auto v = line | seqan3::views::char_to<seqan3::dna5>;
             records.emplace_back(v.begin(), v.end());
             ++entries;
         }
@@ -90,20 +91,8 @@ void run_program_single_socks(search_arguments const & arguments)
         do_parallel(worker, records.size(), arguments.threads, compute_time);
     }
 
-// LCOV_EXCL_START
     if (arguments.write_time)
-    {
-        std::filesystem::path file_path{arguments.out_file};
-        file_path += ".time";
-        std::ofstream file_handle{file_path};
-        file_handle << "Index I/O\tReads I/O\tCompute\n";
-        file_handle << std::fixed
-                    << std::setprecision(2)
-                    << index_io_time << '\t'
-                    << reads_io_time << '\t'
-                    << compute_time;
-    }
-// LCOV_EXCL_END
+        write_time(arguments, index_io_time, reads_io_time, compute_time);
 }
 
 } // namespace raptor
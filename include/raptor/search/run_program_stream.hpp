@@ -0,0 +1,256 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
+
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/search/load_index.hpp>
+#include <raptor/search/sync_out.hpp>
+#include <raptor/search/threshold.hpp>
+
+namespace raptor
+{
+
+//!\brief The latencies measured by stream_search.
+struct stream_statistics
+{
+    //!\brief The latency of each read in milliseconds, i.e. the time from having read the record until `on_result`
+    //!       returned.
+    std::vector<double> latencies{};
+    //!\brief The number of reads that waited at least `--deadline` milliseconds for their micro-batch.
+    size_t expired{};
+};
+
+/*!\brief Classifies reads as soon as they arrive.
+ * \param[in] arguments The search arguments.
+ * \param[in] on_result Called with the read ID and the list of bins for each read. Called concurrently.
+ * \returns The latencies and the number of reads whose deadline expired.
+ * \details
+ * All parts of the index are kept in memory. Records are queued by a reader thread as they become available, e.g.,
+ * when reading from a named pipe. Each worker thread takes up to `arguments.micro_batch_size` records from the queue,
+ * but does not wait longer than `arguments.deadline` milliseconds for a micro-batch to fill up.
+ */
+template <bool compressed, typename callback_t>
+stream_statistics stream_search(search_arguments const & arguments, callback_t && on_result)
+{
+    constexpr seqan3::data_layout data_layout_mode = compressed ? seqan3::data_layout::compressed :
+                                                                 seqan3::data_layout::uncompressed;
+    using clock_t = std::chrono::steady_clock;
+
+    double index_io_time{0.0};
+    std::vector<raptor_index<data_layout_mode>> indices(arguments.parts);
+    if (arguments.parts == 1u)
+    {
+        load_index(indices[0], arguments, index_io_time);
+    }
+    else
+    {
+        for (size_t part{0}; part < arguments.parts; ++part)
+            load_index(indices[part], arguments, part, index_io_time);
+    }
+
+    threshold const thresholder{arguments};
+
+    struct queued_record
+    {
+        std::string id;
+        std::vector<seqan3::dna5> seq;
+        clock_t::time_point arrival;
+    };
+
+    std::deque<queued_record> queue{};
+    std::mutex queue_mutex{};
+    std::condition_variable queue_cv{};
+    bool finished{false};
+    auto const deadline = std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double, std::milli>{arguments.deadline});
+
+    std::vector<std::vector<double>> latencies(arguments.threads);
+    std::vector<size_t> expired(arguments.threads);
+
+    auto worker = [&] (size_t const thread_id)
+    {
+        std::vector<queued_record> batch{};
+        std::vector<uint64_t> minimiser{};
+        std::vector<size_t> bins{};
+        std::vector<size_t> thresholds(arguments.bin_path.size());
+        seqan3::counting_vector<uint16_t> counts(indices[0].ibf().bin_count(), 0);
+
+        std::vector<decltype(indices[0].ibf().template counting_agent<uint16_t>())> counters{};
+        for (auto & index : indices)
+            counters.push_back(index.ibf().template counting_agent<uint16_t>());
+
+        detail::sequence_minimiser hasher{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)};
+
+        while (true)
+        {
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> lock{queue_mutex};
+                while (true)
+                {
+                    if (queue.size() >= arguments.micro_batch_size || (finished && !queue.empty()))
+                        break;
+                    if (finished)
+                        return;
+                    if (queue.empty())
+                    {
+                        queue_cv.wait(lock);
+                        continue;
+                    }
+                    auto const due = queue.front().arrival + deadline;
+                    if (clock_t::now() >= due)
+                        break;
+                    queue_cv.wait_until(lock, due);
+                }
+
+                size_t const batch_size = std::min<size_t>(queue.size(), arguments.micro_batch_size);
+                std::move(queue.begin(), queue.begin() + batch_size, std::back_inserter(batch));
+                queue.erase(queue.begin(), queue.begin() + batch_size);
+            }
+
+            auto const dispatch = clock_t::now();
+            expired[thread_id] += std::count_if(batch.begin(), batch.end(), [&] (queued_record const & record)
+            {
+                return dispatch - record.arrival >= deadline;
+            });
+
+            for (auto & record : batch)
+            {
+                hasher(record.seq, minimiser);
+                std::fill(counts.begin(), counts.end(), 0);
+                for (auto & counter : counters)
+                    counts += counter.bulk_count(minimiser);
+
+                size_t const minimiser_count{minimiser.size()};
+                thresholder.get(minimiser_count, thresholds, hasher.skipped_kmers());
+
+                bins.clear();
+                for (size_t bin = 0; bin < counts.size(); ++bin)
+                    if (counts[bin] >= thresholds[bin])
+                        bins.push_back(bin);
+
+                on_result(record.id, bins);
+
+                latencies[thread_id].push_back(std::chrono::duration<double, std::milli>{clock_t::now() -
+                                                                                         record.arrival}.count());
+            }
+        }
+    };
+
+    std::vector<std::thread> workers{};
+    for (size_t thread_id = 0; thread_id < arguments.threads; ++thread_id)
+        workers.emplace_back(worker, thread_id);
+
+    seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::id, seqan3::field::seq>> fin{arguments.query_file};
+    for (auto && [id, seq] : fin)
+    {
+        {
+            std::lock_guard<std::mutex> lock{queue_mutex};
+            queue.push_back(queued_record{std::move(id), std::move(seq), clock_t::now()});
+        }
+        queue_cv.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{queue_mutex};
+        finished = true;
+    }
+    queue_cv.notify_all();
+
+    for (auto && thread : workers)
+        thread.join();
+
+    stream_statistics result{};
+    for (size_t thread_id = 0; thread_id < arguments.threads; ++thread_id)
+    {
+        result.latencies.insert(result.latencies.end(), latencies[thread_id].begin(), latencies[thread_id].end());
+        result.expired += expired[thread_id];
+    }
+    return result;
+}
+
+/*!\brief Runs stream_search and writes the results and a latency report.
+ * \details Each result is flushed immediately, such that the output may be consumed via a named pipe.
+ *          The latency report is written to `<output>.latency`.
+ */
+template <bool compressed>
+void run_program_stream(search_arguments const & arguments)
+{
+    sync_out synced_out{arguments.out_file};
+
+    {
+        size_t position{};
+        std::string line{};
+        for (auto const & file_list : arguments.bin_path)
+        {
+            line.clear();
+            line = '#';
+            line += std::to_string(position);
+            line += '\t';
+            for (auto const & filename : file_list)
+            {
+                line += filename;
+                line += ',';
+            }
+            line.back() = '\n';
+            synced_out << line;
+            ++position;
+        }
+        synced_out.write_and_flush("#QUERY_NAME\tUSER_BINS\n");
+    }
+
+    auto on_result = [&synced_out] (std::string const & id, std::vector<size_t> const & bins)
+    {
+        std::string result_string{id};
+        result_string += '\t';
+        for (size_t const bin : bins)
+        {
+            result_string += std::to_string(bin);
+            result_string += ',';
+        }
+        if (auto & last_char = result_string.back(); last_char == ',')
+            last_char = '\n';
+        else
+            result_string += '\n';
+        synced_out.write_and_flush(result_string);
+    };
+
+    stream_statistics statistics = stream_search<compressed>(arguments, on_result);
+    std::vector<double> & latencies = statistics.latencies;
+
+    auto percentile = [&latencies] (double const p)
+    {
+        if (latencies.empty())
+            return 0.0;
+        auto nth = latencies.begin() + static_cast<size_t>(p * (latencies.size() - 1));
+        std::nth_element(latencies.begin(), nth, latencies.end());
+        return *nth;
+    };
+
+    std::filesystem::path file_path{arguments.out_file};
+    file_path += ".latency";
+    std::ofstream file_handle{file_path};
+    file_handle << "Reads\tp50 (ms)\tp99 (ms)\tMax (ms)\tDeadline expired\n";
+    file_handle << latencies.size() << '\t'
+                << std::fixed
+                << std::setprecision(3)
+                << percentile(0.50) << '\t'
+                << percentile(0.99) << '\t'
+                << percentile(1.0) << '\t'
+                << statistics.expired << '\n';
+}
+
+} // namespace raptor
@@ -33,6 +33,14 @@ public:
         file << std::forward<t>(data);
     }
 
+    template <typename t>
+    void write_and_flush(t && data)
+    {
+        std::lock_guard<std::mutex> lock(write_mutex);
+        file << std::forward<t>(data);
+        file.flush();
+    }
+
     template <typename t>
     void operator<<(t && data) // Cannot return a reference to itself since multiple threads write in the meantime.
     {
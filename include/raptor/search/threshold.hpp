@@ -0,0 +1,120 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <raptor/search/compute_simple_model.hpp>
+
+namespace raptor
+{
+
+/*!\brief Determines how many minimisers a query must share with a bin to be reported.
+ * \details
+ * Uses the threshold given by the user if set, the k-mer lemma if window and k-mer size are equal, and the
+ * precomputed probabilistic model otherwise.
+ * With `--heuristic-threshold`, the base threshold is computed per read by detail::heuristic_threshold instead.
+ * With `--fpr-correction`, the threshold of each bin is additionally raised by the number of minimisers of the query
+ * that are expected to be false positives in this bin.
+ * Ambiguous bases do not yield k-mers. The probabilistic model and a user threshold depend on the number of
+ * minimisers, which is already reduced. For a query with skipped k-mers, the k-mer lemma is computed from the
+ * remaining k-mers, and is at most the k-mer lemma of the pattern size. Hence, a run of N does not lower the threshold
+ * of the remaining bases.
+ */
+class threshold
+{
+public:
+    threshold() = default;
+    threshold(threshold const &) = default;
+    threshold(threshold &&) = default;
+    threshold & operator=(threshold const &) = default;
+    threshold & operator=(threshold &&) = default;
+    ~threshold() = default;
+
+    explicit threshold(search_arguments const & arguments) :
+        kmers_per_window{arguments.window_size - arguments.shape_size + 1u},
+        kmers_per_pattern{arguments.pattern_size - arguments.shape_size + 1u},
+        min_number_of_minimisers{kmers_per_window == 1u ? kmers_per_pattern :
+                                     static_cast<size_t>(std::ceil(kmers_per_pattern /
+                                                                   static_cast<double>(kmers_per_window)))},
+        max_number_of_minimisers{arguments.pattern_size - arguments.window_size + 1u},
+        kmer_lemma{arguments.pattern_size + 1u > (arguments.errors + 1u) * arguments.shape_size ?
+                       arguments.pattern_size + 1u - (arguments.errors + 1u) * arguments.shape_size :
+                       0u},
+        kmers_per_error{arguments.shape_size},
+        errors{arguments.errors},
+        user_threshold{arguments.treshold_was_set ? arguments.threshold : -1.0},
+        precomp_thresholds{arguments.heuristic_threshold ? std::vector<size_t>{} : compute_simple_model(arguments)},
+        false_positive_rates{arguments.false_positive_rates}
+    {}
+
+    /*!\brief The threshold for a query with `minimiser_count` minimisers, without false positive correction.
+     * \param[in] minimiser_count The number of minimisers of the query.
+     * \param[in] skipped_kmers The number of k-mers of the query that contain an ambiguous base.
+     */
+    size_t get(size_t const minimiser_count, size_t const skipped_kmers = 0u) const noexcept
+    {
+        if (user_threshold >= 0.0)
+            return static_cast<size_t>(minimiser_count * user_threshold);
+
+        if (kmers_per_window == 1u)
+        {
+            if (skipped_kmers == 0u)
+                return kmer_lemma;
+
+            // Each k-mer is a minimiser. Each error destroys at most `kmers_per_error` of the remaining k-mers.
+            size_t const destroyed = errors * kmers_per_error;
+            return std::min(kmer_lemma, minimiser_count > destroyed ? minimiser_count - destroyed : 0u);
+        }
+
+        size_t const index = std::min(minimiser_count < min_number_of_minimisers ?
+                                          0 :
+                                          minimiser_count - min_number_of_minimisers,
+                                      max_number_of_minimisers - min_number_of_minimisers);
+        return precomp_thresholds[index] + 2;
+    }
+
+    //!\brief Writes the threshold of each bin for a query with `minimiser_count` minimisers to `thresholds`.
+    void get(size_t const minimiser_count, std::vector<size_t> & thresholds, size_t const skipped_kmers = 0u) const
+    {
+        get(minimiser_count, get(minimiser_count, skipped_kmers), thresholds);
+    }
+
+    //!\brief Writes the threshold of each bin to `thresholds`, starting from the given `base` threshold.
+    void get(size_t const minimiser_count, size_t const base, std::vector<size_t> & thresholds) const
+    {
+        if (false_positive_rates.empty())
+        {
+            std::fill(thresholds.begin(), thresholds.end(), base);
+            return;
+        }
+
+        thresholds.resize(false_positive_rates.size());
+        std::transform(false_positive_rates.begin(), false_positive_rates.end(), thresholds.begin(),
+                       [base, minimiser_count] (double const rate)
+                       {
+                           return base + static_cast<size_t>(std::ceil(minimiser_count * rate));
+                       });
+    }
+
+private:
+    size_t kmers_per_window{};
+    size_t kmers_per_pattern{};
+    size_t min_number_of_minimisers{};
+    size_t max_number_of_minimisers{};
+    size_t kmer_lemma{};
+    size_t kmers_per_error{};
+    size_t errors{};
+    double user_threshold{-1.0};
+    std::vector<size_t> precomp_thresholds{};
+    std::vector<double> false_positive_rates{};
+};
+
+} // namespace raptor
@@ -0,0 +1,46 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <iomanip>
+
+#include <raptor/shared.hpp>
+
+namespace raptor
+{
+
+//!\brief Writes the timings and the used resources to `<output>.time`.
+inline void write_time(search_arguments const & arguments,
+                       double const index_io_time,
+                       double const reads_io_time,
+                       double const compute_time)
+{
+// LCOV_EXCL_START
+    std::filesystem::path file_path{arguments.out_file};
+    file_path += ".time";
+    std::ofstream file_handle{file_path};
+    file_handle << "Index I/O\tReads I/O\tCompute\tThreads\tBatch size\tResident parts\tCPUs\tMemory\tNUMA nodes\t"
+                   "L3 cache\n";
+    file_handle << std::fixed
+                << std::setprecision(2)
+                << index_io_time << '\t'
+                << reads_io_time << '\t'
+                << compute_time << '\t'
+                << static_cast<size_t>(arguments.threads) << '\t'
+                << arguments.batch_size << '\t'
+                << arguments.parts_resident << '\t'
+                << arguments.resources.cpus << '\t'
+                << arguments.resources.memory << '\t'
+                << arguments.resources.numa_nodes << '\t'
+                << arguments.resources.l3_cache;
+// LCOV_EXCL_END
+}
+
+} // namespace raptor
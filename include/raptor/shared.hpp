@@ -16,6 +16,8 @@
 #include <seqan3/io/sequence_file/input.hpp>
 #include <seqan3/search/kmer_index/shape.hpp>
 
+#include <raptor/resources.hpp>
+
 namespace raptor
 {
 
@@ -35,9 +37,12 @@ struct bits { uint64_t v; };
 //!\brief Strong type for passing number of hash functions.
 struct hashes { uint64_t v; };
 
-struct dna4_traits : seqan3::sequence_file_input_default_traits_dna
+/*!\brief Reads sequences as seqan3::dna5. Unlike seqan3::dna4, which converts them to A, ambiguous bases are kept
+ *        as N, such that the minimiser computation can skip them (see detail::streaming_minimiser).
+ */
+struct dna5_traits : seqan3::sequence_file_input_default_traits_dna
 {
-    using sequence_alphabet = seqan3::dna4;
+    using sequence_alphabet = seqan3::dna5;
 };
 
 struct build_arguments
@@ -58,12 +63,18 @@ struct build_arguments
     uint64_t hash{2};
     uint8_t parts{1u};
     bool compressed{false};
+    bool block_compress{false};
+    bool versioned{false};
 
     // General arguments
     std::vector<std::vector<std::string>> bin_path{};
     std::filesystem::path bin_file{};
     uint8_t threads{1u};
+    std::string threads_string{"1"};
+    std::string strategy{"bins"};
     bool is_socks{false};
+    bool dry_run{false};
+    system_resources resources{};
 };
 
 struct search_arguments
@@ -74,6 +85,7 @@ struct search_arguments
     uint8_t shape_size{shape.size()};
     uint8_t shape_weight{shape.count()};
     uint8_t threads{1u};
+    std::string threads_string{"1"};
     uint8_t parts{1u};
 
     // Related to thresholding
@@ -82,6 +94,10 @@ struct search_arguments
     uint64_t pattern_size{};
     uint8_t errors{0};
     bool treshold_was_set{false};
+    bool fpr_correction{false};
+    bool heuristic_threshold{false};
+    //!\brief With --fpr-correction: The expected rate of false positive minimisers of each bin, summed over all parts.
+    std::vector<double> false_positive_rates{};
 
     // Related to IBF
     std::filesystem::path index_file{};
@@ -90,9 +106,33 @@ struct search_arguments
     // General arguments
     std::vector<std::vector<std::string>> bin_path{};
     std::filesystem::path query_file{};
+    std::vector<std::filesystem::path> query_files{};
+    std::filesystem::path previous_output{};
     std::filesystem::path out_file{"search.out"};
     bool write_time{false};
     bool is_socks{false};
+    bool containment{false};
+    bool dry_run{false};
+    bool bin_major{false};
+    bool abundance{false};
+
+    // Related to streaming
+    bool stream{false};
+    uint32_t micro_batch_size{64u};
+    double deadline{1.0};
+
+    // Related to out-of-core search
+    bool out_of_core{false};
+    uint64_t memory_budget{4096u};
+
+    // Related to resources
+    //!\brief The number of reads that are loaded and searched at once.
+    uint64_t batch_size{(1ULL<<20)*10};
+    //!\brief Whether all parts of a partitioned index are kept in memory instead of being reloaded for each batch.
+    bool parts_resident{false};
+    //!\brief Whether the number of threads should be calibrated on the first batch of reads.
+    bool auto_tune{false};
+    system_resources resources{};
 };
 
 struct upgrade_arguments
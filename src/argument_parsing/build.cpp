@@ -7,6 +7,7 @@
 
 #include <raptor/argument_parsing/build.hpp>
 #include <raptor/build/build.hpp>
+#include <raptor/dry_run.hpp>
 
 namespace raptor
 {
@@ -68,6 +69,31 @@ void init_build_parser(seqan3::argument_parser & parser, build_arguments & argum
                     '\0',
                     "compressed",
                     "Build a compressed index.");
+    parser.add_flag(arguments.block_compress,
+                    '\0',
+                    "block-compress",
+                    "Compress the index file in independent blocks using zlib. Reduces the file size for storage and "
+                    "transfer; the index is decompressed in parallel when it is loaded. Search detects such files "
+                    "automatically.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_flag(arguments.versioned,
+                    '\0',
+                    "versioned",
+                    "Store the index as a version in the directory of the output file. The IBF is split into "
+                    "content-addressed blocks in the subdirectory \"blocks\", which all versions in this directory "
+                    "share. Blocks that did not change, e.g., because the same bins were used with the same size, are "
+                    "only stored once. Search detects such files automatically.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_option(arguments.strategy,
+                      '\0',
+                      "strategy",
+                      "How bins are inserted in parallel. bins: Threads insert chunks of bins into the shared index. "
+                      "transpose: Threads fill private bit vectors for 64 bins each, which are then transposed into "
+                      "the index. Avoids threads sharing memory, but needs 8 * bin size bytes per thread. "
+                      "rows: Each thread sets the bits of a fixed range of rows, bits for other rows are passed to the "
+                      "owning thread. Suited for many small bins.",
+                      seqan3::option_spec::advanced,
+                      seqan3::value_list_validator{"bins", "transpose", "rows"});
     parser.add_flag(arguments.compute_minimiser,
                     '\0',
                     "compute-minimiser",
@@ -91,6 +117,7 @@ void run_build(seqan3::argument_parser & parser, bool const is_socks)
     arguments.is_socks = is_socks;
     init_build_parser(parser, arguments);
     try_parsing(parser);
+    parse_threads(arguments);
 
     // ==========================================
     // Various checks.
@@ -124,6 +151,9 @@ void run_build(seqan3::argument_parser & parser, bool const is_socks)
         arguments.window_size = arguments.shape.size();
     }
 
+    if (arguments.versioned && (arguments.compressed || arguments.block_compress))
+        throw seqan3::argument_parser_error{"--versioned cannot be combined with --compressed or --block-compress."};
+
     bool const is_compute_minimiser_set{parser.is_option_set("compute-minimiser") ||
                                         parser.is_option_set("compute-minimizer")};
 
@@ -214,6 +244,12 @@ void run_build(seqan3::argument_parser & parser, bool const is_socks)
     // ==========================================
     // Dispatch
     // ==========================================
+    if (arguments.dry_run)
+    {
+        dry_run(arguments, std::cout);
+        return;
+    }
+
     raptor_build(arguments);
 };
 
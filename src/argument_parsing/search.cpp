@@ -5,10 +5,16 @@
 // shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
 // -----------------------------------------------------------------------------------------------------
 
+#include <cmath>
+
 #include <seqan3/io/views/async_input_buffer.hpp>
 
 #include <raptor/argument_parsing/search.hpp>
+#include <raptor/detail/block_compression.hpp>
+#include <raptor/dry_run.hpp>
 #include <raptor/index.hpp>
+#include <raptor/search/auto_tune.hpp>
+#include <raptor/search/memory_settings.hpp>
 #include <raptor/search/search.hpp>
 
 namespace raptor
@@ -28,7 +34,9 @@ void init_search_parser(seqan3::argument_parser & parser, search_arguments & arg
     parser.add_option(arguments.query_file,
                       '\0',
                       "query",
-                      "Provide a path to the query file.",
+                      arguments.is_socks ? "Provide a path to the query file." :
+                                           "Provide a path to the query file. With --containment, this may also be a "
+                                           "file containing one query file path per line.",
                       seqan3::option_spec::required,
                       seqan3::input_file_validator{});
     parser.add_option(arguments.out_file,
@@ -59,6 +67,95 @@ void init_search_parser(seqan3::argument_parser & parser, search_arguments & arg
                       "pattern",
                       "The pattern size. Default: Use median of sequence lengths in query file.",
                       arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_flag(arguments.fpr_correction,
+                    '\0',
+                    "fpr-correction",
+                    "Raise the threshold of each bin by the number of minimisers that are expected to be false "
+                    "positives, based on the fill rate of the bin. Requires an index of format version 2 or newer, "
+                    "i.e., created by raptor build or converted by raptor upgrade.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::advanced);
+    parser.add_flag(arguments.heuristic_threshold,
+                    '\0',
+                    "heuristic-threshold",
+                    "Compute the threshold of each read from the positions of its minimisers, i.e., the number of "
+                    "minimisers that remain after placing each error such that it destroys as many minimisers as "
+                    "possible. Cannot be combined with --threshold, --containment, --delta, --stream, and "
+                    "--out-of-core.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::advanced);
+    parser.add_flag(arguments.containment,
+                    '\0',
+                    "containment",
+                    "Instead of searching each read, report for each bin the fraction of distinct minimisers of the "
+                    "whole query file that are contained in the bin.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_flag(arguments.bin_major,
+                    '\0',
+                    "bin-major",
+                    "Instead of one line per read listing the bins, write one line per bin listing the reads. The "
+                    "reads of a bin are listed in the order of the query file. Cannot be combined with "
+                    "--containment, --delta, --stream, and --out-of-core.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_flag(arguments.abundance,
+                    '\0',
+                    "abundance",
+                    "Instead of listing the bins of each read, estimate the abundance of each bin. Reads that hit "
+                    "several bins are distributed over these bins by an expectation-maximisation algorithm. Writes "
+                    "one line per bin with the estimated number of reads and their fraction of all classified reads. "
+                    "Cannot be combined with --bin-major, --containment, --delta, --stream, and --out-of-core.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_option(arguments.previous_output,
+                      '\0',
+                      "delta",
+                      "Provide the output of a previous search of the same query file. Only bins that are not listed in "
+                      "its header are searched and the results are merged into the previous results.",
+                      arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard,
+                      seqan3::input_file_validator{});
+    parser.add_flag(arguments.stream,
+                    '\0',
+                    "stream",
+                    "Low-latency mode. Keeps the index in memory and classifies reads as soon as they arrive, e.g., "
+                    "via a named pipe. Each result is flushed immediately and latencies are written to "
+                    "<output>.latency. Requires --pattern or --threshold.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_option(arguments.micro_batch_size,
+                      '\0',
+                      "micro-batch",
+                      "The maximum number of reads a thread processes at once in --stream mode.",
+                      arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::advanced,
+                      positive_integer_validator{});
+    parser.add_option(arguments.deadline,
+                      '\0',
+                      "deadline",
+                      "The maximum time in milliseconds a read waits for its micro-batch to fill up in --stream mode.",
+                      arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::advanced,
+                      seqan3::arithmetic_range_validator{0, 1000});
+    parser.add_flag(arguments.out_of_core,
+                    '\0',
+                    "out-of-core",
+                    "Do not load the index into memory. Instead, the lookups of a batch of reads are sorted and the "
+                    "index is read sequentially from disk. Only for uncompressed indices.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::standard);
+    parser.add_option(arguments.memory_budget,
+                      '\0',
+                      "memory-budget",
+                      "The memory in MiB available for a batch of reads in --out-of-core mode, and for buffering "
+                      "the results in --bin-major mode.",
+                      arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::advanced,
+                      positive_integer_validator{});
+    parser.add_option(arguments.batch_size,
+                      '\0',
+                      "batch-size",
+                      "The number of reads that are loaded and searched at once. Default: Derived from the available "
+                      "memory, at most 10485760.",
+                      arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::advanced,
+                      positive_integer_validator{});
+    parser.add_flag(arguments.auto_tune,
+                    '\0',
+                    "auto-tune",
+                    "Measure the search speed on a sample of the reads for different numbers of threads, up to "
+                    "--threads, and use the fastest. The result is stored in <index>.tuning and reused by later "
+                    "searches on the same host with the same index and --threads.",
+                    arguments.is_socks ? seqan3::option_spec::hidden : seqan3::option_spec::advanced);
     parser.add_flag(arguments.write_time,
                     '\0',
                     "time",
@@ -72,6 +169,7 @@ void run_search(seqan3::argument_parser & parser, bool const is_socks)
     arguments.is_socks = is_socks;
     init_search_parser(parser, arguments);
     try_parsing(parser);
+    parse_threads(arguments);
 
     // ==========================================
     // Various checks.
@@ -91,11 +189,63 @@ void run_search(seqan3::argument_parser & parser, bool const is_socks)
 
     if (!arguments.is_socks)
     {
-        seqan3::input_file_validator<seqan3::sequence_file_input<>>{}(arguments.query_file);
+        seqan3::input_file_validator<seqan3::sequence_file_input<>> sequence_file_validator{};
+
+        if (!arguments.containment)
+        {
+            sequence_file_validator(arguments.query_file);
+        }
+        else
+        {
+            try
+            {
+                sequence_file_validator(arguments.query_file);
+                arguments.query_files.push_back(arguments.query_file);
+            }
+            catch (seqan3::validation_error const & e)
+            {
+                std::ifstream istrm{arguments.query_file};
+                std::string line{};
+                while (std::getline(istrm, line))
+                {
+                    if (!line.empty())
+                    {
+                        sequence_file_validator(line);
+                        arguments.query_files.emplace_back(line);
+                    }
+                }
+
+                if (arguments.query_files.empty())
+                    throw seqan3::argument_parser_error{"The list of query files cannot be empty."};
+            }
+        }
     }
 
     arguments.treshold_was_set = parser.is_option_set("threshold");
 
+    if (arguments.containment + !arguments.previous_output.empty() + arguments.stream + arguments.out_of_core > 1)
+        throw seqan3::argument_parser_error{"You can only use one of --containment, --delta, --stream, and "
+                                            "--out-of-core."};
+
+    if (arguments.heuristic_threshold && (arguments.treshold_was_set || arguments.containment ||
+                                          !arguments.previous_output.empty() || arguments.stream ||
+                                          arguments.out_of_core))
+        throw seqan3::argument_parser_error{"--heuristic-threshold cannot be combined with --threshold, --containment, "
+                                            "--delta, --stream, and --out-of-core."};
+
+    if (arguments.bin_major && (arguments.containment || !arguments.previous_output.empty() || arguments.stream ||
+                                arguments.out_of_core))
+        throw seqan3::argument_parser_error{"--bin-major cannot be combined with --containment, --delta, --stream, and "
+                                            "--out-of-core."};
+
+    if (arguments.abundance && (arguments.bin_major || arguments.containment || !arguments.previous_output.empty() ||
+                                arguments.stream || arguments.out_of_core))
+        throw seqan3::argument_parser_error{"--abundance cannot be combined with --bin-major, --containment, --delta, "
+                                            "--stream, and --out-of-core."};
+
+    if (arguments.stream && !arguments.pattern_size && !arguments.treshold_was_set)
+        throw seqan3::argument_parser_error{"--stream requires either --pattern or --threshold to be set."};
+
     bool partitioned{false};
     seqan3::input_file_validator validator{};
 
@@ -112,10 +262,11 @@ void run_search(seqan3::argument_parser & parser, bool const is_socks)
     // ==========================================
     // Process --pattern.
     // ==========================================
-    if (!arguments.is_socks && !arguments.pattern_size)
+    if (!arguments.is_socks && !arguments.containment && !arguments.stream && !arguments.dry_run &&
+        !arguments.pattern_size)
     {
         std::vector<uint64_t> sequence_lengths{};
-        seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> query_in{arguments.query_file};
+        seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::seq>> query_in{arguments.query_file};
         for (auto & [seq] : query_in | seqan3::views::async_input_buffer(16))
         {
             sequence_lengths.push_back(std::ranges::size(seq));
@@ -128,9 +279,8 @@ void run_search(seqan3::argument_parser & parser, bool const is_socks)
     // Read window and kmer size, and the bin paths.
     // ==========================================
     {
-        std::ifstream is{partitioned ? arguments.index_file.string() + std::string{"_0"} :
-                                       arguments.index_file.string(),
-                         std::ios::binary};
+        detail::index_istream is{partitioned ? arguments.index_file.string() + std::string{"_0"} :
+                                               arguments.index_file.string()};
         cereal::BinaryInputArchive iarchive{is};
         raptor_index<> tmp{};
         tmp.load_parameters(iarchive);
@@ -141,8 +291,12 @@ void run_search(seqan3::argument_parser & parser, bool const is_socks)
         arguments.parts = tmp.parts();
         arguments.compressed = tmp.compressed();
         arguments.bin_path = tmp.bin_path();
+        if (arguments.out_of_core && arguments.compressed)
+            throw seqan3::argument_parser_error{"--out-of-core can only be used with uncompressed indices."};
         if (arguments.is_socks)
             arguments.pattern_size = arguments.shape_size;
+        if (arguments.stream && !arguments.pattern_size)
+            arguments.pattern_size = arguments.window_size;
     }
 
     // ==========================================
@@ -156,9 +310,69 @@ void run_search(seqan3::argument_parser & parser, bool const is_socks)
         }
     }
 
+    // ==========================================
+    // --auto-tune: Use the calibration of a previous run on this host.
+    // ==========================================
+    if (arguments.auto_tune)
+    {
+        if (auto const threads = detail::tuning_cache{arguments}.get(); threads.has_value())
+        {
+            arguments.threads = *threads;
+            arguments.auto_tune = false;
+        }
+    }
+
+    // ==========================================
+    // Read fill rates for --fpr-correction.
+    // ==========================================
+    if (arguments.fpr_correction)
+    {
+        arguments.false_positive_rates.assign(arguments.bin_path.size(), 0.0);
+
+        for (size_t part{0}; part < arguments.parts; ++part)
+        {
+            detail::index_istream is{partitioned ? arguments.index_file.string() + "_" + std::to_string(part) :
+                                                   arguments.index_file.string()};
+            cereal::BinaryInputArchive iarchive{is};
+            raptor_index<> tmp{};
+            tmp.load_parameters(iarchive);
+
+            if (tmp.fill_rates().size() != arguments.bin_path.size())
+                throw seqan3::argument_parser_error{"--fpr-correction needs an index that stores fill rates. Please "
+                                                    "rebuild the index."};
+
+            // The serialised IBF starts with bins, technical bins, bin size, hash shift, bin words, and hash count.
+            size_t bins{}, technical_bins{}, bin_size{}, hash_shift{}, bin_words{}, hash_count{};
+            iarchive(bins, technical_bins, bin_size, hash_shift, bin_words, hash_count);
+
+            for (size_t bin{0}; bin < arguments.bin_path.size(); ++bin)
+                arguments.false_positive_rates[bin] += std::pow(tmp.fill_rates()[bin], hash_count);
+        }
+    }
+
+    // ==========================================
+    // Derive batch size and part residency from the available memory.
+    // ==========================================
+    std::vector<uint64_t> part_sizes{};
+    for (size_t part{0}; part < arguments.parts; ++part)
+    {
+        std::filesystem::path const part_path = partitioned ? arguments.index_file.string() + "_" +
+                                                                  std::to_string(part) :
+                                                              arguments.index_file;
+        part_sizes.push_back(detail::index_size(part_path));
+    }
+
+    derive_memory_settings(arguments, part_sizes, partitioned, !parser.is_option_set("batch-size"));
+
     // ==========================================
     // Dispatch
     // ==========================================
+    if (arguments.dry_run)
+    {
+        dry_run(arguments, std::cout);
+        return;
+    }
+
     raptor_search(arguments);
 };
 
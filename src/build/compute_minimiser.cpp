@@ -6,6 +6,7 @@
 // -----------------------------------------------------------------------------------------------------
 
 #include <raptor/build/compute_minimiser.hpp>
+#include <raptor/detail/for_each_minimiser.hpp>
 
 namespace raptor
 {
@@ -35,10 +36,6 @@ bool check_for_fasta_format(std::vector<std::string> const & valid_extensions, s
 
 void compute_minimiser(build_arguments const & arguments)
 {
-    auto minimiser_view = seqan3::views::minimiser_hash(arguments.shape,
-                                                        seqan3::window_size{arguments.window_size},
-                                                        seqan3::seed{adjust_seed(arguments.shape.count())});
-
     uint16_t const default_cutoff{50};
 
     // Cutoffs and bounds from Mantis
@@ -52,19 +49,23 @@ void compute_minimiser(build_arguments const & arguments)
         robin_hood::unordered_map<uint64_t, uint8_t> minimiser_table{};
         uint64_t count{0};
         uint16_t cutoff{0};
+        detail::streaming_minimiser minimiser{arguments.shape,
+                                              arguments.window_size,
+                                              adjust_seed(arguments.shape.count())};
 
         for (auto && [file_names, bin_number] : zipped_view)
         {
             for (auto && file_name : file_names)
             {
-                seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> fin{file_name};
-
-                for (auto & [seq] : fin)
-                    for (auto && hash : seq | minimiser_view)
-                        minimiser_table[hash] = std::min<uint8_t>(254u, minimiser_table[hash] + 1);
-                        // The hash table stores how often a minimiser appears. It does not matter whether a minimiser appears
-                        // 50 times or 2000 times, it is stored regardless because the biggest cutoff value is 50. Hence,
-                        // the hash table stores only values up to 254 to save memory.
+                // The hash table stores how often a minimiser appears. It does not matter whether a minimiser appears
+                // 50 times or 2000 times, it is stored regardless because the biggest cutoff value is 50. Hence,
+                // the hash table stores only values up to 254 to save memory.
+                auto count_hash = [&minimiser_table] (uint64_t const hash, uint64_t const)
+                {
+                    minimiser_table[hash] = std::min<uint8_t>(254u, minimiser_table[hash] + 1);
+                };
+
+                detail::for_each_minimiser(file_name, minimiser, count_hash);
             }
 
             std::filesystem::path const file_name{file_names[0]};
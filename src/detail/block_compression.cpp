@@ -0,0 +1,341 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <string_view>
+#include <thread>
+
+#include <seqan3/argument_parser/exceptions.hpp>
+#include <seqan3/core/platform.hpp>
+
+#if SEQAN3_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+#include <raptor/detail/block_compression.hpp>
+#include <raptor/detail/parallel_for.hpp>
+#include <raptor/detail/version_store.hpp>
+
+namespace raptor::detail
+{
+
+static constexpr std::string_view magic_string{"RAPTORBZ"};
+static constexpr uint32_t format_version{1u};
+
+static void write_bytes(std::streambuf * sink, char const * const data, std::streamsize const size)
+{
+    if (sink->sputn(data, size) != size)
+        throw seqan3::argument_parser_error{"Failed to write block-compressed index."};
+}
+
+template <typename value_t>
+static void write_value(std::streambuf * sink, value_t const value)
+{
+    write_bytes(sink, reinterpret_cast<char const *>(&value), sizeof(value_t));
+}
+
+template <typename value_t>
+static value_t read_value(std::streambuf * source)
+{
+    value_t value{};
+    if (source->sgetn(reinterpret_cast<char *>(&value), sizeof(value_t)) != sizeof(value_t))
+        throw seqan3::argument_parser_error{"Cannot read index: Unexpected end of block-compressed file."};
+    return value;
+}
+
+[[noreturn]] static void throw_no_zlib()
+{
+    throw seqan3::argument_parser_error{"Block-compressed indices need zlib, but Raptor was built without it."};
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// block_compressed_ostreambuf
+// ---------------------------------------------------------------------------------------------------------------------
+
+block_compressed_ostreambuf::block_compressed_ostreambuf(std::streambuf * sink,
+                                                         size_t const threads,
+                                                         size_t const block_size) :
+    sink{sink},
+    threads{std::max<size_t>(1u, threads)},
+    block_size{block_size},
+    buffer(this->threads * block_size)
+{
+#if !SEQAN3_HAS_ZLIB
+    throw_no_zlib();
+#endif
+    write_bytes(sink, magic_string.data(), magic_string.size());
+    write_value(sink, format_version);
+    write_value(sink, static_cast<uint64_t>(block_size));
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+block_compressed_ostreambuf::~block_compressed_ostreambuf()
+{
+    try
+    {
+        close();
+    }
+    catch (...) // LCOV_EXCL_LINE
+    {} // LCOV_EXCL_LINE
+}
+
+void block_compressed_ostreambuf::close()
+{
+    if (closed)
+        return;
+
+    closed = true;
+    write_blocks(pptr() - pbase());
+    write_value(sink, uint32_t{0u});
+    write_value(sink, uint32_t{0u});
+
+    if (sink->pubsync() != 0)
+        throw seqan3::argument_parser_error{"Failed to write block-compressed index."};
+}
+
+block_compressed_ostreambuf::int_type block_compressed_ostreambuf::overflow(int_type character)
+{
+    write_blocks(pptr() - pbase());
+    setp(buffer.data(), buffer.data() + buffer.size());
+
+    if (!traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        *pptr() = traits_type::to_char_type(character);
+        pbump(1);
+    }
+
+    return traits_type::not_eof(character);
+}
+
+void block_compressed_ostreambuf::write_blocks([[maybe_unused]] size_t const size)
+{
+#if SEQAN3_HAS_ZLIB
+    size_t const block_count = (size + block_size - 1u) / block_size;
+    std::vector<std::vector<unsigned char>> compressed(block_count);
+
+    parallel_for(block_count, threads, [&] (size_t const block)
+    {
+        size_t const begin = block * block_size;
+        size_t const length = std::min(block_size, size - begin);
+        uLongf compressed_length = compressBound(length);
+        compressed[block].resize(compressed_length);
+
+        if (compress2(compressed[block].data(),
+                      &compressed_length,
+                      reinterpret_cast<Bytef const *>(buffer.data() + begin),
+                      length,
+                      Z_BEST_SPEED) != Z_OK)
+            throw seqan3::argument_parser_error{"Failed to compress index."}; // LCOV_EXCL_LINE
+
+        compressed[block].resize(compressed_length);
+    });
+
+    for (size_t block = 0; block < block_count; ++block)
+    {
+        size_t const length = std::min(block_size, size - block * block_size);
+        write_value(sink, static_cast<uint32_t>(compressed[block].size()));
+        write_value(sink, static_cast<uint32_t>(length));
+        write_bytes(sink, reinterpret_cast<char const *>(compressed[block].data()), compressed[block].size());
+    }
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// block_compressed_istreambuf
+// ---------------------------------------------------------------------------------------------------------------------
+
+block_compressed_istreambuf::block_compressed_istreambuf(std::streambuf * source, size_t const threads) :
+    source{source},
+    threads{std::max<size_t>(1u, threads)}
+{
+#if !SEQAN3_HAS_ZLIB
+    throw_no_zlib();
+#endif
+    std::array<char, magic_string.size()> magic{};
+    source->sgetn(magic.data(), magic.size());
+
+    if (std::string_view{magic.data(), magic.size()} != magic_string || read_value<uint32_t>(source) != format_version)
+        throw seqan3::argument_parser_error{"Cannot read index: Unsupported block-compressed file."};
+
+    block_size = read_value<uint64_t>(source);
+    pending = std::async(std::launch::async, &block_compressed_istreambuf::read_blocks, this, std::ref(next));
+}
+
+block_compressed_istreambuf::~block_compressed_istreambuf()
+{
+    if (pending.valid())
+        pending.wait();
+}
+
+block_compressed_istreambuf::int_type block_compressed_istreambuf::underflow()
+{
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    if (!pending.valid())
+        return traits_type::eof();
+
+    size_t const size = pending.get();
+    if (size == 0u)
+        return traits_type::eof();
+
+    std::swap(current, next);
+    setg(current.data(), current.data(), current.data() + size);
+
+    if (!finished)
+        pending = std::async(std::launch::async, &block_compressed_istreambuf::read_blocks, this, std::ref(next));
+
+    return traits_type::to_int_type(*gptr());
+}
+
+size_t block_compressed_istreambuf::read_blocks(std::vector<char> & output)
+{
+#if SEQAN3_HAS_ZLIB
+    std::vector<std::vector<unsigned char>> compressed{};
+    std::vector<size_t> offsets{0u};
+
+    while (compressed.size() < threads)
+    {
+        uint32_t const compressed_length = read_value<uint32_t>(source);
+        uint32_t const length = read_value<uint32_t>(source);
+
+        if (length == 0u)
+        {
+            finished = true;
+            break;
+        }
+
+        compressed.emplace_back(compressed_length);
+        if (source->sgetn(reinterpret_cast<char *>(compressed.back().data()), compressed_length) != compressed_length)
+            throw seqan3::argument_parser_error{"Cannot read index: Unexpected end of block-compressed file."};
+        offsets.push_back(offsets.back() + length);
+    }
+
+    output.resize(std::max(output.size(), offsets.back()));
+
+    parallel_for(compressed.size(), threads, [&] (size_t const block)
+    {
+        uLongf length = offsets[block + 1u] - offsets[block];
+
+        if (uncompress(reinterpret_cast<Bytef *>(output.data() + offsets[block]),
+                       &length,
+                       compressed[block].data(),
+                       compressed[block].size()) != Z_OK ||
+            length != offsets[block + 1u] - offsets[block])
+            throw seqan3::argument_parser_error{"Cannot read index: Corrupted block-compressed file."};
+    });
+
+    return offsets.back();
+#else
+    (void) output;
+    return 0u;
+#endif
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// index_istream and index_ostream
+// ---------------------------------------------------------------------------------------------------------------------
+
+bool is_block_compressed(std::istream & stream)
+{
+    std::array<char, magic_string.size()> magic{};
+    auto const position = stream.tellg();
+    stream.read(magic.data(), magic.size());
+    bool const result = stream.gcount() == static_cast<std::streamsize>(magic.size()) &&
+                        std::string_view{magic.data(), magic.size()} == magic_string;
+    stream.clear();
+    stream.seekg(position);
+    return result;
+}
+
+uint64_t index_size(std::filesystem::path const & path)
+{
+    std::ifstream file{path, std::ios::binary};
+
+    if (file.good() && is_versioned(file))
+        return versioned_size(file.rdbuf());
+
+    if (!file.good() || !is_block_compressed(file))
+        return std::filesystem::file_size(path);
+
+    // Sums the uncompressed sizes of the blocks, skipping the compressed data.
+    std::streambuf * const source = file.rdbuf();
+    source->pubseekoff(magic_string.size() + sizeof(uint32_t) + sizeof(uint64_t), std::ios::beg, std::ios::in);
+    uint64_t size{};
+
+    while (true)
+    {
+        uint32_t const compressed_length = read_value<uint32_t>(source);
+        uint32_t const length = read_value<uint32_t>(source);
+
+        if (length == 0u)
+            return size;
+
+        size += length;
+        source->pubseekoff(compressed_length, std::ios::cur, std::ios::in);
+    }
+}
+
+index_istream::index_istream(std::filesystem::path const & path, size_t const threads) :
+    std::istream{nullptr},
+    file{path, std::ios::binary}
+{
+    if (file.good() && is_block_compressed(file))
+    {
+        decompressor = std::make_unique<block_compressed_istreambuf>(file.rdbuf(), threads);
+        rdbuf(decompressor.get());
+    }
+    else if (file.good() && is_versioned(file))
+    {
+        decompressor = std::make_unique<versioned_istreambuf>(file.rdbuf(),
+                                                              version_store::block_directory(path),
+                                                              threads);
+        rdbuf(decompressor.get());
+    }
+    else
+    {
+        rdbuf(file.rdbuf());
+        if (!file.good())
+            setstate(std::ios::failbit);
+    }
+}
+
+index_ostream::index_ostream(std::filesystem::path const & path, bool const compress, size_t const threads) :
+    std::ostream{nullptr},
+    path{path},
+    file{path, std::ios::binary}
+{
+    if (!file.is_open())
+        throw seqan3::argument_parser_error{"Failed to open " + path.string() + " for writing."};
+
+    if (compress)
+    {
+        compressor = std::make_unique<block_compressed_ostreambuf>(file.rdbuf(), threads);
+        rdbuf(compressor.get());
+    }
+    else
+    {
+        rdbuf(file.rdbuf());
+    }
+}
+
+void index_ostream::close()
+{
+    if (compressor)
+        compressor->close();
+
+    flush();
+    bool const written = good();
+    file.close();
+
+    if (!written || file.fail())
+        throw seqan3::argument_parser_error{"Failed to write " + path.string() + '.'};
+}
+
+} // namespace raptor::detail
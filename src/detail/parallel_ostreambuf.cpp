@@ -0,0 +1,94 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <seqan3/argument_parser/exceptions.hpp>
+
+#include <raptor/detail/parallel_for.hpp>
+#include <raptor/detail/parallel_ostreambuf.hpp>
+
+namespace raptor::detail
+{
+
+parallel_ostreambuf::parallel_ostreambuf(std::filesystem::path const & path,
+                                         char const * const payload,
+                                         size_t const payload_size,
+                                         size_t const threads,
+                                         size_t const chunk_size) :
+    payload_ostreambuf{payload, payload_size},
+    path{path},
+    file_descriptor{::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666)},
+    threads{std::max<size_t>(1u, threads)},
+    chunk_size{std::max<size_t>(1u, chunk_size)}
+{
+    if (file_descriptor < 0)
+        throw seqan3::argument_parser_error{"Failed to open " + path.string() + " for writing."};
+}
+
+parallel_ostreambuf::~parallel_ostreambuf()
+{
+    if (file_descriptor >= 0)
+        ::close(file_descriptor);
+}
+
+void parallel_ostreambuf::close()
+{
+    check_payload_written();
+
+    if (payload_size == 0u)
+        write(header.data(), header.size(), 0u);
+
+    write(trailer.data(), trailer.size(), header.size() + payload_size);
+
+    int const result = ::close(file_descriptor);
+    file_descriptor = -1;
+
+    if (result != 0)
+        throw seqan3::argument_parser_error{"Failed to write " + path.string() + '.'}; // LCOV_EXCL_LINE
+}
+
+void parallel_ostreambuf::write(char const * data, size_t size, size_t offset) const
+{
+    while (size > 0u)
+    {
+        ssize_t const written = ::pwrite(file_descriptor, data, size, offset);
+
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            throw seqan3::argument_parser_error{"Failed to write " + path.string() + '.'};
+
+        data += written;
+        size -= written;
+        offset += written;
+    }
+}
+
+void parallel_ostreambuf::write_payload()
+{
+    write(header.data(), header.size(), 0u);
+
+    // Chunk `i` covers the file offsets `[i * chunk_size, (i + 1) * chunk_size)`, restricted to the payload.
+    size_t const payload_begin = header.size();
+    size_t const payload_end = payload_begin + payload_size;
+    size_t const first_chunk = payload_begin / chunk_size;
+    size_t const chunk_count = (payload_end + chunk_size - 1u) / chunk_size - first_chunk;
+
+    parallel_for(chunk_count, threads, [&] (size_t const chunk)
+    {
+        size_t const begin = std::max(payload_begin, (first_chunk + chunk) * chunk_size);
+        size_t const end = std::min(payload_end, (first_chunk + chunk + 1u) * chunk_size);
+        write(payload + (begin - payload_begin), end - begin, begin);
+    });
+}
+
+} // namespace raptor::detail
@@ -0,0 +1,58 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <seqan3/argument_parser/exceptions.hpp>
+
+#include <raptor/detail/payload_ostreambuf.hpp>
+
+namespace raptor::detail
+{
+
+payload_ostreambuf::payload_ostreambuf(char const * const payload, size_t const payload_size) :
+    payload{payload},
+    payload_size{payload_size}
+{}
+
+void payload_ostreambuf::check_payload_written() const
+{
+    if (payload_bytes_written != payload_size)
+        throw seqan3::argument_parser_error{"Failed to store index: The IBF was not serialised."};
+}
+
+payload_ostreambuf::int_type payload_ostreambuf::overflow(int_type character)
+{
+    if (!traits_type::eq_int_type(character, traits_type::eof()))
+    {
+        char const value = traits_type::to_char_type(character);
+        xsputn(&value, 1);
+    }
+
+    return traits_type::not_eof(character);
+}
+
+std::streamsize payload_ostreambuf::xsputn(char const * data, std::streamsize count)
+{
+    if (data >= payload && data < payload + payload_size)
+    {
+        if (data != payload + payload_bytes_written ||
+            static_cast<size_t>(count) > payload_size - payload_bytes_written)
+            throw seqan3::argument_parser_error{"Failed to store index: Unexpected serialisation order."};
+
+        payload_bytes_written += count;
+        if (payload_bytes_written == payload_size)
+            write_payload();
+    }
+    else
+    {
+        std::vector<char> & bytes = payload_bytes_written ? trailer : header;
+        bytes.insert(bytes.end(), data, data + count);
+    }
+
+    return count;
+}
+
+} // namespace raptor::detail
@@ -0,0 +1,418 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string_view>
+
+#include <seqan3/argument_parser/exceptions.hpp>
+
+#include <raptor/detail/parallel_for.hpp>
+#include <raptor/detail/version_store.hpp>
+
+namespace raptor::detail
+{
+
+static constexpr std::string_view magic_string{"RAPTORVS"};
+static constexpr uint32_t format_version{2u};
+
+template <typename value_t>
+static void write_value(std::ostream & sink, value_t const value)
+{
+    sink.write(reinterpret_cast<char const *>(&value), sizeof(value_t));
+}
+
+template <typename value_t>
+static value_t read_value(std::streambuf * source)
+{
+    value_t value{};
+    if (source->sgetn(reinterpret_cast<char *>(&value), sizeof(value_t)) != sizeof(value_t))
+        throw seqan3::argument_parser_error{"Cannot read index: Unexpected end of version manifest."};
+    return value;
+}
+
+static void write_bytes(std::ostream & sink, std::vector<char> const & bytes)
+{
+    write_value(sink, static_cast<uint64_t>(bytes.size()));
+    sink.write(bytes.data(), bytes.size());
+}
+
+static std::vector<char> read_bytes(std::streambuf * source)
+{
+    std::vector<char> bytes(read_value<uint64_t>(source));
+    if (source->sgetn(bytes.data(), bytes.size()) != static_cast<std::streamsize>(bytes.size()))
+        throw seqan3::argument_parser_error{"Cannot read index: Unexpected end of version manifest."};
+    return bytes;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// version_store
+// ---------------------------------------------------------------------------------------------------------------------
+
+size_t version_store::block_rows(size_t const bin_words)
+{
+    return std::clamp<size_t>((8ULL << 20) / bin_words, 64u, 1ULL << 17);
+}
+
+// SHA-256 as specified in FIPS 180-4.
+static constexpr std::array<uint32_t, 64> sha256_constants{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+static constexpr uint32_t rotate_right(uint32_t const value, uint32_t const shift)
+{
+    return (value >> shift) | (value << (32u - shift));
+}
+
+//!\brief Processes one block of 64 bytes.
+static void sha256_compress(std::array<uint32_t, 8> & state, unsigned char const * const block)
+{
+    std::array<uint32_t, 64> schedule{};
+
+    for (size_t i = 0; i < 16u; ++i)
+        schedule[i] = (uint32_t{block[4u * i]} << 24) | (uint32_t{block[4u * i + 1u]} << 16) |
+                      (uint32_t{block[4u * i + 2u]} << 8) | uint32_t{block[4u * i + 3u]};
+
+    for (size_t i = 16; i < 64u; ++i)
+    {
+        uint32_t const s0 = rotate_right(schedule[i - 15u], 7u) ^ rotate_right(schedule[i - 15u], 18u) ^
+                            (schedule[i - 15u] >> 3);
+        uint32_t const s1 = rotate_right(schedule[i - 2u], 17u) ^ rotate_right(schedule[i - 2u], 19u) ^
+                            (schedule[i - 2u] >> 10);
+        schedule[i] = schedule[i - 16u] + s0 + schedule[i - 7u] + s1;
+    }
+
+    auto [a, b, c, d, e, f, g, h] = state;
+
+    for (size_t i = 0; i < 64u; ++i)
+    {
+        uint32_t const s1 = rotate_right(e, 6u) ^ rotate_right(e, 11u) ^ rotate_right(e, 25u);
+        uint32_t const choice = (e & f) ^ (~e & g);
+        uint32_t const temp1 = h + s1 + choice + sha256_constants[i] + schedule[i];
+        uint32_t const s0 = rotate_right(a, 2u) ^ rotate_right(a, 13u) ^ rotate_right(a, 22u);
+        uint32_t const majority = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t const temp2 = s0 + majority;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + temp1;
+        d = c;
+        c = b;
+        b = a;
+        a = temp1 + temp2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+version_store::block_hash version_store::hash(uint64_t const * const data, size_t const size)
+{
+    std::array<uint32_t, 8> state{0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                                  0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+    // The bytes of the words as they are stored in memory and in the block files.
+    unsigned char const * const bytes = reinterpret_cast<unsigned char const *>(data);
+    size_t const byte_count = size * sizeof(uint64_t);
+    size_t const full_blocks = byte_count / 64u;
+
+    for (size_t block = 0; block < full_blocks; ++block)
+        sha256_compress(state, bytes + 64u * block);
+
+    // The remaining bytes, a single 1 bit, zeros, and the length in bits as big-endian 64-bit number.
+    std::array<unsigned char, 128> last{};
+    size_t const remaining = byte_count - 64u * full_blocks;
+    std::memcpy(last.data(), bytes + 64u * full_blocks, remaining);
+    last[remaining] = 0x80;
+    size_t const last_size = remaining < 56u ? 64u : 128u;
+    uint64_t const bit_count = byte_count * 8u;
+    for (size_t i = 0; i < 8u; ++i)
+        last[last_size - 1u - i] = static_cast<unsigned char>(bit_count >> (8u * i));
+
+    for (size_t offset = 0; offset < last_size; offset += 64u)
+        sha256_compress(state, last.data() + offset);
+
+    block_hash result{};
+    for (size_t i = 0; i < result.size(); ++i)
+        result[i] = static_cast<uint8_t>(state[i / 4u] >> (24u - 8u * (i % 4u)));
+
+    return result;
+}
+
+std::filesystem::path version_store::block_path(std::filesystem::path const & block_directory,
+                                                block_hash const & hash)
+{
+    static constexpr std::string_view digits{"0123456789abcdef"};
+    std::string name(2u * hash.size(), '0');
+
+    for (size_t i = 0; i < hash.size(); ++i)
+    {
+        name[2u * i] = digits[hash[i] >> 4];
+        name[2u * i + 1u] = digits[hash[i] & 15u];
+    }
+
+    return block_directory / name.substr(0, 2) / name;
+}
+
+std::filesystem::path version_store::block_directory(std::filesystem::path const & manifest)
+{
+    return manifest.parent_path() / "blocks";
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// versioned_ostreambuf
+// ---------------------------------------------------------------------------------------------------------------------
+
+//!\brief Whether the block at `path` exists and consists of `words` words with the given hash.
+static bool block_is_valid(std::filesystem::path const & path,
+                           version_store::block_hash const & hash,
+                           size_t const words)
+{
+    std::error_code ec{};
+    uintmax_t const size = std::filesystem::file_size(path, ec);
+    if (ec || size != words * sizeof(uint64_t))
+        return false;
+
+    std::vector<uint64_t> content(words);
+    std::ifstream file{path, std::ios::binary};
+    return file.read(reinterpret_cast<char *>(content.data()), content.size() * sizeof(uint64_t)) &&
+           version_store::hash(content.data(), content.size()) == hash;
+}
+
+versioned_ostreambuf::versioned_ostreambuf(std::filesystem::path const & manifest,
+                                           uint64_t const * const payload,
+                                           size_t const rows,
+                                           size_t const bin_words,
+                                           size_t const threads) :
+    payload_ostreambuf{reinterpret_cast<char const *>(payload), rows * bin_words * sizeof(uint64_t)},
+    manifest{manifest},
+    rows{rows},
+    bin_words{bin_words},
+    threads{std::max<size_t>(1u, threads)}
+{}
+
+void versioned_ostreambuf::close()
+{
+    check_payload_written();
+
+    std::ofstream file{manifest, std::ios::binary};
+    file.write(magic_string.data(), magic_string.size());
+    write_value(file, format_version);
+    write_value(file, static_cast<uint64_t>(rows));
+    write_value(file, static_cast<uint64_t>(bin_words));
+    write_value(file, static_cast<uint64_t>(version_store::block_rows(bin_words)));
+    write_bytes(file, header);
+    write_bytes(file, trailer);
+    write_value(file, static_cast<uint64_t>(hashes.size()));
+    file.write(reinterpret_cast<char const *>(hashes.data()), hashes.size() * sizeof(version_store::block_hash));
+    file.close();
+
+    if (!file)
+        throw seqan3::argument_parser_error{"Failed to write " + manifest.string() + '.'}; // LCOV_EXCL_LINE
+}
+
+void versioned_ostreambuf::write_payload()
+{
+    uint64_t const * const words = reinterpret_cast<uint64_t const *>(payload);
+    std::filesystem::path const block_directory = version_store::block_directory(manifest);
+    size_t const block_rows = version_store::block_rows(bin_words);
+    size_t const group_count = (rows + block_rows - 1u) / block_rows;
+    std::string const suffix = ".tmp" + std::to_string(std::random_device{}());
+
+    hashes.resize(group_count * bin_words);
+
+    parallel_for(hashes.size(), threads, [&] (size_t const block)
+    {
+        size_t const first_row = (block / bin_words) * block_rows;
+        size_t const word = block % bin_words;
+        size_t const row_count = std::min(block_rows, rows - first_row);
+
+        std::vector<uint64_t> column(row_count);
+        for (size_t row = 0; row < row_count; ++row)
+            column[row] = words[(first_row + row) * bin_words + word];
+
+        hashes[block] = version_store::hash(column.data(), column.size());
+        std::filesystem::path const path = version_store::block_path(block_directory, hashes[block]);
+
+        if (block_is_valid(path, hashes[block], column.size()))
+            return;
+
+        // Other processes may write the same block; renaming the complete block is atomic.
+        // A truncated or corrupted block is replaced.
+        std::error_code ec{};
+        std::filesystem::create_directories(path.parent_path(), ec);
+        std::filesystem::path const temporary_path = path.string() + suffix + '_' + std::to_string(block);
+        {
+            std::ofstream file{temporary_path, std::ios::binary};
+            file.write(reinterpret_cast<char const *>(column.data()), column.size() * sizeof(uint64_t));
+            file.close();
+
+            if (!file)
+                throw seqan3::argument_parser_error{"Failed to write " + temporary_path.string() + '.'};
+        }
+        std::filesystem::rename(temporary_path, path);
+    });
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// versioned_istreambuf
+// ---------------------------------------------------------------------------------------------------------------------
+
+versioned_istreambuf::versioned_istreambuf(std::streambuf * manifest,
+                                           std::filesystem::path const & block_directory,
+                                           size_t const threads) :
+    block_directory{block_directory},
+    threads{std::max<size_t>(1u, threads)}
+{
+    std::array<char, magic_string.size()> magic{};
+    manifest->sgetn(magic.data(), magic.size());
+
+    if (std::string_view{magic.data(), magic.size()} != magic_string || read_value<uint32_t>(manifest) != format_version)
+        throw seqan3::argument_parser_error{"Cannot read index: Unsupported version manifest."};
+
+    rows = read_value<uint64_t>(manifest);
+    bin_words = read_value<uint64_t>(manifest);
+    size_t const block_rows = read_value<uint64_t>(manifest);
+    header = read_bytes(manifest);
+    trailer = read_bytes(manifest);
+    hashes.resize(read_value<uint64_t>(manifest));
+
+    std::streamsize const hash_bytes = hashes.size() * sizeof(version_store::block_hash);
+    if (manifest->sgetn(reinterpret_cast<char *>(hashes.data()), hash_bytes) != hash_bytes)
+        throw seqan3::argument_parser_error{"Cannot read index: Unexpected end of version manifest."};
+
+    group_count = block_rows ? (rows + block_rows - 1u) / block_rows : 0u;
+    if (block_rows != version_store::block_rows(bin_words) || hashes.size() != group_count * bin_words)
+        throw seqan3::argument_parser_error{"Cannot read index: Corrupted version manifest."};
+
+    if (group_count > 0u)
+        pending = std::async(std::launch::async, &versioned_istreambuf::read_group, this, 0u, std::ref(next));
+}
+
+versioned_istreambuf::~versioned_istreambuf()
+{
+    if (pending.valid())
+        pending.wait();
+}
+
+versioned_istreambuf::int_type versioned_istreambuf::underflow()
+{
+    if (gptr() < egptr())
+        return traits_type::to_int_type(*gptr());
+
+    // Segment 0 is the header, segments 1 to group_count are the groups of rows, and the last segment is the trailer.
+    while (next_segment <= group_count + 1u)
+    {
+        size_t const segment = next_segment++;
+
+        if (segment == 0u)
+        {
+            setg(header.data(), header.data(), header.data() + header.size());
+        }
+        else if (segment <= group_count)
+        {
+            pending.get();
+            std::swap(current, next);
+            setg(current.data(), current.data(), current.data() + current.size());
+
+            if (segment < group_count)
+                pending = std::async(std::launch::async,
+                                     &versioned_istreambuf::read_group,
+                                     this,
+                                     segment,
+                                     std::ref(next));
+        }
+        else
+        {
+            setg(trailer.data(), trailer.data(), trailer.data() + trailer.size());
+        }
+
+        if (gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+    }
+
+    return traits_type::eof();
+}
+
+void versioned_istreambuf::read_group(size_t const group, std::vector<char> & output) const
+{
+    size_t const block_rows = version_store::block_rows(bin_words);
+    size_t const first_row = group * block_rows;
+    size_t const row_count = std::min(block_rows, rows - first_row);
+
+    output.resize(row_count * bin_words * sizeof(uint64_t));
+
+    parallel_for(bin_words, threads, [&] (size_t const word)
+    {
+        version_store::block_hash const & hash = hashes[group * bin_words + word];
+        std::filesystem::path const path = version_store::block_path(block_directory, hash);
+        std::vector<uint64_t> column(row_count);
+
+        std::ifstream file{path, std::ios::binary};
+        if (!file.read(reinterpret_cast<char *>(column.data()), column.size() * sizeof(uint64_t)) ||
+            file.peek() != std::ifstream::traits_type::eof())
+            throw seqan3::argument_parser_error{"Cannot read index: Missing or truncated block " + path.string() + '.'};
+
+        if (version_store::hash(column.data(), column.size()) != hash)
+            throw seqan3::argument_parser_error{"Cannot read index: Corrupted block " + path.string() + '.'};
+
+        for (size_t row = 0; row < row_count; ++row)
+            std::memcpy(output.data() + ((row * bin_words + word) * sizeof(uint64_t)),
+                        &column[row],
+                        sizeof(uint64_t));
+    });
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// is_versioned
+// ---------------------------------------------------------------------------------------------------------------------
+
+bool is_versioned(std::istream & stream)
+{
+    std::array<char, magic_string.size()> magic{};
+    auto const position = stream.tellg();
+    stream.read(magic.data(), magic.size());
+    bool const result = stream.gcount() == static_cast<std::streamsize>(magic.size()) &&
+                        std::string_view{magic.data(), magic.size()} == magic_string;
+    stream.clear();
+    stream.seekg(position);
+    return result;
+}
+
+uint64_t versioned_size(std::streambuf * manifest)
+{
+    std::array<char, magic_string.size()> magic{};
+    manifest->sgetn(magic.data(), magic.size());
+
+    if (std::string_view{magic.data(), magic.size()} != magic_string || read_value<uint32_t>(manifest) != format_version)
+        throw seqan3::argument_parser_error{"Cannot read index: Unsupported version manifest."};
+
+    uint64_t const rows = read_value<uint64_t>(manifest);
+    uint64_t const bin_words = read_value<uint64_t>(manifest);
+    read_value<uint64_t>(manifest); // block_rows
+    uint64_t const header_size = read_bytes(manifest).size();
+    uint64_t const trailer_size = read_bytes(manifest).size();
+
+    return header_size + rows * bin_words * sizeof(uint64_t) + trailer_size;
+}
+
+} // namespace raptor::detail
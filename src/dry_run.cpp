@@ -0,0 +1,333 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <seqan3/std/filesystem>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
+
+#include <seqan3/io/sequence_file/input.hpp>
+#include <seqan3/search/dream_index/interleaved_bloom_filter.hpp>
+
+#include <raptor/detail/block_compression.hpp>
+#include <raptor/detail/for_each_minimiser.hpp>
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/dry_run.hpp>
+#include <raptor/index.hpp>
+
+namespace raptor
+{
+
+static std::string format_bytes(uint64_t const bytes)
+{
+    static constexpr std::array<char const *, 6> units{"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+    double value = bytes;
+    size_t unit{};
+
+    while (value >= 1024.0 && unit + 1u < units.size())
+    {
+        value /= 1024.0;
+        ++unit;
+    }
+
+    std::ostringstream result{};
+    result << std::fixed << std::setprecision(2) << value << ' ' << units[unit];
+    return result.str();
+}
+
+static std::string format_seconds(double const seconds)
+{
+    std::ostringstream result{};
+    result << std::fixed << std::setprecision(1);
+
+    if (seconds < 60.0)
+        result << seconds << " s";
+    else if (seconds < 3600.0)
+        result << seconds / 60.0 << " min";
+    else
+        result << seconds / 3600.0 << " h";
+
+    return result.str();
+}
+
+static double seconds_since(std::chrono::high_resolution_clock::time_point const start)
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+//!\brief Whether the file is compressed. The file size then underestimates the size of the sequences.
+static bool is_compressed_file(std::filesystem::path const & path)
+{
+    static constexpr std::array<std::string_view, 3> compression_extensions{".gz", ".bgzf", ".bz2"};
+    return std::ranges::find(compression_extensions, path.extension().string()) != compression_extensions.end();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// raptor build
+// ---------------------------------------------------------------------------------------------------------------------
+
+void dry_run(build_arguments const & arguments, std::ostream & out)
+{
+    std::vector<std::pair<uint64_t, std::string>> files{};
+    uint64_t input_bytes{};
+    uint64_t largest_bin_bytes{};
+
+    for (auto const & file_list : arguments.bin_path)
+    {
+        uint64_t bin_bytes{};
+        for (auto const & file_name : file_list)
+        {
+            uint64_t const size = std::filesystem::file_size(file_name);
+            files.emplace_back(size, file_name);
+            bin_bytes += size;
+        }
+        input_bytes += bin_bytes;
+        largest_bin_bytes = std::max(largest_bin_bytes, bin_bytes);
+    }
+
+    // Compute the minimisers of the smallest files, up to 64 MiB but at least one file.
+    bool const from_minimiser = std::filesystem::path{arguments.bin_path[0][0]}.extension() == ".minimiser";
+    uint64_t sample_bytes{};
+    uint64_t sample_minimisers{};
+    size_t sample_files{};
+    double sample_time{};
+
+    if (!from_minimiser)
+    {
+        std::sort(files.begin(), files.end());
+        detail::streaming_minimiser minimiser{arguments.shape,
+                                              arguments.window_size,
+                                              adjust_seed(arguments.shape.count())};
+        auto count = [&sample_minimisers] (uint64_t const, uint64_t const) { ++sample_minimisers; };
+
+        auto const start = std::chrono::high_resolution_clock::now();
+        for (auto const & [size, file_name] : files)
+        {
+            if (sample_files > 0u && sample_bytes + size > (64ULL << 20))
+                break;
+
+            detail::for_each_minimiser(file_name, minimiser, count);
+
+            sample_bytes += size;
+            ++sample_files;
+        }
+        sample_time = seconds_since(start);
+    }
+
+    double const minimisers_per_byte = sample_bytes ? static_cast<double>(sample_minimisers) / sample_bytes : 0.0;
+    size_t const parallel_bins = std::max<size_t>(1u, std::min<size_t>(arguments.threads, arguments.bins));
+
+    out << "raptor build --dry-run\n";
+    out << "Input:            " << files.size() << " files in " << arguments.bins << " bins, "
+        << format_bytes(input_bytes) << '\n';
+
+    if (arguments.compute_minimiser)
+    {
+        // Each thread counts the minimisers of one bin in a hash table of about 16 bytes per entry.
+        uint64_t const table_bytes = static_cast<uint64_t>(largest_bin_bytes * minimisers_per_byte) * 16u *
+                                     parallel_bins;
+        out << "Peak memory:      " << format_bytes(table_bytes) << " (minimiser counts of "
+            << parallel_bins << " bins)\n";
+        out << "Disk I/O:         read " << format_bytes(input_bytes) << ", write about "
+            << format_bytes(static_cast<uint64_t>(input_bytes * minimisers_per_byte * 8u)) << '\n';
+    }
+    else
+    {
+        size_t const technical_bins = ((arguments.bins + 63u) >> 6) << 6;
+        uint64_t const ibf_bytes = arguments.bits * technical_bins / 8u;
+        uint64_t buffer_bytes{};
+        if (arguments.strategy == "transpose")
+            buffer_bytes = 8u * arguments.bits * arguments.threads;
+        else if (arguments.strategy == "rows")
+            buffer_bytes = uint64_t{4096u} * 8u * arguments.threads * arguments.threads;
+        // The compressed IBF is built from the uncompressed one.
+        uint64_t const compressed_bytes = arguments.compressed ? ibf_bytes : 0u;
+        // With more than one thread, the previous part is written while the next one is built.
+        uint64_t const written_bytes = arguments.parts > 1u && arguments.threads > 1u ? ibf_bytes : 0u;
+
+        out << "Index:            " << static_cast<size_t>(arguments.parts) << " part(s) of "
+            << format_bytes(ibf_bytes) << " (" << technical_bins << " technical bins of " << arguments.bits
+            << " bits)\n";
+        out << "Peak memory:      " << format_bytes(ibf_bytes + buffer_bytes + compressed_bytes + written_bytes)
+            << '\n';
+        out << "  IBF:            " << format_bytes(ibf_bytes) << '\n';
+        if (arguments.compressed)
+            out << "  Compressed IBF: at most " << format_bytes(compressed_bytes) << '\n';
+        if (written_bytes)
+            out << "  Previous part:  at most " << format_bytes(written_bytes) << " (being written)\n";
+        if (buffer_bytes)
+            out << "  Thread buffers: " << format_bytes(buffer_bytes) << " (--strategy " << arguments.strategy << ")\n";
+        // Each part reads all input files.
+        out << "Disk I/O:         read " << format_bytes(input_bytes * arguments.parts) << ", write at most "
+            << format_bytes(ibf_bytes * arguments.parts) << '\n';
+    }
+
+    if (sample_time > 0.0)
+    {
+        double const bytes_per_second = sample_bytes / sample_time;
+        size_t const passes = arguments.compute_minimiser ? 1u : arguments.parts;
+
+        out << "Throughput:       " << format_bytes(static_cast<uint64_t>(bytes_per_second)) << "/s of input per thread (sampled "
+            << sample_files << " files, " << format_bytes(sample_bytes) << ")\n";
+        out << "Estimated time:   at least "
+            << format_seconds(input_bytes * passes / bytes_per_second / parallel_bins) << " with "
+            << parallel_bins << " threads\n";
+    }
+    else
+    {
+        out << "Estimated time:   not available for minimiser files\n";
+    }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// raptor search
+// ---------------------------------------------------------------------------------------------------------------------
+
+void dry_run(search_arguments const & arguments, std::ostream & out)
+{
+    auto part_path = [&] (size_t const part)
+    {
+        return arguments.parts == 1u ? arguments.index_file.string() :
+                                       arguments.index_file.string() + "_" + std::to_string(part);
+    };
+
+    // The serialised size: Block-compressed parts are decompressed and versioned parts include their blocks.
+    uint64_t index_bytes{};
+    uint64_t largest_part_bytes{};
+    for (size_t part{0}; part < arguments.parts; ++part)
+    {
+        uint64_t const size = detail::index_size(part_path(part));
+        index_bytes += size;
+        largest_part_bytes = std::max(largest_part_bytes, size);
+    }
+
+    // The serialised IBF starts with bins, technical bins, bin size, hash shift, bin words, and hash count.
+    size_t bins{}, technical_bins{}, bin_size{}, hash_shift{}, bin_words{}, hash_count{};
+    {
+        detail::index_istream is{part_path(0u)};
+        cereal::BinaryInputArchive iarchive{is};
+        raptor_index<> tmp{};
+        tmp.load_parameters(iarchive);
+        iarchive(bins, technical_bins, bin_size, hash_shift, bin_words, hash_count);
+    }
+
+    uint64_t const part_memory = arguments.compressed ? largest_part_bytes : bin_size * technical_bins / 8u;
+    uint64_t const index_memory = arguments.parts_resident ? (arguments.compressed ? index_bytes :
+                                                                                     part_memory * arguments.parts) :
+                                                             part_memory;
+
+    // Sample the first reads.
+    std::filesystem::path const query_file = arguments.query_files.empty() ? arguments.query_file :
+                                                                             arguments.query_files.front();
+    uint64_t query_bytes{};
+    if (arguments.query_files.empty())
+        query_bytes = std::filesystem::file_size(arguments.query_file);
+    for (auto const & file : arguments.query_files)
+        query_bytes += std::filesystem::file_size(file);
+
+    seqan3::sequence_file_input<dna5_traits, seqan3::fields<seqan3::field::id, seqan3::field::seq>> fin{query_file};
+    using record_type = typename decltype(fin)::record_type;
+    std::vector<record_type> sample{};
+    bool sample_is_complete{true};
+
+    for (auto & record : fin)
+    {
+        if (sample.size() == 10000u)
+        {
+            sample_is_complete = false;
+            break;
+        }
+        sample.push_back(std::move(record));
+    }
+
+    uint64_t sample_bases{};
+    uint64_t sample_id_bytes{};
+    for (auto & [id, seq] : sample)
+    {
+        sample_bases += seq.size();
+        sample_id_bytes += id.size();
+    }
+
+    double const average_length = sample.empty() ? 0.0 : static_cast<double>(sample_bases) / sample.size();
+    double const average_id = sample.empty() ? 0.0 : static_cast<double>(sample_id_bytes) / sample.size();
+
+    // Estimate the number of reads from the file size and the size of a record in FASTA or FASTQ format.
+    uint64_t reads{sample.size()};
+    if (!sample_is_complete)
+    {
+        std::filesystem::path uncompressed = query_file;
+        bool const compressed_query = is_compressed_file(query_file);
+        if (compressed_query)
+            uncompressed = uncompressed.stem();
+        std::string const extension = uncompressed.extension().string();
+        bool const is_fastq = extension == ".fq" || extension == ".fastq";
+
+        double const record_bytes = is_fastq ? 2.0 * average_length + average_id + 6.0 :
+                                               average_length * 81.0 / 80.0 + average_id + 2.0;
+        // Assume that gzip compresses sequence files about 3.5-fold.
+        reads = static_cast<uint64_t>(query_bytes * (compressed_query ? 3.5 : 1.0) / record_bytes);
+    }
+
+    // Process the sample with an IBF of the same shape, capped at 256 MiB.
+    size_t const sample_bin_size = std::clamp<size_t>((256ULL << 23) / technical_bins, 1u, bin_size);
+    seqan3::interleaved_bloom_filter<> ibf{seqan3::bin_count{bins},
+                                           seqan3::bin_size{sample_bin_size},
+                                           seqan3::hash_function_count{hash_count}};
+    auto counter = ibf.counting_agent<uint16_t>();
+    detail::sequence_minimiser hasher{arguments.shape, arguments.window_size, adjust_seed(arguments.shape_weight)};
+    std::vector<uint64_t> minimiser{};
+
+    auto const start = std::chrono::high_resolution_clock::now();
+    for (auto & [id, seq] : sample)
+    {
+        hasher(seq, minimiser);
+        counter.bulk_count(minimiser);
+    }
+    double const sample_time = seconds_since(start);
+
+    uint64_t const batch = std::max<uint64_t>(1u, std::min<uint64_t>(arguments.batch_size, reads));
+    uint64_t const batches = (reads + batch - 1u) / batch;
+    uint64_t const record_memory = batch * static_cast<uint64_t>(average_length + average_id + 64u);
+    uint64_t const counts_memory = arguments.parts > 1u ? batch * technical_bins * 2u : 0u;
+    uint64_t const agent_memory = uint64_t{arguments.threads} * technical_bins * 2u;
+    uint64_t const index_reads = arguments.parts > 1u && !arguments.parts_resident ? index_bytes * batches :
+                                                                                      index_bytes;
+
+    out << "raptor search --dry-run\n";
+    out << "Index:            " << static_cast<size_t>(arguments.parts) << " part(s), " << format_bytes(index_bytes)
+        << " serialised, " << bins << " bins of " << bin_size << " bits, " << hash_count << " hash functions\n";
+    out << "Queries:          " << (sample_is_complete ? "" : "about ") << reads << " reads of "
+        << std::fixed << std::setprecision(1) << average_length << " bases on average, "
+        << format_bytes(query_bytes) << '\n';
+    out << "Batches:          " << batches << " of " << batch << " reads\n";
+    out << "Peak memory:      " << format_bytes(index_memory + record_memory + counts_memory + agent_memory) << '\n';
+    out << "  IBF:            " << format_bytes(index_memory)
+        << (arguments.parts_resident ? " (all parts resident)\n" : "\n");
+    out << "  Reads:          " << format_bytes(record_memory) << '\n';
+    if (counts_memory)
+        out << "  Counts:         " << format_bytes(counts_memory) << '\n';
+    out << "  Thread buffers: " << format_bytes(agent_memory) << '\n';
+    out << "Disk I/O:         read " << format_bytes(index_reads) << " of index and " << format_bytes(query_bytes)
+        << " of queries\n";
+
+    if (sample.empty() || sample_time <= 0.0)
+    {
+        out << "Estimated time:   not available for empty query files\n";
+        return;
+    }
+
+    double const reads_per_second = sample.size() / sample_time;
+    out << "Throughput:       " << std::setprecision(0) << reads_per_second << " reads/s per thread (sampled "
+        << sample.size() << " reads)\n";
+    out << "Estimated time:   at least " << format_seconds(reads * arguments.parts / reads_per_second / arguments.threads)
+        << " of computation with " << static_cast<size_t>(arguments.threads) << " threads\n";
+}
+
+} // namespace raptor
@@ -5,8 +5,12 @@
 // shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
 // -----------------------------------------------------------------------------------------------------
 
+#include <raptor/search/run_program_containment.hpp>
+#include <raptor/search/run_program_delta.hpp>
+#include <raptor/search/run_program_out_of_core.hpp>
 #include <raptor/search/run_program_single.hpp>
 #include <raptor/search/run_program_single_socks.hpp>
+#include <raptor/search/run_program_stream.hpp>
 #include <raptor/search/run_program_multiple.hpp>
 
 namespace raptor
@@ -14,7 +18,32 @@ namespace raptor
 
 void raptor_search(search_arguments const & arguments)
 {
-    if (arguments.parts == 1)
+    if (arguments.containment)
+    {
+        if (arguments.compressed)
+            run_program_containment<true>(arguments);
+        else
+            run_program_containment<false>(arguments);
+    }
+    else if (arguments.stream)
+    {
+        if (arguments.compressed)
+            run_program_stream<true>(arguments);
+        else
+            run_program_stream<false>(arguments);
+    }
+    else if (!arguments.previous_output.empty())
+    {
+        if (arguments.compressed)
+            run_program_delta<true>(arguments);
+        else
+            run_program_delta<false>(arguments);
+    }
+    else if (arguments.out_of_core)
+    {
+        run_program_out_of_core(arguments);
+    }
+    else if (arguments.parts == 1)
     {
         if (arguments.is_socks)
         {
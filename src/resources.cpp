@@ -0,0 +1,200 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#include <raptor/resources.hpp>
+
+namespace raptor
+{
+
+//!\brief Reads the first line of a file. Returns an empty string if the file cannot be read.
+static std::string read_line(std::filesystem::path const & path)
+{
+    std::ifstream file{path};
+    std::string line{};
+    std::getline(file, line);
+    return line;
+}
+
+//!\brief Parses an unsigned number with an optional K, M, or G suffix. Returns 0 if there is no number.
+static uint64_t parse_size(std::string const & value)
+{
+    size_t end{};
+    uint64_t result{};
+
+    try
+    {
+        result = std::stoull(value, &end);
+    }
+    catch (std::exception const &)
+    {
+        return 0u;
+    }
+
+    if (end < value.size())
+    {
+        switch (value[end])
+        {
+            case 'G': result <<= 10; [[fallthrough]];
+            case 'M': result <<= 10; [[fallthrough]];
+            case 'K': result <<= 10;
+        }
+    }
+
+    return result;
+}
+
+//!\brief The cgroup v2 directory of this process, or an empty path if cgroup v2 is not used.
+static std::filesystem::path cgroup_v2_directory(std::filesystem::path const & root)
+{
+    std::filesystem::path const cgroup_root = root / "sys/fs/cgroup";
+
+    if (!std::filesystem::exists(cgroup_root / "cgroup.controllers"))
+        return {};
+
+    std::ifstream file{root / "proc/self/cgroup"};
+    std::string line{};
+
+    while (std::getline(file, line))
+    {
+        if (line.rfind("0::", 0) == 0)
+        {
+            std::filesystem::path const directory{cgroup_root.string() + line.substr(3)};
+            // In a container, the own cgroup is usually mounted as root.
+            if (std::filesystem::exists(directory / "cpu.max") || std::filesystem::exists(directory / "memory.max"))
+                return directory;
+            return cgroup_root;
+        }
+    }
+
+    return {};
+}
+
+static size_t detect_cpus(resource_sources const & sources, std::filesystem::path const & cgroup)
+{
+    size_t cpus = std::max<size_t>(1u, std::thread::hardware_concurrency());
+
+    if (sources.affinity_cpus.has_value())
+    {
+        cpus = std::max<size_t>(1u, *sources.affinity_cpus);
+    }
+    else
+    {
+#ifdef __linux__
+        cpu_set_t set{};
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            cpus = std::max(1, CPU_COUNT(&set));
+#endif
+    }
+
+    double quota{};
+    double period{};
+
+    if (!cgroup.empty())
+    {
+        // "max 100000" or "<quota> <period>"
+        std::string const line = read_line(cgroup / "cpu.max");
+        if (size_t const space = line.find(' '); space != std::string::npos && line.substr(0, space) != "max")
+        {
+            quota = parse_size(line.substr(0, space));
+            period = parse_size(line.substr(space + 1));
+        }
+    }
+    else
+    {
+        std::string const line = read_line(sources.root / "sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        if (!line.empty() && line[0] != '-')
+        {
+            quota = parse_size(line);
+            period = parse_size(read_line(sources.root / "sys/fs/cgroup/cpu/cpu.cfs_period_us"));
+        }
+    }
+
+    if (quota > 0 && period > 0)
+        cpus = std::clamp<size_t>(std::ceil(quota / period), 1u, cpus);
+
+    return cpus;
+}
+
+static uint64_t detect_memory(resource_sources const & sources, std::filesystem::path const & cgroup)
+{
+    uint64_t memory{};
+
+    if (long const pages = sysconf(_SC_PHYS_PAGES), page_size = sysconf(_SC_PAGE_SIZE); pages > 0 && page_size > 0)
+        memory = static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+
+    // cgroup v2 reports "max" and cgroup v1 a very large number if there is no limit.
+    uint64_t const limit = parse_size(read_line(cgroup.empty() ?
+                                                    sources.root / "sys/fs/cgroup/memory/memory.limit_in_bytes" :
+                                                    cgroup / "memory.max"));
+
+    if (limit > 0u && (memory == 0u || limit < memory))
+        memory = limit;
+
+    return memory;
+}
+
+static size_t detect_numa_nodes(std::filesystem::path const & root)
+{
+    size_t nodes{};
+    std::error_code ec{};
+
+    for (auto const & entry : std::filesystem::directory_iterator{root / "sys/devices/system/node", ec})
+    {
+        std::string const name = entry.path().filename().string();
+        if (name.size() > 4u && name.rfind("node", 0) == 0 && std::isdigit(name[4]))
+            ++nodes;
+    }
+
+    return std::max<size_t>(1u, nodes);
+}
+
+static uint64_t detect_l3_cache(std::filesystem::path const & root)
+{
+    std::error_code ec{};
+
+    for (auto const & entry : std::filesystem::directory_iterator{root / "sys/devices/system/cpu/cpu0/cache", ec})
+    {
+        if (read_line(entry.path() / "level") == "3")
+            return parse_size(read_line(entry.path() / "size"));
+    }
+
+    return 0u;
+}
+
+system_resources detect_resources(resource_sources const & sources)
+{
+    std::filesystem::path const cgroup = cgroup_v2_directory(sources.root);
+
+    system_resources resources{};
+    resources.cpus = detect_cpus(sources, cgroup);
+    resources.memory = detect_memory(sources, cgroup);
+    resources.numa_nodes = detect_numa_nodes(sources.root);
+    resources.l3_cache = detect_l3_cache(sources.root);
+    return resources;
+}
+
+uint8_t default_threads(system_resources const & resources)
+{
+    return static_cast<uint8_t>(std::min<size_t>(resources.cpus, std::numeric_limits<uint8_t>::max()));
+}
+
+} // namespace raptor
@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include <seqan3/test/tmp_filename.hpp>
+
+#include <raptor/search/detail/abundance_estimator.hpp>
+
+using raptor::detail::abundance_estimator;
+
+// Adds `count` reads hitting `bins` to `agent`.
+void add_reads(abundance_estimator::agent & agent, std::vector<size_t> const & bins, size_t const count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t const bin : bins)
+            agent.add(bin);
+        agent.next_read();
+    }
+}
+
+std::string write(abundance_estimator const & estimator)
+{
+    seqan3::test::tmp_filename tmp{"abundance.out"};
+    {
+        raptor::sync_out out{tmp.get_path()};
+        estimator.write(out);
+    }
+    std::ifstream file{tmp.get_path()};
+    return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+// Reads hitting bins 0 and 1 are explained by bin 0, which also has unique reads.
+std::string const expected{"#UNCLASSIFIED_READS\t3\n"
+                           "#BIN\tREADS\tABUNDANCE\n"
+                           "0\t20.00\t1.000000\n"
+                           "1\t0.00\t0.000000\n"};
+
+TEST(abundance_estimator, converges)
+{
+    abundance_estimator estimator{2u};
+    {
+        abundance_estimator::agent agent{estimator};
+        add_reads(agent, {0u}, 10u);
+        add_reads(agent, {0u, 1u}, 10u);
+        add_reads(agent, {}, 3u);
+    }
+
+    EXPECT_EQ(write(estimator), expected);
+}
+
+TEST(abundance_estimator, merges_agents)
+{
+    abundance_estimator estimator{2u};
+    {
+        std::vector<abundance_estimator::agent> agents{};
+        for (size_t i = 0; i < 3u; ++i)
+            agents.emplace_back(estimator); // Moves the agents when the vector grows.
+
+        add_reads(agents[0], {0u}, 10u);
+        add_reads(agents[0], {}, 2u);
+        add_reads(agents[1], {0u, 1u}, 4u);
+        add_reads(agents[2], {0u, 1u}, 6u);
+        add_reads(agents[2], {}, 1u);
+
+        // Only the agent moved to is merged.
+        abundance_estimator::agent moved{std::move(agents[2])};
+    }
+
+    EXPECT_EQ(write(estimator), expected);
+}
+
+TEST(abundance_estimator, empty)
+{
+    abundance_estimator estimator{2u};
+    {
+        abundance_estimator::agent agent{estimator};
+        add_reads(agent, {}, 3u);
+    }
+
+    EXPECT_EQ(write(estimator), "#UNCLASSIFIED_READS\t3\n"
+                                "#BIN\tREADS\tABUNDANCE\n"
+                                "0\t0.00\t0.000000\n"
+                                "1\t0.00\t0.000000\n");
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <random>
+
+#include <raptor/detail/bin_similarity.hpp>
+#include <raptor/index.hpp>
+
+// An index with the given number of bins and rows. Bin `i` is stored as "bin_i.fa".
+raptor::raptor_index<> make_index(size_t const bin_count, size_t const bin_size)
+{
+    std::vector<std::vector<std::string>> bin_path{};
+    for (size_t bin = 0; bin < bin_count; ++bin)
+        bin_path.push_back({"bin_" + std::to_string(bin) + ".fa"});
+
+    return raptor::raptor_index<>{raptor::window{19u},
+                                  seqan3::shape{seqan3::ungapped{19u}},
+                                  1u,
+                                  false,
+                                  bin_path,
+                                  seqan3::interleaved_bloom_filter<>{seqan3::bin_count{bin_count},
+                                                                     seqan3::bin_size{bin_size},
+                                                                     seqan3::hash_function_count{2u}}};
+}
+
+// The bit of `bin` in `row`.
+bool bit(raptor::raptor_index<> const & index, size_t const row, size_t const bin)
+{
+    size_t const bin_words = (index.ibf().bin_count() + 63u) >> 6;
+    return index.ibf().raw_data()[row * bin_words * 64u + bin];
+}
+
+void set_bit(raptor::raptor_index<> & index, size_t const row, size_t const bin)
+{
+    size_t const bin_words = (index.ibf().bin_count() + 63u) >> 6;
+    index.ibf().raw_data()[row * bin_words * 64u + bin] = true;
+}
+
+TEST(permute_bins, moves_bits_paths_and_fill_rates)
+{
+    // Neither the number of bins nor the number of rows is a multiple of 64.
+    size_t const bin_count{130u};
+    size_t const bin_size{200u};
+    raptor::raptor_index<> index = make_index(bin_count, bin_size);
+
+    std::mt19937_64 engine{42u};
+    for (size_t row = 0; row < bin_size; ++row)
+        for (size_t bin = 0; bin < bin_count; ++bin)
+            if (engine() % 3u == 0u)
+                set_bit(index, row, bin);
+    index.compute_fill_rates();
+
+    raptor::raptor_index<> const original{index};
+    std::vector<size_t> order(bin_count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::shuffle(order.begin(), order.end(), engine);
+
+    index.permute_bins(order, 3u);
+
+    for (size_t bin = 0; bin < bin_count; ++bin)
+    {
+        for (size_t row = 0; row < bin_size; ++row)
+            ASSERT_EQ(bit(index, row, bin), bit(original, row, order[bin])) << "bin " << bin << ", row " << row;
+
+        EXPECT_EQ(index.bin_path()[bin], original.bin_path()[order[bin]]);
+        EXPECT_EQ(index.fill_rates()[bin], original.fill_rates()[order[bin]]);
+    }
+
+    // The unused columns of the last word stay empty.
+    for (size_t row = 0; row < bin_size; ++row)
+        for (size_t bin = bin_count; bin < 192u; ++bin)
+            EXPECT_FALSE(index.ibf().raw_data()[row * 192u + bin]);
+}
+
+struct bin_similarity_test : public ::testing::Test
+{
+    // Bin 0 has rows [0, 100), bin 1 rows [50, 150), bin 2 the same rows as bin 0, and bin 3 is empty.
+    raptor::raptor_index<> index = []
+    {
+        raptor::raptor_index<> result = make_index(4u, 256u);
+        for (size_t row = 0; row < 100u; ++row)
+        {
+            set_bit(result, row, 0u);
+            set_bit(result, row + 50u, 1u);
+            set_bit(result, row, 2u);
+        }
+        return result;
+    }();
+
+    std::vector<double> similarity(bool const containment) const
+    {
+        raptor::detail::bin_similarity sampler{index, 1000u, 1u, 2u};
+        sampler.sample(index, 0u);
+        return sampler.matrix(containment);
+    }
+};
+
+TEST_F(bin_similarity_test, jaccard)
+{
+    std::vector<double> const expected{1.0,       1.0 / 3.0, 1.0,       0.0,
+                                       1.0 / 3.0, 1.0,       1.0 / 3.0, 0.0,
+                                       1.0,       1.0 / 3.0, 1.0,       0.0,
+                                       0.0,       0.0,       0.0,       0.0};
+    std::vector<double> const actual = similarity(false);
+
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_DOUBLE_EQ(actual[i], expected[i]) << "row " << i / 4u << ", column " << i % 4u;
+}
+
+TEST_F(bin_similarity_test, containment)
+{
+    std::vector<double> const expected{1.0, 0.5, 1.0, 0.0,
+                                       0.5, 1.0, 0.5, 0.0,
+                                       1.0, 0.5, 1.0, 0.0,
+                                       0.0, 0.0, 0.0, 0.0};
+    std::vector<double> const actual = similarity(true);
+
+    ASSERT_EQ(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_DOUBLE_EQ(actual[i], expected[i]) << "row " << i / 4u << ", column " << i % 4u;
+}
+
+TEST_F(bin_similarity_test, greedy_order)
+{
+    EXPECT_EQ(raptor::detail::bin_similarity::greedy_order(similarity(false), 4u),
+              (std::vector<size_t>{0u, 2u, 1u, 3u}));
+}
+
+TEST_F(bin_similarity_test, partitioned)
+{
+    // Two parts with the same content: Samples are concatenated, hence the similarity does not change.
+    raptor::detail::bin_similarity sampler{index, 64u, 2u, 2u};
+    sampler.sample(index, 0u);
+    sampler.sample(index, 1u);
+
+    raptor::detail::bin_similarity single{index, 64u, 1u, 2u};
+    single.sample(index, 0u);
+
+    EXPECT_EQ(sampler.matrix(false), single.matrix(false));
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <seqan3/argument_parser/exceptions.hpp>
+#include <seqan3/test/tmp_filename.hpp>
+
+#include <raptor/detail/block_compression.hpp>
+
+// More than one block of 16 MiB.
+std::string random_data()
+{
+    std::mt19937_64 engine{42u};
+    std::string result((1ULL << 24) + 1000u, '\0');
+    for (char & character : result)
+        character = "ACGT"[engine() % 4u];
+    return result;
+}
+
+TEST(index_ostream, round_trip)
+{
+    seqan3::test::tmp_filename tmp{"raptor.index"};
+    std::string const data = random_data();
+
+    for (bool const compress : {false, true})
+    {
+        {
+            raptor::detail::index_ostream os{tmp.get_path(), compress, 2u};
+            os.write(data.data(), data.size());
+            os.close();
+        }
+
+        raptor::detail::index_istream is{tmp.get_path(), 2u};
+        std::string const read{std::istreambuf_iterator<char>{is}, std::istreambuf_iterator<char>{}};
+        EXPECT_TRUE(read == data);
+        EXPECT_EQ(raptor::detail::index_size(tmp.get_path()), data.size());
+    }
+}
+
+TEST(index_ostream, write_error)
+{
+    // Every write to /dev/full fails with ENOSPC.
+    if (!std::filesystem::exists("/dev/full"))
+        GTEST_SKIP() << "/dev/full is not available";
+
+    std::string const data = random_data();
+
+    for (bool const compress : {false, true})
+    {
+        raptor::detail::index_ostream os{"/dev/full", compress, 2u};
+        os.write(data.data(), data.size());
+        EXPECT_THROW(os.close(), seqan3::argument_parser_error);
+    }
+}
+
+TEST(index_ostream, open_error)
+{
+    seqan3::test::tmp_filename tmp{"raptor.index"};
+    EXPECT_THROW((raptor::detail::index_ostream{tmp.get_path() / "missing" / "raptor.index", false}),
+                 seqan3::argument_parser_error);
+}
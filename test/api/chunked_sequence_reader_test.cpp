@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <random>
+
+#include <seqan3/alphabet/nucleotide/dna4.hpp>
+#include <seqan3/search/views/minimiser_hash.hpp>
+#include <seqan3/test/tmp_filename.hpp>
+
+#include <raptor/detail/chunked_sequence_reader.hpp>
+#include <raptor/detail/for_each_minimiser.hpp>
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/shared.hpp>
+
+static constexpr uint8_t kmer_size{19u};
+static constexpr uint32_t window_size{23u};
+
+struct chunked_sequence_reader_test : public ::testing::Test
+{
+    seqan3::test::tmp_filename tmp{"sequences.fasta"};
+    std::filesystem::path const file_path{tmp.get_path()};
+
+    // Random sequences of different lengths, some shorter than a window.
+    std::vector<std::string> sequences = []
+    {
+        std::mt19937_64 engine{42u};
+        std::vector<std::string> result{};
+        for (size_t const length : {1000u, 10u, 22u, 23u, 257u})
+        {
+            result.emplace_back(length, 'A');
+            for (char & base : result.back())
+                base = "ACGT"[engine() % 4u];
+        }
+        return result;
+    }();
+
+    // The minimisers of all sequences as computed by seqan3.
+    std::vector<uint64_t> expected_minimisers() const
+    {
+        std::vector<uint64_t> result{};
+        for (std::string const & sequence : sequences)
+        {
+            seqan3::dna4_vector dna{};
+            for (char const base : sequence)
+                dna.push_back(seqan3::assign_char_to(base, seqan3::dna4{}));
+
+            auto hashes = dna | seqan3::views::minimiser_hash(seqan3::ungapped{kmer_size},
+                                                              seqan3::window_size{window_size},
+                                                              seqan3::seed{raptor::adjust_seed(kmer_size)});
+            result.insert(result.end(), hashes.begin(), hashes.end());
+        }
+        return result;
+    }
+
+    // The minimisers of all records in the file, read in chunks of `chunk_size` bytes.
+    std::vector<uint64_t> streamed_minimisers(size_t const chunk_size) const
+    {
+        std::vector<uint64_t> result{};
+        raptor::detail::streaming_minimiser minimiser{seqan3::ungapped{kmer_size},
+                                                      window_size,
+                                                      raptor::adjust_seed(kmer_size)};
+        auto store = [&result] (uint64_t const hash, uint64_t const) { result.push_back(hash); };
+
+        raptor::detail::for_each_minimiser(file_path, minimiser, store, chunk_size);
+        return result;
+    }
+
+    // Writes the sequences with line breaks every `line_length` bases. `separator` is inserted every 7 bases.
+    void write_fasta(size_t const line_length, std::string const & separator = "") const
+    {
+        std::ofstream file{file_path};
+        for (size_t i = 0; i < sequences.size(); ++i)
+        {
+            file << ">seq" << i << '\n';
+            for (size_t position = 0; position < sequences[i].size(); ++position)
+            {
+                file << sequences[i][position];
+                if ((position + 1u) % 7u == 0u)
+                    file << separator;
+                if ((position + 1u) % line_length == 0u || position + 1u == sequences[i].size())
+                    file << '\n';
+            }
+        }
+    }
+};
+
+TEST_F(chunked_sequence_reader_test, chunk_sizes)
+{
+    write_fasta(60u);
+    std::vector<uint64_t> const expected = expected_minimisers();
+
+    for (size_t const chunk_size : {size_t{1u}, size_t{kmer_size - 1u}, size_t{window_size}, size_t{window_size + 1u}})
+        EXPECT_EQ(streamed_minimisers(chunk_size), expected) << "chunk size " << chunk_size;
+}
+
+TEST_F(chunked_sequence_reader_test, skips_whitespace_and_digits)
+{
+    write_fasta(60u, " 12\t");
+    std::vector<uint64_t> const expected = expected_minimisers();
+
+    for (size_t const chunk_size : {size_t{1u},
+                                    size_t{window_size},
+                                    raptor::detail::chunked_sequence_reader::default_chunk_size})
+        EXPECT_EQ(streamed_minimisers(chunk_size), expected) << "chunk size " << chunk_size;
+}
+
+TEST_F(chunked_sequence_reader_test, invalid_character)
+{
+    write_fasta(60u, "!");
+    EXPECT_THROW(streamed_minimisers(window_size), seqan3::parse_error);
+}
+
+TEST_F(chunked_sequence_reader_test, fastq)
+{
+    seqan3::test::tmp_filename fastq_tmp{"sequences.fastq"};
+    {
+        std::ofstream file{fastq_tmp.get_path()};
+        file << "@read1\nACGTN ACGT\r\n+\nIIIIIIIII\r\n@read2\nAC1GT\n+\nIIIII\n";
+    }
+
+    raptor::detail::chunked_sequence_reader reader{fastq_tmp.get_path(), 3u};
+    std::string bases{};
+    auto read = [&] ()
+    {
+        reader.read([] (std::string_view) {},
+                    [&] (std::string_view part) { bases += part; },
+                    [&] () { bases += '|'; });
+    };
+
+    // Whitespace is skipped, digits are invalid in FASTQ.
+    EXPECT_THROW(read(), seqan3::parse_error);
+    EXPECT_EQ(bases.substr(0u, 10u), "ACGTNACGT|");
+}
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include <seqan3/alphabet/nucleotide/dna4.hpp>
+#include <seqan3/alphabet/nucleotide/dna5.hpp>
+
+#include <raptor/detail/streaming_minimiser.hpp>
+#include <raptor/search/detail/heuristic_threshold.hpp>
+
+// From util/thresholding
+#include <heuristic_threshold.hpp>
+
+// Random reads of different lengths.
+std::vector<seqan3::dna4_vector> random_reads()
+{
+    std::mt19937_64 engine{42u};
+    std::vector<seqan3::dna4_vector> reads{};
+
+    for (size_t i = 0; i < 500u; ++i)
+    {
+        seqan3::dna4_vector & read = reads.emplace_back(50u + engine() % 200u);
+        for (auto & base : read)
+            base.assign_rank(engine() % 4u);
+    }
+
+    return reads;
+}
+
+raptor::search_arguments make_arguments(uint8_t const kmer_size, uint32_t const window_size, uint8_t const errors)
+{
+    raptor::search_arguments arguments{};
+    arguments.shape = seqan3::shape{seqan3::ungapped{kmer_size}};
+    arguments.shape_size = kmer_size;
+    arguments.shape_weight = kmer_size;
+    arguments.window_size = window_size;
+    arguments.errors = errors;
+    return arguments;
+}
+
+/* Compares the kernel used by raptor search with the heuristic of util/thresholding for up to one error.
+ * Both destroy the maximal number of k-mers covering one position with the first error. Afterwards, util/thresholding
+ * only removes the k-mers beginning or ending in the segment of maximal coverage, see the hand-computed cases below.
+ */
+void compare(uint8_t const kmer_size, uint32_t const window_size)
+{
+    for (uint8_t errors = 0; errors < 2u; ++errors)
+    {
+        raptor::search_arguments const arguments = make_arguments(kmer_size, window_size, errors);
+        raptor::detail::heuristic_threshold kernel{arguments};
+        raptor::detail::streaming_minimiser positions{arguments.shape,
+                                                      window_size,
+                                                      raptor::adjust_seed(kmer_size)};
+        minimizer mini{window{window_size}, kmer{kmer_size}};
+        ::heuristic_threshold util_heuristic{};
+        std::vector<uint64_t> minimiser{};
+
+        for (auto const & read : random_reads())
+        {
+            kernel.compute_minimiser(read, minimiser);
+
+            // util/thresholding works on the begin and end positions of the minimisers.
+            mini.minimizer_begin.clear();
+            mini.minimizer_end.clear();
+            auto store = [&mini, kmer_size] (uint64_t const, uint64_t const begin)
+            {
+                mini.minimizer_begin.push_back(begin);
+                mini.minimizer_end.push_back(begin + kmer_size - 1u);
+            };
+            positions.reset();
+            for (auto const base : read)
+                positions.push(seqan3::to_rank(base), store);
+            positions.finish(store);
+            ASSERT_EQ(mini.minimizer_begin.size(), minimiser.size());
+
+            util_heuristic.reset(mini);
+            EXPECT_EQ(kernel.get(), util_heuristic.threshold(errors)) << "k = " << static_cast<size_t>(kmer_size)
+                                                                      << ", w = " << window_size
+                                                                      << ", e = " << static_cast<size_t>(errors);
+        }
+    }
+}
+
+TEST(heuristic_threshold, window_equals_kmer)
+{
+    compare(19u, 19u);
+}
+
+TEST(heuristic_threshold, window_larger_than_kmer)
+{
+    compare(19u, 23u);
+    compare(20u, 24u);
+    compare(15u, 25u);
+}
+
+// The thresholds of a read for 0 to 3 errors.
+std::vector<size_t> thresholds(seqan3::dna5_vector const & read)
+{
+    std::vector<size_t> result{};
+    std::vector<uint64_t> minimiser{};
+
+    for (uint8_t errors = 0; errors < 4u; ++errors)
+    {
+        raptor::detail::heuristic_threshold kernel{make_arguments(4u, 4u, errors)};
+        kernel.compute_minimiser(read, minimiser);
+        result.push_back(kernel.get());
+    }
+
+    return result;
+}
+
+TEST(heuristic_threshold, hand_computed)
+{
+    using seqan3::operator""_dna5;
+
+    // All 7 4-mers are minimisers; positions 3 to 6 are covered by 4 of them. The first error destroys the 4-mers
+    // starting at 0 to 3, the second one the remaining 3.
+    // util/thresholding removes all 7 4-mers after the first error, since each begins or ends in the segment [3, 6] of
+    // maximal coverage, but only counts 4 of them as destroyed. Hence, it returns 7, 3, 3, 3.
+    EXPECT_EQ(thresholds("ACGTTGCAAC"_dna5), (std::vector<size_t>{7u, 3u, 0u, 0u}));
+
+    // The 4-mers containing N are skipped, leaving those starting at 0, 1, 6, and 7. Each error destroys one pair.
+    EXPECT_EQ(thresholds("ACGTTNGCAAC"_dna5), (std::vector<size_t>{4u, 2u, 0u, 0u}));
+}
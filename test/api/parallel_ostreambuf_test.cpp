@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+
+#include <cereal/archives/binary.hpp>
+
+#include <seqan3/argument_parser/exceptions.hpp>
+#include <seqan3/test/tmp_filename.hpp>
+
+#include <raptor/detail/parallel_ostreambuf.hpp>
+#include <raptor/index.hpp>
+
+struct parallel_ostreambuf_test : public ::testing::Test
+{
+    seqan3::test::tmp_filename tmp{"raptor.index"};
+    std::filesystem::path const file_path{tmp.get_path()};
+
+    // 1001 bits per bin and 64 bins: The payload of 8008 bytes is not a multiple of the chunk size.
+    raptor::raptor_index<> index = []
+    {
+        raptor::build_arguments arguments{};
+        arguments.bins = 64u;
+        arguments.bits = 1001u;
+        arguments.bin_path.assign(64u, std::vector<std::string>{"bin.fasta"});
+
+        raptor::raptor_index<> result{arguments};
+        std::mt19937_64 engine{42u};
+        for (size_t i = 0; i < 2000u; ++i)
+            result.ibf().emplace(engine(), seqan3::bin_index{engine() % 64u});
+        result.compute_fill_rates();
+        return result;
+    }();
+
+    std::string expected() const
+    {
+        std::ostringstream os{};
+        {
+            cereal::BinaryOutputArchive oarchive{os};
+            oarchive(index);
+        }
+        return os.str();
+    }
+
+    std::string parallel(size_t const threads, size_t const chunk_size) const
+    {
+        auto const & payload = index.ibf().raw_data();
+        raptor::detail::parallel_ostreambuf buffer{file_path,
+                                                   reinterpret_cast<char const *>(payload.data()),
+                                                   ((payload.size() + 63u) >> 6) * sizeof(uint64_t),
+                                                   threads,
+                                                   chunk_size};
+        {
+            std::ostream os{&buffer};
+            cereal::BinaryOutputArchive oarchive{os};
+            oarchive(index);
+        }
+        buffer.close();
+
+        std::ifstream file{file_path, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    }
+};
+
+TEST_F(parallel_ostreambuf_test, identical_to_cereal)
+{
+    std::string const reference = expected();
+    ASSERT_NE(reference.size() % 4096u, 0u);
+
+    for (size_t const threads : {1u, 2u, 4u})
+        EXPECT_EQ(parallel(threads, 4096u), reference) << threads << " threads";
+}
+
+TEST_F(parallel_ostreambuf_test, chunk_larger_than_file)
+{
+    EXPECT_EQ(parallel(4u, raptor::detail::parallel_ostreambuf::default_chunk_size), expected());
+}
+
+TEST_F(parallel_ostreambuf_test, unexpected_serialisation)
+{
+    std::vector<char> const memory(101u);
+    auto make_buffer = [&] ()
+    {
+        return std::make_unique<raptor::detail::parallel_ostreambuf>(file_path, memory.data(), 100u, 2u);
+    };
+
+    // The payload must be written from its beginning, in order, and not beyond its end.
+    EXPECT_THROW(make_buffer()->sputn(memory.data() + 1, 10), seqan3::argument_parser_error);
+    EXPECT_THROW(make_buffer()->sputn(memory.data(), 101), seqan3::argument_parser_error);
+
+    auto buffer = make_buffer();
+    buffer->sputn("header", 6);
+    EXPECT_THROW(buffer->close(), seqan3::argument_parser_error);
+}
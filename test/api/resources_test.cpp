@@ -0,0 +1,186 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+
+#include <seqan3/test/tmp_filename.hpp>
+
+#include <raptor/resources.hpp>
+#include <raptor/search/memory_settings.hpp>
+
+// Creates a file `root/path` with the given content.
+void write_file(std::filesystem::path const & root, std::filesystem::path const & path, std::string const & content)
+{
+    std::filesystem::create_directories((root / path).parent_path());
+    std::ofstream file{root / path};
+    file << content << '\n';
+}
+
+struct resources_test : public ::testing::Test
+{
+    seqan3::test::tmp_filename tmp{"root"};
+    std::filesystem::path const root{tmp.get_path()};
+
+    raptor::system_resources detect(size_t const affinity_cpus)
+    {
+        return raptor::detect_resources(raptor::resource_sources{root, affinity_cpus});
+    }
+};
+
+TEST_F(resources_test, no_cgroup)
+{
+    raptor::system_resources const resources = detect(8u);
+    EXPECT_EQ(resources.cpus, 8u);
+    EXPECT_EQ(resources.numa_nodes, 1u);
+    EXPECT_EQ(resources.l3_cache, 0u);
+}
+
+TEST_F(resources_test, cgroup_v2)
+{
+    write_file(root, "sys/fs/cgroup/cgroup.controllers", "cpu memory");
+    write_file(root, "proc/self/cgroup", "0::/job");
+    write_file(root, "sys/fs/cgroup/job/cpu.max", "200000 100000");
+    write_file(root, "sys/fs/cgroup/job/memory.max", "1073741824");
+
+    raptor::system_resources const resources = detect(8u);
+    EXPECT_EQ(resources.cpus, 2u);
+    EXPECT_EQ(resources.memory, 1ULL << 30);
+}
+
+TEST_F(resources_test, cgroup_v2_namespace)
+{
+    // In a container, the own cgroup is mounted as root.
+    write_file(root, "sys/fs/cgroup/cgroup.controllers", "cpu memory");
+    write_file(root, "proc/self/cgroup", "0::/");
+    write_file(root, "sys/fs/cgroup/cpu.max", "150000 100000");
+    write_file(root, "sys/fs/cgroup/memory.max", "max");
+
+    raptor::system_resources const resources = detect(8u);
+    EXPECT_EQ(resources.cpus, 2u);
+    EXPECT_GT(resources.memory, 0u);
+}
+
+TEST_F(resources_test, cgroup_v2_unlimited)
+{
+    write_file(root, "sys/fs/cgroup/cgroup.controllers", "cpu memory");
+    write_file(root, "proc/self/cgroup", "0::/job");
+    write_file(root, "sys/fs/cgroup/job/cpu.max", "max 100000");
+
+    EXPECT_EQ(detect(8u).cpus, 8u);
+}
+
+TEST_F(resources_test, cgroup_v1)
+{
+    write_file(root, "sys/fs/cgroup/cpu/cpu.cfs_quota_us", "300000");
+    write_file(root, "sys/fs/cgroup/cpu/cpu.cfs_period_us", "100000");
+    write_file(root, "sys/fs/cgroup/memory/memory.limit_in_bytes", "536870912");
+
+    raptor::system_resources const resources = detect(8u);
+    EXPECT_EQ(resources.cpus, 3u);
+    EXPECT_EQ(resources.memory, 1ULL << 29);
+}
+
+TEST_F(resources_test, cgroup_v1_unlimited)
+{
+    write_file(root, "sys/fs/cgroup/cpu/cpu.cfs_quota_us", "-1");
+    write_file(root, "sys/fs/cgroup/cpu/cpu.cfs_period_us", "100000");
+
+    EXPECT_EQ(detect(8u).cpus, 8u);
+}
+
+TEST_F(resources_test, affinity_below_quota)
+{
+    // The quota allows 4 CPUs, but the process may only run on 2.
+    write_file(root, "sys/fs/cgroup/cpu/cpu.cfs_quota_us", "400000");
+    write_file(root, "sys/fs/cgroup/cpu/cpu.cfs_period_us", "100000");
+
+    EXPECT_EQ(detect(2u).cpus, 2u);
+    EXPECT_EQ(detect(0u).cpus, 1u);
+}
+
+TEST_F(resources_test, numa_and_cache)
+{
+    write_file(root, "sys/devices/system/node/node0/cpulist", "0-3");
+    write_file(root, "sys/devices/system/node/node1/cpulist", "4-7");
+    write_file(root, "sys/devices/system/node/possible", "0-1");
+    write_file(root, "sys/devices/system/cpu/cpu0/cache/index2/level", "2");
+    write_file(root, "sys/devices/system/cpu/cpu0/cache/index2/size", "1024K");
+    write_file(root, "sys/devices/system/cpu/cpu0/cache/index3/level", "3");
+    write_file(root, "sys/devices/system/cpu/cpu0/cache/index3/size", "32768K");
+
+    raptor::system_resources const resources = detect(8u);
+    EXPECT_EQ(resources.numa_nodes, 2u);
+    EXPECT_EQ(resources.l3_cache, 32ULL << 20);
+}
+
+TEST(default_threads, clamped)
+{
+    raptor::system_resources resources{};
+    resources.cpus = 16u;
+    EXPECT_EQ(raptor::default_threads(resources), 16u);
+    resources.cpus = 1000u;
+    EXPECT_EQ(raptor::default_threads(resources), 255u);
+}
+
+raptor::search_arguments memory_arguments(uint64_t const memory)
+{
+    raptor::search_arguments arguments{};
+    arguments.resources.memory = memory;
+    arguments.pattern_size = 136u;
+    arguments.bin_path.resize(100u);
+    return arguments;
+}
+
+TEST(derive_memory_settings, single_index)
+{
+    // (1 GiB - 256 MiB) / 2 = 384 MiB for reads, each taking 136 + 64 bytes.
+    raptor::search_arguments arguments = memory_arguments(1ULL << 30);
+    raptor::derive_memory_settings(arguments, {256ULL << 20}, false, true);
+    EXPECT_FALSE(arguments.parts_resident);
+    EXPECT_EQ(arguments.batch_size, (384ULL << 20) / 200u);
+}
+
+TEST(derive_memory_settings, resident_parts)
+{
+    // All parts take 400 MiB, which is less than half of the memory. Reads take 136 + 64 + 2 * 100 bytes.
+    raptor::search_arguments arguments = memory_arguments(1ULL << 30);
+    raptor::derive_memory_settings(arguments, {100ULL << 20, 100ULL << 20, 100ULL << 20, 100ULL << 20}, true, true);
+    EXPECT_TRUE(arguments.parts_resident);
+    EXPECT_EQ(arguments.batch_size, (312ULL << 20) / 400u);
+}
+
+TEST(derive_memory_settings, reloaded_parts)
+{
+    // All parts take 800 MiB, hence only the largest part is in memory at a time.
+    raptor::search_arguments arguments = memory_arguments(1ULL << 30);
+    raptor::derive_memory_settings(arguments, {200ULL << 20, 300ULL << 20, 200ULL << 20, 100ULL << 20}, true, true);
+    EXPECT_FALSE(arguments.parts_resident);
+    EXPECT_EQ(arguments.batch_size, (362ULL << 20) / 400u);
+}
+
+TEST(derive_memory_settings, bounds)
+{
+    // No memory left: At least 2^16 reads.
+    raptor::search_arguments arguments = memory_arguments(1ULL << 30);
+    raptor::derive_memory_settings(arguments, {2ULL << 30}, false, true);
+    EXPECT_EQ(arguments.batch_size, 1ULL << 16);
+
+    // Plenty of memory: At most the default batch size.
+    arguments = memory_arguments(1ULL << 40);
+    raptor::derive_memory_settings(arguments, {1ULL << 20}, false, true);
+    EXPECT_EQ(arguments.batch_size, raptor::search_arguments{}.batch_size);
+}
+
+TEST(derive_memory_settings, keep_batch_size)
+{
+    raptor::search_arguments arguments = memory_arguments(1ULL << 30);
+    arguments.batch_size = 1000u;
+    raptor::derive_memory_settings(arguments, {100ULL << 20, 100ULL << 20}, true, false);
+    EXPECT_TRUE(arguments.parts_resident);
+    EXPECT_EQ(arguments.batch_size, 1000u);
+
+    // Unknown memory: Nothing is changed.
+    arguments = memory_arguments(0u);
+    raptor::derive_memory_settings(arguments, {100ULL << 20, 100ULL << 20}, true, true);
+    EXPECT_FALSE(arguments.parts_resident);
+    EXPECT_EQ(arguments.batch_size, raptor::search_arguments{}.batch_size);
+}
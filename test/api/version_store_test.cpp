@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <numeric>
+
+#include <seqan3/test/tmp_filename.hpp>
+
+#include <raptor/detail/version_store.hpp>
+
+using raptor::detail::version_store;
+
+// The name of a block is the hexadecimal SHA-256 of its content.
+std::string hash_name(std::vector<uint64_t> const & words)
+{
+    return version_store::block_path("", version_store::hash(words.data(), words.size())).filename().string();
+}
+
+TEST(version_store, sha256)
+{
+    std::vector<uint64_t> words(100u);
+    std::iota(words.begin(), words.end(), 0u);
+
+    EXPECT_EQ(hash_name({}), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(hash_name({1u, 2u, 3u}), "e2e2033ae7e19d680599d4eb0a1359a2b48ec5baac75066c317fbf85159c54ef");
+    // 800 bytes: Several blocks of 64 bytes.
+    EXPECT_EQ(hash_name(words), "96bdba67cd0b5e6dc0f9e399f66b17eae627eac812d0620119e87687d789546a");
+    // 56 bytes: The length does not fit into the last block, hence the padding needs another one.
+    words.resize(7u);
+    EXPECT_EQ(hash_name(words), "81845a01dafa45c9b26e10a7af52a92e8604d5d8ef690f1e3ccdcfe3b5c6ae98");
+}
+
+struct versioned_streambuf_test : public ::testing::Test
+{
+    seqan3::test::tmp_filename tmp{"versions"};
+    std::filesystem::path const manifest{tmp.get_path() / "version.index"};
+
+    static constexpr size_t rows{100u};
+    static constexpr size_t bin_words{3u};
+    std::vector<uint64_t> payload = []
+    {
+        std::vector<uint64_t> result(rows * bin_words);
+        std::iota(result.begin(), result.end(), 42u);
+        return result;
+    }();
+
+    std::string const header{"header"};
+    std::string const trailer{"trailer"};
+
+    void write() const
+    {
+        std::filesystem::create_directories(manifest.parent_path());
+        raptor::detail::versioned_ostreambuf buffer{manifest, payload.data(), rows, bin_words, 2u};
+        buffer.sputn(header.data(), header.size());
+        buffer.sputn(reinterpret_cast<char const *>(payload.data()), payload.size() * sizeof(uint64_t));
+        buffer.sputn(trailer.data(), trailer.size());
+        buffer.close();
+    }
+
+    std::string read() const
+    {
+        std::filebuf file{};
+        file.open(manifest, std::ios::in | std::ios::binary);
+        raptor::detail::versioned_istreambuf buffer{&file, version_store::block_directory(manifest), 2u};
+        std::istream stream{&buffer};
+        return std::string{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+    }
+
+    std::string expected() const
+    {
+        return header + std::string{reinterpret_cast<char const *>(payload.data()), payload.size() * sizeof(uint64_t)} +
+               trailer;
+    }
+
+    std::vector<std::filesystem::path> blocks() const
+    {
+        std::vector<std::filesystem::path> result{};
+        for (auto const & entry : std::filesystem::recursive_directory_iterator{version_store::block_directory(manifest)})
+            if (entry.is_regular_file())
+                result.push_back(entry.path());
+        return result;
+    }
+};
+
+TEST_F(versioned_streambuf_test, round_trip)
+{
+    write();
+    EXPECT_EQ(blocks().size(), bin_words);
+    EXPECT_EQ(read(), expected());
+}
+
+TEST_F(versioned_streambuf_test, replaces_invalid_blocks)
+{
+    write();
+    std::vector<std::filesystem::path> const paths = blocks();
+    ASSERT_EQ(paths.size(), bin_words);
+
+    // Truncate one block and overwrite another one with content of the same length.
+    std::filesystem::resize_file(paths[0], 8u);
+    {
+        std::ofstream file{paths[1], std::ios::binary | std::ios::in | std::ios::out};
+        file.put('\xFF');
+    }
+    EXPECT_THROW(read(), std::exception);
+
+    write();
+    EXPECT_EQ(blocks().size(), bin_words);
+    EXPECT_EQ(read(), expected());
+}
@@ -7,6 +7,7 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>             // sort
 #include <cstdlib>               // system calls
 #include <seqan3/std/filesystem> // test directory creation
 #include <sstream>               // ostringstream
@@ -170,6 +171,34 @@ struct raptor_base : public cli_test
         return {file_buffer.str()};
     }
 
+    // The lines of a file in sorted order. For output whose order depends on the number of threads.
+    static inline std::vector<std::string> const sorted_lines(std::filesystem::path const & path)
+    {
+        std::istringstream file_buffer{string_from_file(path)};
+        std::vector<std::string> lines{};
+        for (std::string line{}; std::getline(file_buffer, line);)
+            lines.push_back(line);
+        std::sort(lines.begin(), lines.end());
+        return lines;
+    }
+
+    // The result lines of a search output. The header lists the paths of the bins, which depend on the location of the
+    // test data.
+    static inline std::string const results_without_header(std::filesystem::path const & path)
+    {
+        std::istringstream file_buffer{string_from_file(path)};
+        std::string result{};
+        for (std::string line{}; std::getline(file_buffer, line);)
+        {
+            if (!line.starts_with('#'))
+            {
+                result += line;
+                result += '\n';
+            }
+        }
+        return result;
+    }
+
     // Good example for printing tables: https://en.cppreference.com/w/cpp/io/ios_base/width
     template <seqan3::data_layout layout = seqan3::data_layout::uncompressed>
     static inline std::string const debug_ibfs(seqan3::interleaved_bloom_filter<layout> const & expected_ibf,
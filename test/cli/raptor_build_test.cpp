@@ -75,6 +75,43 @@ TEST_P(raptor_build, build_with_shape)
     compare_results(ibf_path(number_of_repeated_bins, window_size), "raptor.index");
 }
 
+TEST_P(raptor_build, build_with_strategy)
+{
+    auto const [number_of_repeated_bins, window_size, run_parallel_tmp] = GetParam();
+    bool const run_parallel = run_parallel_tmp && number_of_repeated_bins >= 32;
+
+    {
+        std::string const expanded_bins = repeat_bins(number_of_repeated_bins);
+        std::ofstream file{"raptor_cli_test.txt"};
+        auto split_bins = expanded_bins
+                        | std::views::split(' ')
+                        | std::views::transform([](auto &&rng) {
+                            return std::string_view(&*rng.begin(), std::ranges::distance(rng));});
+        for (auto && file_path : split_bins)
+        {
+            file << file_path << '\n';
+        }
+        file << '\n';
+    }
+
+    for (std::string const strategy : {"transpose", "rows"})
+    {
+        cli_test_result const result = execute_app("raptor", "build",
+                                                             "--kmer 19",
+                                                             "--window ", std::to_string(window_size),
+                                                             "--size 64k",
+                                                             "--threads ", run_parallel ? "2" : "1",
+                                                             "--strategy ", strategy,
+                                                             "--output raptor.index",
+                                                             "raptor_cli_test.txt");
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+
+        compare_results(ibf_path(number_of_repeated_bins, window_size), "raptor.index");
+    }
+}
+
 TEST_P(raptor_build, build_with_file_socks)
 {
     auto const [number_of_repeated_bins, window_size, run_parallel_tmp] = GetParam();
@@ -113,6 +150,319 @@ TEST_P(raptor_build, build_with_file_socks)
     compare_results(ibf_path(number_of_repeated_bins, window_size), "raptor.index");
 }
 
+TEST_F(raptor_base, build_block_compressed)
+{
+    {
+        std::string const expanded_bins = repeat_bins(16);
+        std::ofstream file{"raptor_cli_test.txt"};
+        auto split_bins = expanded_bins
+                        | std::views::split(' ')
+                        | std::views::transform([](auto &&rng) {
+                            return std::string_view(&*rng.begin(), std::ranges::distance(rng));});
+        for (auto && file_path : split_bins)
+        {
+            file << file_path << '\n';
+        }
+        file << '\n';
+    }
+
+    {
+        cli_test_result const result = execute_app("raptor", "build",
+                                                             "--kmer 19",
+                                                             "--window 19",
+                                                             "--size 64k",
+                                                             "--threads 2",
+                                                             "--block-compress",
+                                                             "--output raptor.index",
+                                                             "raptor_cli_test.txt");
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+    }
+
+    EXPECT_LT(std::filesystem::file_size("raptor.index"), std::filesystem::file_size(ibf_path(16, 19)));
+
+    {
+        cli_test_result const result = execute_app("raptor", "search",
+                                                             "--output search.out",
+                                                             "--index raptor.index",
+                                                             "--query ", data("query.fq"));
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+    }
+
+    EXPECT_EQ(results_without_header(search_result_path(16, 19, 0)), results_without_header("search.out"));
+}
+
+TEST_F(raptor_base, build_parallel_write)
+{
+    {
+        std::string const expanded_bins = repeat_bins(16);
+        std::ofstream file{"raptor_cli_test.txt"};
+        auto split_bins = expanded_bins
+                        | std::views::split(' ')
+                        | std::views::transform([](auto &&rng) {
+                            return std::string_view(&*rng.begin(), std::ranges::distance(rng));});
+        for (auto && file_path : split_bins)
+        {
+            file << file_path << '\n';
+        }
+        file << '\n';
+    }
+
+    for (std::string const threads : {"1", "4"})
+    {
+        cli_test_result const result = execute_app("raptor", "build",
+                                                             "--kmer 19",
+                                                             "--window 19",
+                                                             "--size 64k",
+                                                             "--threads ", threads,
+                                                             "--output raptor_" + threads + ".index",
+                                                             "raptor_cli_test.txt");
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+    }
+
+    // Writing with several threads yields the same file.
+    EXPECT_EQ(string_from_file("raptor_1.index", std::ios::binary), string_from_file("raptor_4.index", std::ios::binary));
+    compare_results(ibf_path(16, 19), "raptor_4.index");
+}
+
+TEST_F(raptor_base, build_versioned)
+{
+    {
+        std::string const expanded_bins = repeat_bins(16);
+        std::ofstream file{"raptor_cli_test.txt"};
+        auto split_bins = expanded_bins
+                        | std::views::split(' ')
+                        | std::views::transform([](auto &&rng) {
+                            return std::string_view(&*rng.begin(), std::ranges::distance(rng));});
+        for (auto && file_path : split_bins)
+        {
+            file << file_path << '\n';
+        }
+        file << '\n';
+    }
+
+    auto count_blocks = [] ()
+    {
+        size_t count{};
+        for (auto const & entry : std::filesystem::recursive_directory_iterator{"versions/blocks"})
+            count += entry.is_regular_file();
+        return count;
+    };
+
+    size_t blocks{};
+    for (std::string const version : {"first", "second"})
+    {
+        cli_test_result const result = execute_app("raptor", "build",
+                                                             "--kmer 19",
+                                                             "--window 19",
+                                                             "--size 64k",
+                                                             "--threads 2",
+                                                             "--versioned",
+                                                             "--output versions/" + version + ".index",
+                                                             "raptor_cli_test.txt");
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+
+        // The second version consists of the same bins and hence does not add any blocks.
+        if (version == "first")
+            blocks = count_blocks();
+        EXPECT_GT(blocks, 0u);
+        EXPECT_EQ(count_blocks(), blocks);
+    }
+
+    EXPECT_LT(std::filesystem::file_size("versions/second.index"), std::filesystem::file_size(ibf_path(16, 19)));
+
+    {
+        cli_test_result const result = execute_app("raptor", "search",
+                                                             "--output search.out",
+                                                             "--index versions/second.index",
+                                                             "--query ", data("query.fq"));
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+    }
+
+    EXPECT_EQ(results_without_header(search_result_path(16, 19, 0)), results_without_header("search.out"));
+}
+
+TEST_F(raptor_base, build_versioned_changed_bin)
+{
+    // 128 bins, i.e., two 64-bit columns.
+    auto write_bins = [] (std::string const & first_bin)
+    {
+        std::string const expanded_bins = repeat_bins(32);
+        std::ofstream file{"raptor_cli_test.txt"};
+        auto split_bins = expanded_bins
+                        | std::views::split(' ')
+                        | std::views::transform([](auto &&rng) {
+                            return std::string_view(&*rng.begin(), std::ranges::distance(rng));});
+        bool first{true};
+        for (auto && file_path : split_bins)
+        {
+            file << (first ? std::string_view{first_bin} : file_path) << '\n';
+            first = false;
+        }
+        file << '\n';
+    };
+
+    auto count_blocks = [] ()
+    {
+        size_t count{};
+        for (auto const & entry : std::filesystem::recursive_directory_iterator{"versions/blocks"})
+            count += entry.is_regular_file();
+        return count;
+    };
+
+    auto build = [this] (std::string const & version)
+    {
+        cli_test_result const result = execute_app("raptor", "build",
+                                                             "--kmer 19",
+                                                             "--window 19",
+                                                             "--size 64k",
+                                                             "--threads 2",
+                                                             "--versioned",
+                                                             "--output versions/" + version + ".index",
+                                                             "raptor_cli_test.txt");
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+        EXPECT_EQ(result.exit_code, 0);
+    };
+
+    write_bins(data("bin1.fa"));
+    build("first");
+    size_t const blocks = count_blocks();
+    ASSERT_EQ(blocks % 2u, 0u);
+    ASSERT_GT(blocks, 0u);
+
+    // Only the column containing bin 0 changes, hence only its blocks are added.
+    write_bins(data("bin2.fa"));
+    build("second");
+    EXPECT_EQ(count_blocks(), blocks + blocks / 2u);
+}
+
+TEST_F(raptor_base, build_fpr_correction)
+{
+    {
+        std::ofstream file{"raptor_cli_test.txt"};
+        file << data("bin1.fa").string() << '\n' << data("bin2.fa").string() << '\n';
+    }
+
+    {
+        cli_test_result const result = execute_app("raptor", "build",
+                                                             "--kmer 19",
+                                                             "--window 19",
+                                                             "--size 4k",
+                                                             "--output raptor.index",
+                                                             "raptor_cli_test.txt");
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+    }
+
+    raptor::raptor_index<> index{};
+    {
+        std::ifstream is{"raptor.index", std::ios::binary};
+        cereal::BinaryInputArchive iarchive{is};
+        iarchive(index);
+    }
+
+    ASSERT_EQ(index.fill_rates().size(), 2u);
+    for (size_t bin = 0; bin < 2u; ++bin)
+    {
+        size_t set_bits{};
+        for (size_t row = 0; row < index.ibf().bin_size(); ++row)
+            set_bits += index.ibf().raw_data()[row * 64u + bin];
+        EXPECT_DOUBLE_EQ(index.fill_rates()[bin], set_bits / static_cast<double>(index.ibf().bin_size()));
+    }
+
+    {
+        cli_test_result const result = execute_app("raptor", "search",
+                                                             "--fpr-correction",
+                                                             "--output search.out",
+                                                             "--index raptor.index",
+                                                             "--query ", data("query.fq"));
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+    }
+}
+
+TEST_F(raptor_base, build_ambiguous_bases)
+{
+    // bin1.fa with runs of N before and after the sequence, and a record consisting only of N.
+    std::filesystem::create_directory("ambiguous");
+    {
+        std::ifstream reference{data("bin1.fa")};
+        std::ofstream ambiguous_reference{"ambiguous/bin1.fa"};
+        std::string const run(500u, 'N');
+        for (std::string line{}; std::getline(reference, line);)
+        {
+            ambiguous_reference << line << '\n';
+            if (line[0] == '>')
+                ambiguous_reference << run << '\n';
+        }
+        ambiguous_reference << run << "\n>only_n\n" << run << '\n';
+    }
+
+    for (std::string const window_size : {"19", "23"})
+    {
+        for (auto const & [bin, index] : {std::pair<std::string, std::string>{data("bin1.fa"), "raptor.index"},
+                                          std::pair<std::string, std::string>{"ambiguous/bin1.fa", "ambiguous.index"}})
+        {
+            {
+                std::ofstream file{"raptor_cli_test.txt"};
+                file << bin << '\n';
+            }
+
+            cli_test_result const result = execute_app("raptor", "build",
+                                                                 "--kmer 19",
+                                                                 "--window ", window_size,
+                                                                 "--size 4k",
+                                                                 "--output ", index,
+                                                                 "raptor_cli_test.txt");
+            EXPECT_EQ(result.out, std::string{});
+            EXPECT_EQ(result.err, std::string{});
+            ASSERT_EQ(result.exit_code, 0);
+        }
+
+        // The runs of N insert no poly-A minimisers, hence both IBFs are identical.
+        compare_results("raptor.index", "ambiguous.index");
+    }
+}
+
+TEST_F(raptor_base, build_dry_run)
+{
+    {
+        std::string const expanded_bins = repeat_bins(16);
+        std::ofstream file{"raptor_cli_test.txt"};
+        auto split_bins = expanded_bins
+                        | std::views::split(' ')
+                        | std::views::transform([](auto &&rng) {
+                            return std::string_view(&*rng.begin(), std::ranges::distance(rng));});
+        for (auto && file_path : split_bins)
+        {
+            file << file_path << '\n';
+        }
+        file << '\n';
+    }
+
+    cli_test_result const result = execute_app("raptor", "build",
+                                                         "--kmer 19",
+                                                         "--window 19",
+                                                         "--size 64k",
+                                                         "--dry-run",
+                                                         "--output raptor.index",
+                                                         "raptor_cli_test.txt");
+    EXPECT_EQ(result.err, std::string{});
+    ASSERT_EQ(result.exit_code, 0);
+    EXPECT_NE(result.out.find("Peak memory:      64.00 KiB"), std::string::npos);
+    EXPECT_FALSE(std::filesystem::exists("raptor.index"));
+}
+
 INSTANTIATE_TEST_SUITE_P(build_suite,
                          raptor_build,
                          testing::Combine(testing::Values(0, 16, 32), testing::Values(19, 23), testing::Values(true, false)),
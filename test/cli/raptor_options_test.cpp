@@ -336,6 +336,33 @@ TEST_F(raptor_search, old_index)
     EXPECT_EQ(result.err, std::string{"[Error] Unsupported index version. Check raptor upgrade.\n"});
 }
 
+TEST_F(raptor_search, fpr_correction_without_fill_rates)
+{
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--query ", data("query.fq"),
+                                                         "--index ", data("64bins19window.index"),
+                                                         "--fpr-correction",
+                                                         "--output search.out");
+    EXPECT_NE(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{"[Error] --fpr-correction needs an index that stores fill rates. Please "
+                                      "rebuild the index.\n"});
+}
+
+TEST_F(raptor_search, heuristic_threshold_with_threshold)
+{
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--query ", data("query.fq"),
+                                                         "--index ", data("64bins19window.index"),
+                                                         "--heuristic-threshold",
+                                                         "--threshold 0.5",
+                                                         "--output search.out");
+    EXPECT_NE(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{"[Error] --heuristic-threshold cannot be combined with --threshold, "
+                                      "--containment, --delta, --stream, and --out-of-core.\n"});
+}
+
 TEST_F(raptor_upgrade, kmer_window)
 {
     cli_test_result const result = execute_app("raptor", "upgrade",
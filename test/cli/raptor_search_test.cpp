@@ -5,6 +5,12 @@
 // shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
 // -----------------------------------------------------------------------------------------------------
 
+#include <fstream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+
 #include "cli_test.hpp"
 
 struct raptor_search : public raptor_base, public testing::WithParamInterface<std::tuple<size_t, size_t, size_t>> {};
@@ -31,6 +37,291 @@ TEST_P(raptor_search, search)
     EXPECT_EQ(expected, actual);
 }
 
+TEST_P(raptor_search, search_out_of_core)
+{
+    auto const [number_of_repeated_bins, window_size, number_of_errors] = GetParam();
+
+    if (window_size == 23 && number_of_errors == 0)
+        GTEST_SKIP() << "Needs dynamic threshold correction";
+
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--out-of-core",
+                                                         "--memory-budget 1",
+                                                         "--error ", std::to_string(number_of_errors),
+                                                         "--index ", ibf_path(number_of_repeated_bins, window_size),
+                                                         "--query ", data("query.fq"));
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{});
+
+    std::string const expected = string_from_file(search_result_path(number_of_repeated_bins, window_size, number_of_errors), std::ios::binary);
+    std::string const actual = string_from_file("search.out");
+
+    EXPECT_EQ(expected, actual);
+}
+
+TEST_P(raptor_search, search_heuristic_threshold)
+{
+    auto const [number_of_repeated_bins, window_size, number_of_errors] = GetParam();
+
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--heuristic-threshold",
+                                                         "--error ", std::to_string(number_of_errors),
+                                                         "--index ", ibf_path(number_of_repeated_bins, window_size),
+                                                         "--query ", data("query.fq"));
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{});
+
+    // With window size equal to k-mer size, the heuristic threshold is the k-mer lemma.
+    if (window_size == 19)
+    {
+        std::string const expected = string_from_file(search_result_path(number_of_repeated_bins, window_size, number_of_errors), std::ios::binary);
+        std::string const actual = string_from_file("search.out");
+
+        EXPECT_EQ(expected, actual);
+        return;
+    }
+
+    // Otherwise, the threshold differs from the probabilistic model, but no minimiser of an exact match is destroyed.
+    // Hence, each read must be found in all bins that contain it without errors.
+    auto bins_per_read = [] (std::filesystem::path const & path)
+    {
+        std::map<std::string, std::set<std::string>> result{};
+        std::ifstream file{path};
+        for (std::string line{}; std::getline(file, line);)
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            size_t const tab = line.find('\t');
+            std::set<std::string> & bins = result[line.substr(0, tab)];
+            std::stringstream stream{line.substr(tab + 1u)};
+            for (std::string bin{}; std::getline(stream, bin, ',');)
+                bins.insert(bin);
+        }
+        return result;
+    };
+
+    auto const exact = bins_per_read(search_result_path(number_of_repeated_bins, 19, 0));
+    auto const actual = bins_per_read("search.out");
+    ASSERT_EQ(actual.size(), exact.size());
+    for (auto const & [id, bins] : exact)
+    {
+        ASSERT_TRUE(actual.count(id)) << id;
+        EXPECT_TRUE(std::includes(actual.at(id).begin(), actual.at(id).end(), bins.begin(), bins.end())) << id;
+    }
+}
+
+TEST_P(raptor_search, search_bin_major)
+{
+    auto const [number_of_repeated_bins, window_size, number_of_errors] = GetParam();
+
+    if (window_size == 23 && number_of_errors == 0)
+        GTEST_SKIP() << "Needs dynamic threshold correction";
+
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--bin-major",
+                                                         "--threads 2",
+                                                         "--error ", std::to_string(number_of_errors),
+                                                         "--index ", ibf_path(number_of_repeated_bins, window_size),
+                                                         "--query ", data("query.fq"));
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{});
+
+    // Transpose the expected read-major output.
+    std::string const expected = [&] ()
+    {
+        std::string header{};
+        std::vector<std::string> reads_per_bin{};
+        std::string line{};
+        std::ifstream search_result{search_result_path(number_of_repeated_bins, window_size, number_of_errors)};
+        while (std::getline(search_result, line))
+        {
+            if (line == "#QUERY_NAME\tUSER_BINS")
+            {
+                header += "#BIN\tQUERY_NAMES\n";
+            }
+            else if (line[0] == '#')
+            {
+                header += line + '\n';
+                reads_per_bin.emplace_back();
+            }
+            else
+            {
+                std::istringstream bins{line.substr(line.find('\t') + 1)};
+                std::string const read_id = line.substr(0, line.find('\t'));
+                for (std::string bin{}; std::getline(bins, bin, ',');)
+                    reads_per_bin[std::stoul(bin)] += read_id + ',';
+            }
+        }
+
+        for (size_t bin = 0; bin < reads_per_bin.size(); ++bin)
+        {
+            if (!reads_per_bin[bin].empty())
+                reads_per_bin[bin].pop_back();
+            header += std::to_string(bin) + '\t' + reads_per_bin[bin] + '\n';
+        }
+
+        return header;
+    }();
+    std::string const actual = string_from_file("search.out");
+
+    EXPECT_EQ(expected, actual);
+}
+
+TEST_P(raptor_search, search_abundance)
+{
+    auto const [number_of_repeated_bins, window_size, number_of_errors] = GetParam();
+
+    if (window_size == 23 && number_of_errors == 0)
+        GTEST_SKIP() << "Needs dynamic threshold correction";
+
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--abundance",
+                                                         "--threads 2",
+                                                         "--error ", std::to_string(number_of_errors),
+                                                         "--index ", ibf_path(number_of_repeated_bins, window_size),
+                                                         "--query ", data("query.fq"));
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{});
+
+    // Each classified read is distributed over the bins it hits; bins without hits get no reads.
+    size_t unclassified{};
+    size_t classified{};
+    std::vector<bool> hit_bins{};
+    {
+        std::string line{};
+        std::ifstream search_result{search_result_path(number_of_repeated_bins, window_size, number_of_errors)};
+        while (std::getline(search_result, line))
+        {
+            if (line == "#QUERY_NAME\tUSER_BINS")
+                continue;
+
+            if (line[0] == '#')
+            {
+                hit_bins.push_back(false);
+                continue;
+            }
+
+            std::istringstream bins{line.substr(line.find('\t') + 1)};
+            bool any_hit{false};
+            for (std::string bin{}; std::getline(bins, bin, ',');)
+            {
+                hit_bins[std::stoul(bin)] = true;
+                any_hit = true;
+            }
+            any_hit ? ++classified : ++unclassified;
+        }
+    }
+
+    std::ifstream search_out{"search.out"};
+    std::string line{};
+    for (size_t bin = 0; bin < hit_bins.size(); ++bin)
+        ASSERT_TRUE(std::getline(search_out, line));
+
+    ASSERT_TRUE(std::getline(search_out, line));
+    EXPECT_EQ(line, "#UNCLASSIFIED_READS\t" + std::to_string(unclassified));
+    ASSERT_TRUE(std::getline(search_out, line));
+    EXPECT_EQ(line, "#BIN\tREADS\tABUNDANCE");
+
+    double read_sum{};
+    double abundance_sum{};
+    for (size_t bin = 0; bin < hit_bins.size(); ++bin)
+    {
+        size_t bin_number{};
+        double reads{};
+        double abundance{};
+        ASSERT_TRUE(search_out >> bin_number >> reads >> abundance);
+        EXPECT_EQ(bin_number, bin);
+        if (!hit_bins[bin])
+            EXPECT_EQ(reads, 0.0);
+        read_sum += reads;
+        abundance_sum += abundance;
+    }
+
+    EXPECT_NEAR(read_sum, classified, 0.01 * hit_bins.size());
+    if (classified > 0u)
+        EXPECT_NEAR(abundance_sum, 1.0, 1e-6 * hit_bins.size());
+}
+
+TEST_P(raptor_search, search_ambiguous_bases)
+{
+    auto const [number_of_repeated_bins, window_size, number_of_errors] = GetParam();
+
+    // Replace one base in the middle of each read by N.
+    // Add a fourth read consisting of the first read surrounded by long runs of N.
+    {
+        std::ifstream query{data("query.fq")};
+        std::ofstream ambiguous_query{"query_ambiguous.fq"};
+        std::ofstream long_run_query{"query_long_run.fq"};
+        std::vector<std::string> first_record{};
+        size_t line_number{};
+        for (std::string line{}; std::getline(query, line); ++line_number)
+        {
+            long_run_query << line << '\n';
+            if (line_number < 4u)
+                first_record.push_back(line);
+            if (line_number % 4u == 1u)
+                line[line.size() / 2u] = 'N';
+            ambiguous_query << line << '\n';
+        }
+
+        std::string const run(100u, 'N');
+        long_run_query << "@query4\n"
+                       << run << first_record[1] << run << "\n+\n"
+                       << std::string(first_record[3].size() + 2u * run.size(), 'I') << '\n';
+    }
+
+    auto bins_per_read = [] (std::filesystem::path const & path)
+    {
+        std::map<std::string, std::string> result{};
+        std::ifstream file{path};
+        for (std::string line{}; std::getline(file, line);)
+            if (!line.empty() && line[0] != '#')
+                result[line.substr(0, line.find('\t'))] = line.substr(line.find('\t') + 1);
+        return result;
+    };
+
+    for (std::string const query : {"query_ambiguous.fq", "query_long_run.fq"})
+    {
+        cli_test_result const result = execute_app("raptor", "search",
+                                                             "--output search_" + query + ".out",
+                                                             "--error ", std::to_string(number_of_errors),
+                                                             "--index ", ibf_path(number_of_repeated_bins, window_size),
+                                                             "--query ", query);
+        EXPECT_EQ(result.exit_code, 0);
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+    }
+
+    // The runs of N yield no minimisers, hence the read is found in the same bins as without them.
+    auto const long_run = bins_per_read("search_query_long_run.fq.out");
+    ASSERT_EQ(long_run.size(), 4u);
+    EXPECT_EQ(long_run.at("query4"), long_run.at("query1"));
+
+    // With the probabilistic model, the broken windows around the N may destroy more minimisers than accounted for.
+    if (window_size != 19)
+        return;
+
+    // The k-mers covering the N are skipped and the k-mer lemma is lowered accordingly, hence all bins are still found.
+    auto const expected = bins_per_read(search_result_path(number_of_repeated_bins, window_size, number_of_errors));
+    auto const actual = bins_per_read("search_query_ambiguous.fq.out");
+    ASSERT_EQ(actual.size(), expected.size());
+    for (auto const & [id, expected_bins] : expected)
+    {
+        std::string const actual_bins{',' + actual.at(id) + ','};
+        std::istringstream bins{expected_bins};
+        for (std::string bin{}; std::getline(bins, bin, ',');)
+            EXPECT_NE(actual_bins.find(',' + bin + ','), std::string::npos) << id << '\t' << actual.at(id);
+    }
+}
+
 TEST_P(raptor_search, search_socks)
 {
     auto const [number_of_repeated_bins, window_size, number_of_errors] = GetParam();
@@ -130,3 +421,318 @@ INSTANTIATE_TEST_SUITE_P(search_suite,
                                                 std::to_string(std::get<2>(info.param)) + "_error";
                              return name;
                          });
+
+struct raptor_containment : public raptor_base
+{
+    // Returns the containment scores of each query file listed in the search output.
+    static std::vector<std::vector<std::string>> containment_scores(std::filesystem::path const & path)
+    {
+        std::vector<std::vector<std::string>> result{};
+        std::ifstream search_result{path};
+        std::string line{};
+
+        while (std::getline(search_result, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+
+            std::string const scores = line.substr(line.rfind('\t') + 1u);
+            std::stringstream sstream{scores};
+            std::string score{};
+            result.emplace_back();
+            while (std::getline(sstream, score, ','))
+                result.back().push_back(score);
+        }
+
+        return result;
+    }
+};
+
+TEST_F(raptor_containment, single_file)
+{
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--containment",
+                                                         "--index ", ibf_path(16, 19),
+                                                         "--query ", data("bin1.fa"));
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{});
+
+    auto const scores = containment_scores("search.out");
+    ASSERT_EQ(scores.size(), 1u);
+    ASSERT_EQ(scores[0].size(), 64u);
+    for (size_t bin = 0; bin < scores[0].size(); bin += 4u)
+        EXPECT_EQ(scores[0][bin], "1.0000");
+}
+
+TEST_F(raptor_containment, file_list)
+{
+    {
+        std::ofstream file{"queries.txt"};
+        file << data("bin1.fa").string() << '\n' << data("bin2.fa").string() << '\n';
+    }
+
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--containment",
+                                                         "--threads 2",
+                                                         "--index ", ibf_path(16, 19),
+                                                         "--query queries.txt");
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{});
+
+    auto const scores = containment_scores("search.out");
+    ASSERT_EQ(scores.size(), 2u);
+    for (size_t file_id = 0; file_id < scores.size(); ++file_id)
+    {
+        ASSERT_EQ(scores[file_id].size(), 64u);
+        for (size_t bin = file_id; bin < scores[file_id].size(); bin += 4u)
+            EXPECT_EQ(scores[file_id][bin], "1.0000");
+    }
+}
+
+TEST_F(raptor_base, search_auto_tune)
+{
+    // The calibration is stored next to the index.
+    std::filesystem::copy_file(ibf_path(16, 19), "auto_tune.index");
+
+    auto search = [&] (std::string const & threads)
+    {
+        cli_test_result const result = execute_app("raptor", "search",
+                                                             "--output search.out",
+                                                             "--auto-tune",
+                                                             "--time",
+                                                             "--threads ", threads,
+                                                             "--error 1",
+                                                             "--index auto_tune.index",
+                                                             "--query ", data("query.fq"));
+        EXPECT_EQ(result.exit_code, 0);
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+
+        // The order of the results depends on the number of threads.
+        EXPECT_EQ(sorted_lines(search_result_path(16, 19, 1)), sorted_lines("search.out"));
+    };
+
+    // The number of threads used by the search, as reported in the timing file.
+    auto used_threads = [&] ()
+    {
+        std::istringstream timing{string_from_file("search.out.time")};
+        std::string line{};
+        std::getline(timing, line); // Header
+        std::getline(timing, line);
+        std::istringstream fields{line};
+        std::string field{};
+        for (size_t column = 0; column < 4u; ++column)
+            std::getline(fields, field, '\t');
+        return std::stoull(field);
+    };
+
+    search("4");
+    ASSERT_TRUE(std::filesystem::exists("auto_tune.index.tuning"));
+
+    // Replace the calibrated value: The second run must use the cached value instead of calibrating again.
+    std::string cache = string_from_file("auto_tune.index.tuning");
+    ASSERT_FALSE(cache.empty());
+    cache.erase(cache.rfind('\t', cache.size() - 2u) + 1u);
+    std::ofstream{"auto_tune.index.tuning"} << cache << "3\n";
+
+    search("4");
+    EXPECT_EQ(used_threads(), 3u);
+
+    // A different thread limit does not use the cached value and never exceeds the limit.
+    search("2");
+    EXPECT_LE(used_threads(), 2u);
+    std::string const new_cache = string_from_file("auto_tune.index.tuning");
+    EXPECT_EQ(std::count(new_cache.begin(), new_cache.end(), '\n'), 2);
+}
+
+TEST_F(raptor_base, search_stream)
+{
+    // The fields of the second line of the latency report.
+    auto latency_report = [&] ()
+    {
+        std::istringstream report{string_from_file("search.out.latency")};
+        std::string line{};
+        std::getline(report, line);
+        EXPECT_EQ(line, "Reads\tp50 (ms)\tp99 (ms)\tMax (ms)\tDeadline expired");
+        std::getline(report, line);
+        std::istringstream fields{line};
+        std::vector<std::string> result{};
+        for (std::string field{}; std::getline(fields, field, '\t');)
+            result.push_back(field);
+        return result;
+    };
+
+    for (std::string const deadline : {"1", "0"})
+    {
+        cli_test_result const result = execute_app("raptor", "search",
+                                                             "--output search.out",
+                                                             "--stream",
+                                                             "--pattern 65",
+                                                             "--deadline ", deadline,
+                                                             "--threads 2",
+                                                             "--error 1",
+                                                             "--index ", ibf_path(16, 19),
+                                                             "--query ", data("query.fq"));
+        EXPECT_EQ(result.exit_code, 0);
+        EXPECT_EQ(result.out, std::string{});
+        EXPECT_EQ(result.err, std::string{});
+
+        // Each read is reported as soon as it is classified, hence the order of the reads may differ.
+        EXPECT_EQ(sorted_lines(search_result_path(16, 19, 1)), sorted_lines("search.out"));
+
+        std::vector<std::string> const report = latency_report();
+        ASSERT_EQ(report.size(), 5u);
+        EXPECT_EQ(report[0], "3");
+        double const p50 = std::stod(report[1]);
+        double const p99 = std::stod(report[2]);
+        double const max = std::stod(report[3]);
+        EXPECT_GE(p50, 0.0);
+        EXPECT_LE(p50, p99);
+        EXPECT_LE(p99, max);
+        for (size_t column = 1; column < 4u; ++column)
+            EXPECT_EQ(report[column].size() - report[column].find('.'), 4u); // Three decimal places.
+
+        // With a deadline of 0 ms, every read is dispatched after its deadline expired.
+        if (deadline == "0")
+            EXPECT_EQ(report[4], "3");
+    }
+}
+
+TEST_F(raptor_base, search_fpr_correction)
+{
+    // A bin with so many k-mers that almost all of its bits are set.
+    {
+        std::mt19937_64 engine{42u};
+        std::ofstream file{"saturated.fa"};
+        file << ">saturated\n";
+        for (size_t i = 0; i < 500000u; ++i)
+            file << "ACGT"[engine() % 4u];
+        file << '\n';
+    }
+
+    {
+        std::ofstream file{"raptor_cli_test.txt"};
+        file << data("bin1.fa").string() << "\nsaturated.fa\n";
+    }
+
+    {
+        cli_test_result const result = execute_app("raptor", "build",
+                                                             "--kmer 19",
+                                                             "--window 19",
+                                                             "--size 64k",
+                                                             "--output raptor.index",
+                                                             "raptor_cli_test.txt");
+        EXPECT_EQ(result.err, std::string{});
+        ASSERT_EQ(result.exit_code, 0);
+    }
+
+    // The results without the header.
+    auto search = [&] (bool const fpr_correction)
+    {
+        cli_test_result const result = execute_app("raptor", "search",
+                                                             fpr_correction ? "--fpr-correction" : "",
+                                                             "--threshold 0.5",
+                                                             "--output search.out",
+                                                             "--index raptor.index",
+                                                             "--query ", data("query.fq"));
+        EXPECT_EQ(result.err, std::string{});
+        EXPECT_EQ(result.exit_code, 0);
+
+        std::ifstream file{"search.out"};
+        std::string results{};
+        for (std::string line{}; std::getline(file, line);)
+            if (line[0] != '#')
+                results += line + '\n';
+        return results;
+    };
+
+    // Without correction, the saturated bin is a spurious hit for every read.
+    EXPECT_EQ(search(false), "query1\t0,1\nquery2\t0,1\nquery3\t0,1\n");
+    EXPECT_EQ(search(true), "query1\t0\nquery2\t0\nquery3\t0\n");
+}
+
+TEST_F(raptor_base, search_delta)
+{
+    // Pretend that the previous search only covered the first 32 of the 64 bins.
+    std::filesystem::path const full_result = search_result_path(16, 19, 1);
+    {
+        std::ifstream search_result{full_result};
+        std::ofstream previous_result{"previous.out"};
+        std::string line{};
+        while (std::getline(search_result, line))
+        {
+            if (line[0] == '#')
+            {
+                if (line.substr(0, 11) == "#QUERY_NAME" || std::stoull(line.substr(1, line.find('\t') - 1)) < 32u)
+                    previous_result << line << '\n';
+                continue;
+            }
+
+            std::string bins{};
+            std::string bin_id{};
+            std::stringstream sstream{line.substr(line.find('\t') + 1u)};
+            while (std::getline(sstream, bin_id, ','))
+                if (std::stoull(bin_id) < 32u)
+                    bins += bin_id + ',';
+            if (!bins.empty())
+                bins.pop_back();
+            previous_result << line.substr(0, line.find('\t')) << '\t' << bins << '\n';
+        }
+    }
+
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--error 1",
+                                                         "--delta previous.out",
+                                                         "--index ", ibf_path(16, 19),
+                                                         "--query ", data("query.fq"));
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_EQ(result.err, std::string{});
+
+    std::string const expected = string_from_file(full_result, std::ios::binary);
+    std::string const actual = string_from_file("search.out");
+
+    EXPECT_EQ(expected, actual);
+}
+
+TEST_F(raptor_base, search_delta_other_query)
+{
+    // The previous output belongs to another query file.
+    {
+        std::ifstream search_result{search_result_path(16, 19, 1)};
+        std::ofstream previous_result{"previous.out"};
+        std::string line{};
+        while (std::getline(search_result, line) && line[0] == '#')
+            previous_result << line << '\n';
+        previous_result << "other\t0\n";
+    }
+
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--error 1",
+                                                         "--delta previous.out",
+                                                         "--index ", ibf_path(16, 19),
+                                                         "--query ", data("query.fq"));
+    EXPECT_NE(result.exit_code, 0);
+    EXPECT_EQ(result.out, std::string{});
+    EXPECT_NE(result.err.find("[Error] The read query1 was not found in the previous output"), std::string::npos);
+}
+
+TEST_F(raptor_base, search_dry_run)
+{
+    cli_test_result const result = execute_app("raptor", "search",
+                                                         "--output search.out",
+                                                         "--dry-run",
+                                                         "--index ", ibf_path(16, 19),
+                                                         "--query ", data("query.fq"));
+    EXPECT_EQ(result.err, std::string{});
+    ASSERT_EQ(result.exit_code, 0);
+    EXPECT_NE(result.out.find("Queries:          3 reads of 65.0 bases on average"), std::string::npos);
+    EXPECT_NE(result.out.find("Peak memory:"), std::string::npos);
+    EXPECT_FALSE(std::filesystem::exists("search.out"));
+}
@@ -131,3 +131,64 @@ TEST_F(raptor_upgrade, upgrade_partitioned)
 
     EXPECT_EQ(expected, actual);
 }
+
+TEST_F(raptor_upgrade, upgrade_fpr_correction)
+{
+    {
+        std::string const expanded_bins = repeat_bins(16);
+        std::ofstream file{"raptor_cli_test.txt"};
+        auto split_bins = expanded_bins
+                        | std::views::split(' ')
+                        | std::views::transform([](auto &&rng) {
+                            return std::string_view(&*rng.begin(), std::ranges::distance(rng));});
+        for (auto && file_path : split_bins)
+        {
+            file << file_path << '\n';
+        }
+        file << '\n';
+    }
+
+    // Upgraded indices store fill rates for both layouts, hence they can be searched with --fpr-correction.
+    for (bool const compressed : {false, true})
+    {
+        std::string const index_file{compressed ? "compressed.index" : "raptor.index"};
+        std::string const out_file{compressed ? "compressed.out" : "search.out"};
+
+        cli_test_result const upgrade = execute_app("raptor", "upgrade",
+                                                              "--kmer 19",
+                                                              "--window 23",
+                                                              compressed ? "--compressed" : "",
+                                                              "--bins raptor_cli_test.txt",
+                                                              "--input ", data(compressed ? "1_1c.index" : "1_1.index"),
+                                                              "--output ", index_file);
+        EXPECT_EQ(upgrade.err, std::string{});
+        ASSERT_EQ(upgrade.exit_code, 0);
+
+        cli_test_result const search = execute_app("raptor", "search",
+                                                             "--fpr-correction",
+                                                             "--error 1",
+                                                             "--index ", index_file,
+                                                             "--output ", out_file,
+                                                             "--query ", data("query.fq"));
+        EXPECT_EQ(search.err, std::string{});
+        ASSERT_EQ(search.exit_code, 0);
+    }
+
+    raptor::raptor_index<> index{};
+    raptor::raptor_index<seqan3::data_layout::compressed> compressed_index{};
+    {
+        std::ifstream is{"raptor.index", std::ios::binary};
+        cereal::BinaryInputArchive iarchive{is};
+        iarchive(index);
+    }
+    {
+        std::ifstream is{"compressed.index", std::ios::binary};
+        cereal::BinaryInputArchive iarchive{is};
+        iarchive(compressed_index);
+    }
+
+    ASSERT_EQ(index.fill_rates().size(), 64u);
+    EXPECT_EQ(index.fill_rates(), compressed_index.fill_rates());
+    EXPECT_GT(*std::ranges::max_element(index.fill_rates()), 0.0);
+    EXPECT_EQ(string_from_file("search.out"), string_from_file("compressed.out"));
+}
@@ -5,7 +5,14 @@
 // shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
 // -----------------------------------------------------------------------------------------------------
 
+#include <algorithm>
 #include <seqan3/std/filesystem>
+#include <fstream>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include <seqan3/argument_parser/all.hpp>
 #include <seqan3/core/algorithm/detail/execution_handler_parallel.hpp>
@@ -15,6 +22,10 @@
 
 #include <seqan3/core/debug_stream.hpp>
 
+#if SEQAN3_HAS_ZLIB
+#include <zlib.h>
+#endif
+
 struct config
 {
     uint64_t threads{1u};
@@ -183,6 +194,131 @@ inline std::unordered_map<uint64_t, std::vector<std::string>> parse_sbp_binning(
     return bin_to_refseq_accession;
 }
 
+/*!\brief Collects the records of one output bin and appends them to the bin's file in large blocks.
+ * \details
+ * Records are added by any thread. Once the buffer exceeds `buffer_size`, the adding thread takes over the buffer,
+ * compresses it as a separate gzip member without holding the buffer lock, and appends it to the file. Concatenated
+ * gzip members form a valid gzip file, hence blocks of different threads can be compressed concurrently.
+ */
+class bin_writer
+{
+public:
+    bin_writer() = default;
+    bin_writer(bin_writer const &) = delete;
+    bin_writer(bin_writer &&) = delete;
+    bin_writer & operator=(bin_writer const &) = delete;
+    bin_writer & operator=(bin_writer &&) = delete;
+    ~bin_writer() = default;
+
+    void open(std::filesystem::path const & path_, bool const compress_, size_t const buffer_size_)
+    {
+        path = path_;
+        compress = compress_;
+        buffer_size = buffer_size_;
+        // Truncate files from previous runs; blocks are appended.
+        std::ofstream{path, std::ios::binary | std::ios::trunc};
+    }
+
+    void add(std::string_view const id, std::string_view const seq)
+    {
+        std::string block{};
+        {
+            std::lock_guard const lock{buffer_mutex};
+            append_fasta(buffer, id, seq);
+            if (buffer.size() < buffer_size)
+                return;
+            std::swap(block, buffer);
+        }
+        write(std::move(block));
+    }
+
+    void flush()
+    {
+        std::string block{};
+        {
+            std::lock_guard const lock{buffer_mutex};
+            std::swap(block, buffer);
+        }
+        if (!block.empty())
+            write(std::move(block));
+    }
+
+private:
+    std::filesystem::path path{};
+    bool compress{};
+    size_t buffer_size{};
+    std::string buffer{};
+    std::mutex buffer_mutex{};
+    std::mutex file_mutex{};
+
+    //!\brief Same format as seqan3::sequence_file_output with `fasta_blank_before_id = false`.
+    static void append_fasta(std::string & out, std::string_view const id, std::string_view const seq)
+    {
+        out += '>';
+        out += id;
+        out += '\n';
+        for (size_t position = 0; position < seq.size(); position += 80u)
+        {
+            out += seq.substr(position, 80u);
+            out += '\n';
+        }
+    }
+
+    void write(std::string block)
+    {
+        if (compress)
+            block = gzip(block);
+
+        std::lock_guard const lock{file_mutex};
+        std::ofstream file{path, std::ios::binary | std::ios::app};
+        file.write(block.data(), block.size());
+    }
+
+    static std::string gzip([[maybe_unused]] std::string const & input)
+    {
+#if SEQAN3_HAS_ZLIB
+        z_stream stream{};
+        // 15 + 16: Maximal window and gzip header.
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            throw std::runtime_error{"Could not initialise zlib."};
+
+        std::string output(deflateBound(&stream, input.size()), '\0');
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+        stream.avail_in = input.size();
+        stream.next_out = reinterpret_cast<Bytef *>(output.data());
+        stream.avail_out = output.size();
+
+        int const status = deflate(&stream, Z_FINISH);
+        output.resize(stream.total_out);
+        deflateEnd(&stream);
+
+        if (status != Z_STREAM_END)
+            throw std::runtime_error{"Could not compress output."};
+
+        return output;
+#else
+        throw std::runtime_error{"Compressing the output requires zlib. Use --skip_gzip."};
+#endif
+    }
+};
+
+//!\brief Reports the accessions of the binning that were not written to any bin.
+inline void warn_unmatched(std::vector<std::string> unmatched)
+{
+    if (unmatched.empty())
+        return;
+
+    std::ranges::sort(unmatched);
+    unmatched.erase(std::unique(unmatched.begin(), unmatched.end()), unmatched.end());
+    std::cerr << "[WARNING] " << unmatched.size() << " accessions of the binning were not found and are missing from "
+              << "the output. Sequences are matched by the first word of their ID. Missing accessions:";
+    for (size_t i = 0; i < std::min<size_t>(10u, unmatched.size()); ++i)
+        std::cerr << ' ' << unmatched[i];
+    if (unmatched.size() > 10u)
+        std::cerr << " ...";
+    std::cerr << '\n';
+}
+
 inline void apply_taxsbp(config const & cfg)
 {
     using namespace std::literals;
@@ -193,48 +329,94 @@ inline void apply_taxsbp(config const & cfg)
     size_t const num_bins = bin_to_refseq_accession.size();
     size_t const n_zero = std::to_string(num_bins).length();
 
-    auto worker = [&] (auto && chunk_view, auto &&)
+    // Invert the binning: For each assembly file, which RefSeq accessions go to which bins.
+    std::unordered_map<std::string, std::unordered_map<std::string, std::vector<uint64_t>>> file_to_bins{};
+    std::vector<std::string> unmatched{};
+    std::mutex unmatched_mutex{};
+    for (auto && [bin_index, refseq_accessions] : bin_to_refseq_accession)
+    {
+        for (auto && refseq_accession : refseq_accessions)
         {
-            for (uint64_t bin_index : chunk_view)
+            if (auto refseq_to_assembly = refseq_to_assembly_accession.find(refseq_accession);
+                refseq_to_assembly != refseq_to_assembly_accession.end())
             {
-                std::string bin_index_as_string = std::to_string(bin_index);
-                std::string padded_bin_index = std::string(n_zero - bin_index_as_string.length(), '0') + bin_index_as_string;
-                std::string filename = "bin_"s + padded_bin_index + ".fasta"s + (!cfg.skip_gzip ? ".gz"s : ""s);
+                if (auto assembly_to_path = assembly_accession_to_path.find(refseq_to_assembly->second);
+                    assembly_to_path != assembly_accession_to_path.end())
+                {
+                    file_to_bins[assembly_to_path->second.string()][refseq_accession].push_back(bin_index);
+                    continue;
+                }
+            }
+            unmatched.push_back(refseq_accession);
+        }
+    }
+
+    std::vector<std::pair<std::string, std::unordered_map<std::string, std::vector<uint64_t>>>> files{};
+    files.reserve(file_to_bins.size());
+    for (auto && entry : file_to_bins)
+        files.emplace_back(std::move(entry));
+
+    // At most about 1 GiB is buffered in total, even if this makes the buffers of many bins small.
+    size_t const buffer_size = std::min<size_t>((1ULL << 30) / std::max<size_t>(1u, num_bins), 1ULL << 24);
+    std::vector<bin_writer> writers(num_bins);
 
-                std::filesystem::path output_path = cfg.output_directory;
-                output_path /= filename;
+    for (size_t bin_index = 0; bin_index < num_bins; ++bin_index)
+    {
+        std::string bin_index_as_string = std::to_string(bin_index);
+        std::string padded_bin_index = std::string(n_zero - bin_index_as_string.length(), '0') + bin_index_as_string;
+        std::string filename = "bin_"s + padded_bin_index + ".fasta"s + (!cfg.skip_gzip ? ".gz"s : ""s);
 
-                seqan3::sequence_file_output output_file{output_path};
-                output_file.options.fasta_blank_before_id = false;
+        writers[bin_index].open(cfg.output_directory / filename, !cfg.skip_gzip, buffer_size);
+    }
 
-                if (auto bin_to_refseq = bin_to_refseq_accession.find(bin_index); bin_to_refseq != bin_to_refseq_accession.end())
+    // Each assembly file is read exactly once. As before, the first record of an accession is written to its bins.
+    auto worker = [&] (auto && chunk_view, auto &&)
+        {
+            for (size_t const file_index : chunk_view)
+            {
+                auto const & [assembly_path, accession_to_bins] = files[file_index];
+                std::unordered_set<std::string_view> written{};
+
+                using fields_t = seqan3::fields<seqan3::field::seq, seqan3::field::id>;
+                seqan3::sequence_file_input<char_traits, fields_t> input_file{assembly_path};
+                for (auto && [seq, id] : input_file)
                 {
-                    for (auto && refseq_accession : bin_to_refseq->second)
+                    std::string_view const accession{id.data(), std::min(id.find(' '), id.size())};
+
+                    if (auto it = accession_to_bins.find(std::string{accession}); it != accession_to_bins.end())
                     {
-                        if (auto refseq_to_assembly = refseq_to_assembly_accession.find(refseq_accession); refseq_to_assembly != refseq_to_assembly_accession.end())
-                        {
-                            if (auto assembly_to_path = assembly_accession_to_path.find(refseq_to_assembly->second); assembly_to_path != assembly_accession_to_path.end())
-                            {
-                                seqan3::sequence_file_input<char_traits, seqan3::fields<seqan3::field::seq, seqan3::field::id>> input_file{assembly_to_path->second};
-                                for (auto && [seq, id] : input_file)
-                                {
-                                    if (id.substr(0, refseq_accession.size()) == refseq_accession)
-                                    {
-                                        output_file.emplace_back(seq, id);
-                                        break;
-                                    }
-                                }
-                            }
-                        }
+                        if (!written.insert(it->first).second)
+                            continue;
+
+                        for (uint64_t const bin_index : it->second)
+                            if (bin_index < num_bins)
+                                writers[bin_index].add(id, std::string_view{seq.data(), seq.size()});
+
+                        if (written.size() == accession_to_bins.size())
+                            break;
                     }
                 }
+
+                if (written.size() < accession_to_bins.size())
+                {
+                    std::lock_guard const lock{unmatched_mutex};
+                    for (auto && [accession, bins] : accession_to_bins)
+                        if (!written.contains(accession))
+                            unmatched.push_back(accession);
+                }
             }
         };
 
-    size_t const chunk_size = std::bit_ceil(num_bins / cfg.threads);
-    auto chunked_view = std::views::iota(0u, num_bins) | seqan3::views::chunk(chunk_size);
+    // Small chunks balance the load, since the assemblies differ greatly in size.
+    size_t const chunk_size = std::max<size_t>(1u, files.size() / (16u * cfg.threads));
+    auto chunked_view = std::views::iota(size_t{}, files.size()) | seqan3::views::chunk(chunk_size);
     seqan3::detail::execution_handler_parallel executioner{cfg.threads};
     executioner.bulk_execute(std::move(worker), std::move(chunked_view), [](){});
+
+    for (auto & writer : writers)
+        writer.flush();
+
+    warn_unmatched(std::move(unmatched));
 }
 
 int main(int argc, char ** argv)
@@ -0,0 +1,224 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+
+#include <cereal/archives/binary.hpp>
+
+#include <seqan3/argument_parser/all.hpp>
+
+#include <raptor/detail/bin_similarity.hpp>
+#include <raptor/detail/block_compression.hpp>
+#include <raptor/index.hpp>
+
+struct config
+{
+    std::filesystem::path index_path{};
+    std::filesystem::path out_path{};
+    std::filesystem::path reorder_path{};
+    std::string measure{"jaccard"};
+    size_t sample_rows{1ULL << 14};
+    uint8_t threads{1u};
+};
+
+class positive_integer_validator
+{
+public:
+    using option_value_type = size_t;
+
+    positive_integer_validator() = default;
+    positive_integer_validator(bool const is_zero_positive_) : is_zero_positive{is_zero_positive_} {}
+
+    void operator() (option_value_type const & val) const
+    {
+        if (!is_zero_positive && !val)
+        {
+            throw seqan3::validation_error{"The value must be a positive integer."};
+        }
+    }
+
+    std::string get_help_page_message () const
+    {
+        if (is_zero_positive)
+            return "Value must be a positive integer or 0.";
+        else
+            return "Value must be a positive integer.";
+    }
+
+private:
+    bool is_zero_positive{false};
+};
+
+//!\brief The files of the index: `<index>` if the index is not partitioned, `<index>_0`, `<index>_1`, ... otherwise.
+std::vector<std::filesystem::path> index_files(std::filesystem::path const & index_path)
+{
+    std::vector<std::filesystem::path> files{};
+
+    for (size_t part = 0; std::filesystem::exists(index_path.string() + "_" + std::to_string(part)); ++part)
+        files.emplace_back(index_path.string() + "_" + std::to_string(part));
+
+    if (files.empty())
+        files.push_back(index_path);
+
+    return files;
+}
+
+raptor::raptor_index<> load_index(std::filesystem::path const & path, size_t const threads)
+{
+    raptor::raptor_index<> index{};
+    raptor::detail::index_istream is{path, threads};
+    cereal::BinaryInputArchive iarchive{is};
+    iarchive(index);
+    return index;
+}
+
+void compute_similarity(config const & cfg)
+{
+    std::vector<std::filesystem::path> const files = index_files(cfg.index_path);
+
+    raptor::raptor_index<> index = load_index(files[0], cfg.threads);
+    size_t const bin_count{index.ibf().bin_count()};
+    raptor::detail::bin_similarity sampler{index, cfg.sample_rows, files.size(), cfg.threads};
+
+    for (size_t part = 0; part < files.size(); ++part)
+    {
+        if (part > 0u)
+            index = load_index(files[part], cfg.threads);
+        sampler.sample(index, part);
+    }
+
+    std::vector<double> const similarity = sampler.matrix(cfg.measure == "containment");
+
+    if (!cfg.out_path.empty())
+    {
+        std::ofstream output{cfg.out_path};
+        output << "#BIN";
+        for (size_t bin = 0; bin < bin_count; ++bin)
+            output << '\t' << bin;
+        output << '\n' << std::fixed << std::setprecision(4);
+
+        for (size_t lhs = 0; lhs < bin_count; ++lhs)
+        {
+            output << lhs;
+            for (size_t rhs = 0; rhs < bin_count; ++rhs)
+                output << '\t' << similarity[lhs * bin_count + rhs];
+            output << '\n';
+        }
+    }
+
+    if (cfg.reorder_path.empty())
+        return;
+
+    std::vector<size_t> const order = raptor::detail::bin_similarity::greedy_order(similarity, bin_count);
+
+    for (size_t part = 0; part < files.size(); ++part)
+    {
+        if (files.size() > 1u)
+            index = load_index(files[part], cfg.threads);
+
+        bool compress{};
+        {
+            std::ifstream file{files[part], std::ios::binary};
+            compress = raptor::detail::is_block_compressed(file);
+        }
+
+        index.permute_bins(order, cfg.threads);
+
+        std::filesystem::path out_file{cfg.reorder_path};
+        if (files.size() > 1u)
+            out_file += "_" + std::to_string(part);
+
+        raptor::detail::index_ostream os{out_file, compress, cfg.threads};
+        {
+            cereal::BinaryOutputArchive oarchive{os};
+            oarchive(index);
+        }
+        os.close();
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    seqan3::argument_parser parser{"bin_similarity", argc, argv, seqan3::update_notifications::off};
+    parser.info.author = "Enrico Seiler";
+    parser.info.author = "enrico.seiler@fu-berlin.de";
+    parser.info.short_description = "Estimates the pairwise similarity of the bins of an index and optionally "
+                                    "reorders the bins such that similar bins are adjacent.";
+    parser.info.version = "0.0.1";
+
+    config cfg{};
+
+    parser.add_positional_option(cfg.index_path,
+                                 "Provide a Raptor index. For partitioned indices, pass the path without the \"_0\" "
+                                 "suffix. Compressed indices are not supported.");
+
+    parser.add_option(cfg.out_path,
+                      '\0',
+                      "output",
+                      "Write the similarity matrix as tab-separated values to this file.",
+                      seqan3::option_spec::standard,
+                      seqan3::output_file_validator{seqan3::output_file_open_options::create_new});
+
+    parser.add_option(cfg.measure,
+                      '\0',
+                      "measure",
+                      "The similarity measure. For \"containment\", the entry in row i and column j is the fraction "
+                      "of bin i that is contained in bin j.",
+                      seqan3::option_spec::standard,
+                      seqan3::value_list_validator{"jaccard", "containment"});
+
+    parser.add_option(cfg.sample_rows,
+                      '\0',
+                      "sample-rows",
+                      "The number of evenly spaced IBF rows used for the estimate. Capped at the number of rows.",
+                      seqan3::option_spec::standard,
+                      positive_integer_validator{});
+
+    parser.add_option(cfg.reorder_path,
+                      '\0',
+                      "reorder",
+                      "Write a copy of the index to this path in which similar bins are adjacent. The bin paths "
+                      "stored in the index are reordered accordingly.",
+                      seqan3::option_spec::standard,
+                      seqan3::output_file_validator{seqan3::output_file_open_options::create_new});
+
+    parser.add_option(cfg.threads,
+                      '\0',
+                      "threads",
+                      "Choose the number of threads.",
+                      seqan3::option_spec::standard,
+                      positive_integer_validator{});
+
+    try
+    {
+        parser.parse();
+    }
+    catch (seqan3::argument_parser_error const & ext)
+    {
+        std::cerr << "[Error] " << ext.what() << '\n';
+        std::exit(-1);
+    }
+
+    if (cfg.out_path.empty() && cfg.reorder_path.empty())
+    {
+        std::cerr << "[Error] Provide at least one of --output and --reorder.\n";
+        std::exit(-1);
+    }
+
+    try
+    {
+        compute_similarity(cfg);
+    }
+    catch (std::exception const & ext)
+    {
+        std::cerr << "[Error] " << ext.what() << '\n';
+        std::exit(-1);
+    }
+}
@@ -5,9 +5,13 @@
 // shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
 // -----------------------------------------------------------------------------------------------------
 
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <seqan3/std/filesystem>
 #include <mutex>
-#include <unordered_set>
+#include <queue>
+#include <seqan3/std/ranges>
 #include <vector>
 
 #include <seqan3/argument_parser/all.hpp>
@@ -32,6 +36,8 @@ struct config
     uint32_t window_size{};
     uint8_t kmer_size{};
     uint8_t threads{1u};
+    uint8_t sketch_bits{14u};
+    bool exact{false};
 
     std::vector<std::filesystem::path> bin_path{};
     std::filesystem::path out_path{};
@@ -65,51 +71,222 @@ private:
     bool is_zero_positive{false};
 };
 
+/*!\brief A HyperLogLog sketch (Flajolet et al., 2007) of 64 bit hash values.
+ * \details
+ * The first `bits` bits of a hash select one of `2^bits` registers, which stores the maximal number of leading zeros
+ * (+1) of the remaining bits. The relative standard error of the estimate is about `1.04 / sqrt(2^bits)`.
+ * Since minimiser hashes are k-mers XORed with a seed, the values are mixed before they are added.
+ */
+class hyperloglog
+{
+public:
+    hyperloglog() = default;
+    hyperloglog(hyperloglog const &) = default;
+    hyperloglog(hyperloglog &&) = default;
+    hyperloglog & operator=(hyperloglog const &) = default;
+    hyperloglog & operator=(hyperloglog &&) = default;
+    ~hyperloglog() = default;
+
+    explicit hyperloglog(uint8_t const bits_) : bits{bits_}, registers(1ULL << bits, 0u)
+    {}
+
+    void add(uint64_t value)
+    {
+        // Finaliser of MurmurHash3.
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDULL;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ULL;
+        value ^= value >> 33;
+
+        uint8_t const rank = std::countl_zero((value << bits) | (1ULL << (bits - 1u))) + 1u;
+        uint8_t & current = registers[value >> (64u - bits)];
+        current = std::max(current, rank);
+    }
+
+    //!\brief Merges another sketch of the same size. The loop is a plain register-wise maximum and auto-vectorised.
+    void merge(hyperloglog const & other)
+    {
+        uint8_t * const lhs = registers.data();
+        uint8_t const * const rhs = other.registers.data();
+        for (size_t i = 0; i < registers.size(); ++i)
+            lhs[i] = std::max(lhs[i], rhs[i]);
+    }
+
+    void clear()
+    {
+        std::ranges::fill(registers, 0u);
+    }
+
+    uint64_t estimate() const
+    {
+        double const m = registers.size();
+        double const alpha = 0.7213 / (1.0 + 1.079 / m);
+        double sum{};
+        size_t zeros{};
+
+        for (uint8_t const rank : registers)
+        {
+            sum += std::ldexp(1.0, -static_cast<int>(rank));
+            zeros += rank == 0u;
+        }
+
+        double const raw = alpha * m * m / sum;
+
+        // Linear counting is more accurate for small cardinalities.
+        if (raw <= 2.5 * m && zeros > 0u)
+            return std::llround(m * std::log(m / zeros));
+
+        return std::llround(raw);
+    }
+
+private:
+    uint8_t bits{};
+    std::vector<uint8_t> registers{};
+};
+
+//!\brief The number of distinct values in the union of sorted runs without duplicates.
+inline uint64_t count_distinct(std::vector<std::vector<uint64_t>> const & runs)
+{
+    using entry_t = std::pair<uint64_t, size_t>; // (value, run)
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue{};
+    std::vector<size_t> position(runs.size(), 0u);
+
+    for (size_t run = 0; run < runs.size(); ++run)
+        if (!runs[run].empty())
+            queue.emplace(runs[run][0], run);
+
+    uint64_t count{};
+    bool first{true};
+    uint64_t last{};
+
+    while (!queue.empty())
+    {
+        auto [value, run] = queue.top();
+        queue.pop();
+
+        if (first || value != last)
+        {
+            ++count;
+            last = value;
+            first = false;
+        }
+
+        if (++position[run] < runs[run].size())
+            queue.emplace(runs[run][position[run]], run);
+    }
+
+    return count;
+}
+
+/*!\brief The union of sorted runs without duplicates, merged incrementally.
+ * \details
+ * The runs are kept on a stack. A new run is merged with the top of the stack as long as the top is at most twice as
+ * large. Hence, each run on the stack is less than half as large as the run below it, and the stack holds less than
+ * twice the number of distinct values, regardless of the number of runs. Runs of similar size are merged, such that
+ * merging stays cheap if the runs are mostly disjoint.
+ */
+class sorted_union
+{
+public:
+    void add(std::vector<uint64_t> && run)
+    {
+        while (!levels.empty() && levels.back().size() <= 2u * run.size())
+        {
+            merge(levels.back(), run);
+            levels.pop_back();
+        }
+        levels.push_back(std::move(run));
+    }
+
+    //!\brief Merges all runs and returns the union.
+    std::vector<uint64_t> finish()
+    {
+        std::vector<uint64_t> result{};
+        for (; !levels.empty(); levels.pop_back())
+            merge(levels.back(), result);
+        return result;
+    }
+
+private:
+    std::vector<std::vector<uint64_t>> levels{};
+    std::vector<uint64_t> buffer{};
+
+    //!\brief Stores the union of `lhs` and `rhs` in `rhs`.
+    void merge(std::vector<uint64_t> const & lhs, std::vector<uint64_t> & rhs)
+    {
+        buffer.clear();
+        buffer.reserve(lhs.size() + rhs.size());
+        std::ranges::set_union(lhs, rhs, std::back_inserter(buffer));
+        std::swap(rhs, buffer);
+        buffer = std::vector<uint64_t>{};
+    }
+};
+
 inline void compute_minimisers(config const & cfg)
 {
     auto minimiser_view = seqan3::views::minimiser_hash(seqan3::ungapped{cfg.kmer_size},
                                                         seqan3::window_size{cfg.window_size},
                                                         seqan3::seed{adjust_seed(cfg.kmer_size)});
 
-    std::vector<uint64_t> minimiser_counts;
-    minimiser_counts.reserve(cfg.bin_path.size());
-    std::mutex push_back_mutex;
-    std::unordered_set<uint64_t> all_minimiser_set{};
+    size_t const bin_count{cfg.bin_path.size()};
+    std::vector<uint64_t> minimiser_counts(bin_count, 0u);
+
+    // Approximate mode: One sketch per bin, merged into one sketch per chunk and finally into the global sketch.
+    hyperloglog all_minimiser_sketch{cfg.sketch_bits};
+    // Exact mode: The union of the minimisers of the bins processed by each thread, as sorted run.
+    std::vector<std::vector<uint64_t>> runs{};
     std::mutex merge_mutex;
 
-    auto worker = [&] (auto && file_range, auto &&)
+    auto worker = [&] (auto && bin_range, auto &&)
         {
-            std::unordered_set<uint64_t> minimiser_set{};
+            hyperloglog sketch{cfg.sketch_bits};
+            hyperloglog chunk_sketch{cfg.sketch_bits};
+            std::vector<uint64_t> minimisers{};
+            sorted_union chunk_union{};
 
-            for (auto && file_name : file_range)
+            for (size_t const bin : bin_range)
             {
-                seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> fin{file_name};
-
-                for (auto & [seq] : fin)
-                    for (auto && hash : seq | minimiser_view)
-                        minimiser_set.insert(hash);
+                seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> fin{cfg.bin_path[bin]};
 
+                if (cfg.exact)
                 {
-                    std::lock_guard const lock{push_back_mutex};
-                    minimiser_counts.emplace_back(minimiser_set.size());
+                    for (auto & [seq] : fin)
+                        std::ranges::copy(seq | minimiser_view, std::back_inserter(minimisers));
+
+                    std::ranges::sort(minimisers);
+                    minimisers.erase(std::unique(minimisers.begin(), minimisers.end()), minimisers.end());
+                    minimiser_counts[bin] = minimisers.size();
+                    chunk_union.add(std::move(minimisers));
+                    minimisers = std::vector<uint64_t>{};
                 }
+                else
                 {
-                    std::lock_guard const lock{merge_mutex};
-                    all_minimiser_set.merge(minimiser_set);
-                }
+                    for (auto & [seq] : fin)
+                        for (auto && hash : seq | minimiser_view)
+                            sketch.add(hash);
 
-                minimiser_set.clear();
+                    minimiser_counts[bin] = sketch.estimate();
+                    chunk_sketch.merge(sketch);
+                    sketch.clear();
+                }
             }
+
+            std::vector<uint64_t> run = chunk_union.finish();
+            std::lock_guard const lock{merge_mutex};
+            if (cfg.exact)
+                runs.push_back(std::move(run));
+            else
+                all_minimiser_sketch.merge(chunk_sketch);
         };
 
-    size_t const chunk_size = std::ceil<size_t>(cfg.bin_path.size() / cfg.threads);
-    auto chunked_view = cfg.bin_path | seqan3::views::chunk(chunk_size);
+    size_t const chunk_size = std::max<size_t>(1u, (bin_count + cfg.threads - 1u) / cfg.threads);
+    auto chunked_view = std::views::iota(size_t{}, bin_count) | seqan3::views::chunk(chunk_size);
     seqan3::detail::execution_handler_parallel executioner{cfg.threads};
     executioner.bulk_execute(worker, std::move(chunked_view), [](){});
 
-
     std::ofstream output{cfg.out_path.string()};
-    output << all_minimiser_set.size() << '\n';
+    output << (cfg.exact ? count_distinct(runs) : all_minimiser_sketch.estimate()) << '\n';
     for (auto const & count : minimiser_counts)
         output << count << '\n';
 }
@@ -120,6 +297,11 @@ int main(int argc, char ** argv)
     parser.info.author = "Enrico Seiler";
     parser.info.author = "enrico.seiler@fu-berlin.de";
     parser.info.short_description = "Count minimiser.";
+    parser.info.description.emplace_back("Estimates the number of distinct minimisers of each file and of all files "
+                                         "combined with HyperLogLog sketches. Use --exact to count them exactly.");
+    parser.info.description.emplace_back("The first line of the output is the number of distinct minimisers of all "
+                                         "files, followed by one line per file. Without --exact, all numbers are "
+                                         "HyperLogLog estimates.");
     parser.info.version = "0.0.1";
 
     config cfg{};
@@ -131,7 +313,7 @@ int main(int argc, char ** argv)
     parser.add_option(cfg.out_path,
                       '\0',
                       "output",
-                      "Provide an output filepath.",
+                      "Provide an output filepath. Contains HyperLogLog estimates unless --exact is set.",
                       seqan3::option_spec::required,
                       seqan3::output_file_validator{seqan3::output_file_open_options::create_new});
 
@@ -156,6 +338,19 @@ int main(int argc, char ** argv)
                       seqan3::option_spec::standard,
                       positive_integer_validator{});
 
+    parser.add_option(cfg.sketch_bits,
+                      '\0',
+                      "sketch-bits",
+                      "Each sketch uses 2^sketch-bits registers. The relative error is about 1.04/sqrt(2^sketch-bits).",
+                      seqan3::option_spec::advanced,
+                      seqan3::arithmetic_range_validator{4, 20});
+
+    parser.add_flag(cfg.exact,
+                    '\0',
+                    "exact",
+                    "Count the minimisers exactly. Each thread needs up to 32 bytes of memory per distinct minimiser "
+                    "of the files it processes.");
+
     try
     {
         parser.parse();
@@ -0,0 +1,388 @@
+// -----------------------------------------------------------------------------------------------------
+// Copyright (c) 2006-2021, Knut Reinert & Freie Universität Berlin
+// Copyright (c) 2016-2021, Knut Reinert & MPI für molekulare Genetik
+// This file may be used, modified and/or redistributed under the terms of the 3-clause BSD-License
+// shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
+// -----------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+#include <seqan3/std/filesystem>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include <seqan3/argument_parser/all.hpp>
+
+#include <raptor/detail/parallel_for.hpp>
+
+struct config
+{
+    std::filesystem::path output_directory{};
+    uint64_t bins{64u};
+    uint64_t total_size{100'000'000u};
+    double skew{0.0};
+    uint64_t family_size{1u};
+    double divergence{0.01};
+    double repeat_fraction{0.0};
+    uint64_t repeat_count{100u};
+    uint64_t repeat_length{1'000u};
+    uint64_t reads{1'000'000u};
+    uint64_t read_length{150u};
+    double error_rate{0.001};
+    double end_error_rate{-1.0};
+    double n_rate{0.0};
+    uint64_t seed{42u};
+    uint64_t threads{1u};
+};
+
+class positive_integer_validator
+{
+public:
+    using option_value_type = size_t;
+
+    positive_integer_validator() = default;
+    positive_integer_validator(bool const is_zero_positive_) : is_zero_positive{is_zero_positive_} {}
+
+    void operator() (option_value_type const & val) const
+    {
+        if (!is_zero_positive && !val)
+        {
+            throw seqan3::validation_error{"The value must be a positive integer."};
+        }
+    }
+
+    std::string get_help_page_message () const
+    {
+        if (is_zero_positive)
+            return "Value must be a positive integer or 0.";
+        else
+            return "Value must be a positive integer.";
+    }
+
+private:
+    bool is_zero_positive{false};
+};
+
+static constexpr uint64_t splitmix(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+//!\brief A random value that only depends on the arguments. Used to make every base addressable by its position.
+static constexpr uint64_t random_value(uint64_t const seed, uint64_t const a, uint64_t const b = 0u)
+{
+    return splitmix(splitmix(splitmix(seed) ^ a) ^ b);
+}
+
+//!\brief Maps a random value to [0, 1).
+static constexpr double to_unit(uint64_t const value)
+{
+    return (value >> 11) * 0x1.0p-53;
+}
+
+// Distinct domains for the random values, such that, e.g., founder 3 and repeat 3 are unrelated.
+enum domain : uint64_t
+{
+    founder_domain = 1ULL << 60,
+    repeat_domain = 2ULL << 60,
+    segment_domain = 3ULL << 60,
+    mutation_domain = 4ULL << 60,
+    read_domain = 5ULL << 60,
+    size_domain = 6ULL << 60
+};
+
+/*!\brief Describes a synthetic collection of bins.
+ * \details
+ * Every base of every bin is a pure function of the seed, the bin and the position. Hence, bins can be written in
+ * parallel and reads can be sampled without keeping the bins in memory:
+ *   * Bins are grouped into families of `family_size` strains. All strains of a family are derived from the same
+ *     random founder sequence, whose bases are substituted with probability `divergence` in each strain.
+ *   * Each bin is split into segments of `repeat_length` bases. With probability `repeat_fraction`, a segment is
+ *     replaced by one of `repeat_count` random repeats, which are shared by all bins. The strains of a family
+ *     contain the same repeats at the same positions.
+ *   * The bin sizes follow a Zipf distribution with exponent `skew`; the sizes are assigned to the bins in random
+ *     order.
+ */
+class collection
+{
+public:
+    explicit collection(config const & cfg_) : cfg{cfg_}
+    {
+        std::vector<double> weights(cfg.bins);
+        for (uint64_t rank = 0; rank < cfg.bins; ++rank)
+            weights[rank] = std::pow(static_cast<double>(rank + 1u), -cfg.skew);
+
+        // Fisher-Yates shuffle, such that large and small bins are not sorted by their number.
+        for (uint64_t i = cfg.bins - 1u; i > 0u; --i)
+            std::swap(weights[i], weights[random_value(cfg.seed, size_domain, i) % (i + 1u)]);
+
+        double const weight_sum = std::accumulate(weights.begin(), weights.end(), 0.0);
+        sizes.resize(cfg.bins);
+        for (uint64_t bin = 0; bin < cfg.bins; ++bin)
+            sizes[bin] = std::max<uint64_t>(cfg.read_length, std::llround(cfg.total_size * weights[bin] / weight_sum));
+
+        offsets.resize(cfg.bins + 1u);
+        std::partial_sum(sizes.begin(), sizes.end(), offsets.begin() + 1);
+    }
+
+    uint64_t size(uint64_t const bin) const
+    {
+        return sizes[bin];
+    }
+
+    uint64_t total_size() const
+    {
+        return offsets.back();
+    }
+
+    //!\brief The bin that contains the `position`-th base of the concatenation of all bins.
+    uint64_t bin_at(uint64_t const position) const
+    {
+        return std::ranges::upper_bound(offsets, position) - offsets.begin() - 1;
+    }
+
+    uint64_t offset(uint64_t const bin) const
+    {
+        return offsets[bin];
+    }
+
+    //!\brief The rank (0-3) of the base at `position` in `bin`.
+    uint8_t base(uint64_t const bin, uint64_t const position) const
+    {
+        uint64_t const family = bin / cfg.family_size;
+        uint64_t const segment = position / cfg.repeat_length;
+        uint64_t const segment_value = random_value(cfg.seed, segment_domain | family, segment);
+
+        uint8_t rank{};
+        if (cfg.repeat_fraction > 0.0 && to_unit(segment_value) < cfg.repeat_fraction)
+        {
+            uint64_t const repeat = splitmix(segment_value) % cfg.repeat_count;
+            rank = random_rank(repeat_domain | repeat, position % cfg.repeat_length);
+        }
+        else
+        {
+            rank = random_rank(founder_domain | family, position);
+        }
+
+        uint64_t const mutation = random_value(cfg.seed, mutation_domain | bin, position);
+        if (to_unit(mutation) < cfg.divergence)
+            rank = (rank + 1u + splitmix(mutation) % 3u) & 3u;
+
+        return rank;
+    }
+
+private:
+    config const & cfg;
+    std::vector<uint64_t> sizes{};
+    std::vector<uint64_t> offsets{0u};
+
+    //!\brief 32 random bases are drawn from one 64 bit value.
+    uint8_t random_rank(uint64_t const stream, uint64_t const position) const
+    {
+        return (random_value(cfg.seed, stream, position >> 5) >> ((position & 31u) << 1)) & 3u;
+    }
+};
+
+std::string bin_name(config const & cfg, uint64_t const bin)
+{
+    std::string const number = std::to_string(bin);
+    return "bin_" + std::string(std::to_string(cfg.bins - 1u).size() - number.size(), '0') + number;
+}
+
+void write_bins(config const & cfg, collection const & bins)
+{
+    static constexpr std::string_view dna4_chars{"ACGT"};
+
+    std::filesystem::create_directories(cfg.output_directory / "bins");
+
+    // The largest bins are started first.
+    std::vector<uint64_t> order(cfg.bins);
+    std::iota(order.begin(), order.end(), 0u);
+    std::ranges::sort(order, [&] (uint64_t const lhs, uint64_t const rhs) { return bins.size(lhs) > bins.size(rhs); });
+
+    raptor::detail::parallel_for(cfg.bins, cfg.threads, [&] (size_t const i)
+    {
+        uint64_t const bin = order[i];
+        std::ofstream out{cfg.output_directory / "bins" / (bin_name(cfg, bin) + ".fasta"), std::ios::binary};
+        std::string buffer{">" + bin_name(cfg, bin) + '\n'};
+
+        for (uint64_t position = 0; position < bins.size(bin); ++position)
+        {
+            buffer += dna4_chars[bins.base(bin, position)];
+            if (position % 80u == 79u || position + 1u == bins.size(bin))
+                buffer += '\n';
+
+            if (buffer.size() >= (1ULL << 20))
+            {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        }
+
+        out.write(buffer.data(), buffer.size());
+    });
+
+    std::ofstream list{cfg.output_directory / "bins.txt"};
+    for (uint64_t bin = 0; bin < cfg.bins; ++bin)
+        list << (cfg.output_directory / "bins" / (bin_name(cfg, bin) + ".fasta")).string() << '\n';
+}
+
+/*!\brief Samples reads uniformly from the concatenation of all bins, i.e., larger bins get more reads.
+ * \details
+ * Half of the reads are reverse complemented. The substitution rate increases linearly from `error_rate` at the
+ * first base to `end_error_rate` at the last base, and bases are replaced by N with probability `n_rate`.
+ * The ID of a read contains its origin: `read_<number>_bin_<bin>_pos_<position>_<strand>`.
+ */
+void write_reads(config const & cfg, collection const & bins)
+{
+    static constexpr std::string_view dna4_chars{"ACGT"};
+    static constexpr std::string_view complement_chars{"TGCA"};
+
+    double const end_error_rate = cfg.end_error_rate < 0.0 ? cfg.error_rate : cfg.end_error_rate;
+    uint64_t const positions = bins.total_size();
+    size_t const reads_per_task{1ULL << 14};
+    size_t const tasks_per_batch{4u * cfg.threads};
+    std::string const quality(cfg.read_length, 'I');
+
+    std::ofstream out{cfg.output_directory / "reads.fastq", std::ios::binary};
+    std::vector<std::string> buffers(tasks_per_batch);
+
+    for (uint64_t batch_begin = 0; batch_begin < cfg.reads; batch_begin += reads_per_task * tasks_per_batch)
+    {
+        raptor::detail::parallel_for(tasks_per_batch, cfg.threads, [&] (size_t const task)
+        {
+            std::string & buffer = buffers[task];
+            buffer.clear();
+
+            uint64_t const begin = std::min(cfg.reads, batch_begin + task * reads_per_task);
+            uint64_t const end = std::min(cfg.reads, begin + reads_per_task);
+            std::string read{};
+
+            for (uint64_t number = begin; number < end; ++number)
+            {
+                uint64_t value = random_value(cfg.seed, read_domain, number);
+                uint64_t const bin = bins.bin_at(value % positions);
+                value = splitmix(value);
+                uint64_t const start = value % (bins.size(bin) - cfg.read_length + 1u);
+                value = splitmix(value);
+                bool const reverse = value & 1u;
+
+                read.clear();
+                for (uint64_t i = 0; i < cfg.read_length; ++i)
+                    read += dna4_chars[bins.base(bin, start + i)];
+                if (reverse)
+                {
+                    std::ranges::reverse(read);
+                    for (char & base : read)
+                        base = complement_chars[dna4_chars.find(base)];
+                }
+
+                for (uint64_t i = 0; i < cfg.read_length; ++i)
+                {
+                    double const progress = cfg.read_length > 1u ? static_cast<double>(i) / (cfg.read_length - 1u) : 0.0;
+                    double const error_rate = cfg.error_rate + (end_error_rate - cfg.error_rate) * progress;
+
+                    value = splitmix(value);
+                    if (to_unit(value) < error_rate)
+                        read[i] = dna4_chars[(dna4_chars.find(read[i]) + 1u + (value >> 3) % 3u) & 3u];
+
+                    value = splitmix(value);
+                    if (to_unit(value) < cfg.n_rate)
+                        read[i] = 'N';
+                }
+
+                buffer += "@read_" + std::to_string(number) + "_bin_" + std::to_string(bin) + "_pos_" +
+                          std::to_string(start) + (reverse ? "_rc\n" : "_fw\n");
+                buffer += read;
+                buffer += "\n+\n";
+                buffer += quality;
+                buffer += '\n';
+            }
+        });
+
+        for (auto const & buffer : buffers)
+            out.write(buffer.data(), buffer.size());
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    seqan3::argument_parser parser{"generate_collection", argc, argv, seqan3::update_notifications::off};
+    parser.info.author = "Enrico Seiler";
+    parser.info.author = "enrico.seiler@fu-berlin.de";
+    parser.info.short_description = "Generates a synthetic collection of bins and reads with skewed bin sizes, similar "
+                                    "strains, shared repeats, and reads with errors and Ns.";
+    parser.info.version = "0.0.1";
+    parser.info.description.emplace_back("Writes bins/bin_*.fasta, bins.txt (one bin per line, as used by raptor "
+                                         "build), and reads.fastq to the output directory. The output only depends on "
+                                         "the options and the seed, not on the number of threads.");
+
+    config cfg{};
+
+    parser.add_option(cfg.output_directory,
+                      '\0',
+                      "output",
+                      "Provide an output directory.",
+                      seqan3::option_spec::required,
+                      seqan3::output_directory_validator{});
+    parser.add_option(cfg.bins, '\0', "bins", "The number of bins.",
+                      seqan3::option_spec::standard, positive_integer_validator{});
+    parser.add_option(cfg.total_size, '\0', "size", "The total number of bases of all bins.",
+                      seqan3::option_spec::standard, positive_integer_validator{});
+    parser.add_option(cfg.skew, '\0', "skew", "The exponent of the Zipf distribution of the bin sizes. 0 yields bins "
+                      "of equal size, 1 yields bins whose sizes differ by a factor of up to the number of bins.",
+                      seqan3::option_spec::standard, seqan3::arithmetic_range_validator{0, 10});
+    parser.add_option(cfg.family_size, '\0', "family-size", "The number of consecutive bins that are strains of the "
+                      "same founder sequence. 1 yields unrelated bins.",
+                      seqan3::option_spec::standard, positive_integer_validator{});
+    parser.add_option(cfg.divergence, '\0', "divergence", "The substitution rate of each strain with respect to its "
+                      "founder.", seqan3::option_spec::standard, seqan3::arithmetic_range_validator{0, 1});
+    parser.add_option(cfg.repeat_fraction, '\0', "repeat-fraction", "The fraction of each bin that consists of "
+                      "repeats shared by all bins.",
+                      seqan3::option_spec::standard, seqan3::arithmetic_range_validator{0, 1});
+    parser.add_option(cfg.repeat_count, '\0', "repeat-count", "The number of distinct repeats.",
+                      seqan3::option_spec::standard, positive_integer_validator{});
+    parser.add_option(cfg.repeat_length, '\0', "repeat-length", "The length of a repeat.",
+                      seqan3::option_spec::standard, positive_integer_validator{});
+    parser.add_option(cfg.reads, '\0', "reads", "The number of reads. 0 skips the read simulation.",
+                      seqan3::option_spec::standard, positive_integer_validator{true});
+    parser.add_option(cfg.read_length, '\0', "read-length", "The read length.",
+                      seqan3::option_spec::standard, positive_integer_validator{});
+    parser.add_option(cfg.error_rate, '\0', "error-rate", "The substitution rate at the first base of a read.",
+                      seqan3::option_spec::standard, seqan3::arithmetic_range_validator{0, 1});
+    parser.add_option(cfg.end_error_rate, '\0', "end-error-rate", "The substitution rate at the last base of a read. "
+                      "The rate increases linearly along the read. Default: --error-rate.",
+                      seqan3::option_spec::standard);
+    parser.add_option(cfg.n_rate, '\0', "n-rate", "The probability of a read base being N.",
+                      seqan3::option_spec::standard, seqan3::arithmetic_range_validator{0, 1});
+    parser.add_option(cfg.seed, '\0', "seed", "The seed of the random number generator.",
+                      seqan3::option_spec::standard);
+    parser.add_option(cfg.threads, '\0', "threads", "Choose the number of threads.",
+                      seqan3::option_spec::standard, positive_integer_validator{});
+
+    try
+    {
+        parser.parse();
+    }
+    catch (seqan3::argument_parser_error const & ext)
+    {
+        std::cerr << "[Error] " << ext.what() << '\n';
+        std::exit(-1);
+    }
+
+    if (cfg.end_error_rate > 1.0)
+    {
+        std::cerr << "[Error] --end-error-rate must be at most 1.\n";
+        std::exit(-1);
+    }
+
+    collection const bins{cfg};
+    write_bins(cfg, bins);
+    if (cfg.reads > 0u)
+        write_reads(cfg, bins);
+}
@@ -5,17 +5,52 @@
 // shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
 // -----------------------------------------------------------------------------------------------------
 
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <mutex>
 #include <random>
 
 #include <seqan3/argument_parser/all.hpp>
+#include <seqan3/core/algorithm/detail/execution_handler_parallel.hpp>
 #include <seqan3/io/sequence_file/input.hpp>
-#include <seqan3/io/sequence_file/output.hpp>
+#include <seqan3/utility/views/chunk.hpp>
+#include <seqan3/utility/views/slice.hpp>
+#include <seqan3/utility/views/to.hpp>
 
 struct my_traits : seqan3::sequence_file_input_default_traits_dna
 {
     using sequence_alphabet = seqan3::dna4;
 };
 
+class positive_integer_validator
+{
+public:
+    using option_value_type = size_t;
+
+    positive_integer_validator() = default;
+    positive_integer_validator(bool const is_zero_positive_) : is_zero_positive{is_zero_positive_} {}
+
+    void operator() (option_value_type const & val) const
+    {
+        if (!is_zero_positive && !val)
+        {
+            throw seqan3::validation_error{"The value must be a positive integer."};
+        }
+    }
+
+    std::string get_help_page_message () const
+    {
+        if (is_zero_positive)
+            return "Value must be a positive integer or 0.";
+        else
+            return "Value must be a positive integer.";
+    }
+
+private:
+    bool is_zero_positive{false};
+};
+
 struct cmd_arguments
 {
     std::filesystem::path bin_file_path{};
@@ -26,72 +61,172 @@ struct cmd_arguments
     uint32_t read_length{100u};
     uint32_t number_of_reads{1ULL<<20};
     uint16_t number_of_haplotypes{16u};
+    uint64_t seed{42u};
+    uint64_t threads{1u};
 };
 
-void run_program(cmd_arguments const & arguments)
+/*!\brief A counter-based random number generator.
+ * \details
+ * The n-th number of a stream is the SplitMix64 hash of the stream's key and n. Each read uses its own stream, which
+ * is derived from the seed and the read's number. Hence, the output does not depend on the number of threads.
+ */
+class counter_rng
 {
-    std::random_device rd;
-    std::mt19937_64 rng(rd());
-    std::uniform_int_distribution<uint32_t> read_error_position_dis(0, arguments.read_length - 1);
-    std::uniform_int_distribution<uint8_t> dna4_rank_dis(0, 3);
+public:
+    using result_type = uint64_t;
+
+    counter_rng(uint64_t const seed, uint64_t const stream) : key{splitmix(seed ^ splitmix(stream))}
+    {}
 
+    static constexpr result_type min()
+    {
+        return std::numeric_limits<result_type>::min();
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        return splitmix(key + ++counter * 0x9E3779B97F4A7C15ULL);
+    }
+
+private:
+    uint64_t key{};
+    uint64_t counter{};
+
+    static constexpr uint64_t splitmix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+};
+
+//!\brief Appends a FASTQ record in the format of seqan3::sequence_file_output.
+inline void append_fastq(std::string & buffer,
+                         uint64_t const id,
+                         std::vector<seqan3::dna4> const & read,
+                         std::string const & quality)
+{
+    buffer += '@';
+    buffer += std::to_string(id);
+    buffer += '\n';
+    for (seqan3::dna4 const base : read)
+        buffer += seqan3::to_char(base);
+    buffer += "\n+\n";
+    buffer += quality;
+    buffer += '\n';
+}
+
+void run_program(cmd_arguments const & arguments)
+{
     size_t const number_of_bins{arguments.bin_path.size()};
     uint32_t const reads_per_bin = arguments.number_of_reads / number_of_bins;
     uint32_t const reads_per_haplotype = reads_per_bin / arguments.number_of_haplotypes;
-    uint32_t read_counter{};
-    // uint64_t bin_counter{};
 
-    std::vector<seqan3::phred42> const quality(arguments.read_length, seqan3::assign_rank_to(40u, seqan3::phred42{}));
+    std::string const quality(arguments.read_length, seqan3::phred42{}.assign_rank(40u).to_char());
+    std::mutex warning_mutex{};
+    // Each bin has a fixed range of read IDs. More haplotypes than expected would overflow into the next bin's range.
+    std::atomic<bool> too_many_haplotypes{false};
+    std::filesystem::path failed_file{};
 
-    for (auto const bin_file : arguments.bin_path)
+    auto worker = [&] (auto && bin_numbers, auto &&)
     {
-        // std::cerr << "Processing bin " << ++bin_counter << " of " << number_of_bins << '\n';
+        std::uniform_int_distribution<uint32_t> read_error_position_dis(0, arguments.read_length - 1);
+        std::uniform_int_distribution<uint8_t> dna4_rank_dis(0, 3);
+        std::string buffer{};
 
-        // Immediately invoked initialising lambda expession (IIILE).
-        std::filesystem::path const out_file = [&]
-                                               {
-                                                   std::filesystem::path out_file = arguments.out_path;
-                                                   out_file /= bin_file.stem();
-                                                   out_file += ".fastq";
-                                                   return out_file;
-                                               }();
+        for (size_t const bin_number : bin_numbers)
+        {
+            if (too_many_haplotypes)
+                return;
 
-        seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{bin_file};
-        seqan3::sequence_file_output fout{out_file};
+            std::filesystem::path const & bin_file = arguments.bin_path[bin_number];
 
-        uint16_t haplotype_counter{};
+            // Immediately invoked initialising lambda expession (IIILE).
+            std::filesystem::path const out_file = [&]
+                                                   {
+                                                       std::filesystem::path out_file = arguments.out_path;
+                                                       out_file /= bin_file.stem();
+                                                       out_file += ".fastq";
+                                                       return out_file;
+                                                   }();
 
-        for (auto const & [seq] : fin)
-        {
-            uint64_t const reference_length = std::ranges::size(seq);
-            std::uniform_int_distribution<uint64_t> read_start_dis(0, reference_length - arguments.read_length);
-            for (uint32_t current_read_number = 0; current_read_number < reads_per_haplotype; ++current_read_number, ++read_counter)
+            seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> fin{bin_file};
+            std::ofstream fout{out_file, std::ios::binary};
+
+            uint16_t haplotype_counter{};
+
+            for (auto const & [seq] : fin)
             {
-                uint64_t const read_start_pos = read_start_dis(rng);
-                std::vector<seqan3::dna4> read = seq |
-                                                 seqan3::views::slice(read_start_pos, read_start_pos + arguments.read_length) |
-                                                 seqan3::views::to<std::vector>;
+                if (haplotype_counter == arguments.number_of_haplotypes)
+                {
+                    std::lock_guard const lock{warning_mutex};
+                    if (!too_many_haplotypes.exchange(true))
+                        failed_file = bin_file;
+                    return;
+                }
+
+                uint64_t const reference_length = std::ranges::size(seq);
+                std::uniform_int_distribution<uint64_t> read_start_dis(0, reference_length - arguments.read_length);
+                uint64_t read_counter = bin_number * reads_per_bin + haplotype_counter * reads_per_haplotype;
 
-                for (uint8_t error_count = 0; error_count < arguments.max_errors; ++error_count)
+                for (uint32_t current_read_number = 0; current_read_number < reads_per_haplotype; ++current_read_number, ++read_counter)
                 {
-                    uint32_t const error_pos = read_error_position_dis(rng);
-                    seqan3::dna4 const current_base = read[error_pos];
-                    seqan3::dna4 new_base = current_base;
-                    while (new_base == current_base)
-                        seqan3::assign_rank_to(dna4_rank_dis(rng), new_base);
-                    read[error_pos] = new_base;
+                    counter_rng rng{arguments.seed, read_counter};
+                    uint64_t const read_start_pos = read_start_dis(rng);
+                    std::vector<seqan3::dna4> read = seq |
+                                                     seqan3::views::slice(read_start_pos, read_start_pos + arguments.read_length) |
+                                                     seqan3::views::to<std::vector>;
+
+                    for (uint8_t error_count = 0; error_count < arguments.max_errors; ++error_count)
+                    {
+                        uint32_t const error_pos = read_error_position_dis(rng);
+                        seqan3::dna4 const current_base = read[error_pos];
+                        seqan3::dna4 new_base = current_base;
+                        while (new_base == current_base)
+                            seqan3::assign_rank_to(dna4_rank_dis(rng), new_base);
+                        read[error_pos] = new_base;
+                    }
+
+                    append_fastq(buffer, read_counter, read, quality);
+
+                    if (buffer.size() >= (1ULL << 20))
+                    {
+                        fout.write(buffer.data(), buffer.size());
+                        buffer.clear();
+                    }
                 }
+                ++haplotype_counter;
+            }
 
-                fout.emplace_back(read, std::to_string(read_counter), quality);
+            fout.write(buffer.data(), buffer.size());
+            buffer.clear();
+
+            if (haplotype_counter < arguments.number_of_haplotypes)
+            {
+                std::lock_guard const lock{warning_mutex};
+                std::cerr << "[WARNING] There are not enough haplotypes in the file " << bin_file.string() << '\n'
+                          << "[WARNING] Your total read count will be incorrect.\n"
+                          << "[WARNING] Haplotypes in file: " << haplotype_counter << '\n'
+                          << "[WARNING] Haplotypes expected: " << arguments.number_of_haplotypes << '\n';
             }
-            ++haplotype_counter;
         }
+    };
+
+    // Chunks of one bin distribute the bins dynamically over the threads.
+    auto chunked_view = std::views::iota(size_t{}, number_of_bins) | seqan3::views::chunk(1u);
+    seqan3::detail::execution_handler_parallel executioner{arguments.threads};
+    executioner.bulk_execute(std::move(worker), std::move(chunked_view), [](){});
 
-        if (haplotype_counter != arguments.number_of_haplotypes)
-            std::cerr << "[WARNING] There are not enough / too many haplotypes in the file " << bin_file.string() << '\n'
-                      << "[WARNING] Your total read count will be incorrect.\n"
-                      << "[WARNING] Haplotypes in file: " << haplotype_counter << '\n'
-                      << "[WARNING] Haplotypes expected: " << arguments.number_of_haplotypes << '\n';
+    if (too_many_haplotypes)
+    {
+        std::cerr << "[Error] The file " << failed_file.string() << " contains more than "
+                  << arguments.number_of_haplotypes << " haplotypes. Increase --number_of_haplotypes.\n";
+        std::exit(-1);
     }
 }
 
@@ -131,6 +266,17 @@ void initialise_argument_parser(seqan3::argument_parser & parser, cmd_arguments
                       '\0',
                       "number_of_haplotypes",
                       "The number of haplotypes.");
+    parser.add_option(arguments.seed,
+                      '\0',
+                      "seed",
+                      "The seed of the random number generator. The output only depends on the seed and the input, "
+                      "not on the number of threads.");
+    parser.add_option(arguments.threads,
+                      '\0',
+                      "threads",
+                      "Number of threads to use.",
+                      seqan3::option_spec::standard,
+                      positive_integer_validator{});
 }
 
 int main(int argc, char ** argv)
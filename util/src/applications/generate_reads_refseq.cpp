@@ -5,13 +5,16 @@
 // shipped with this file and also available at: https://github.com/seqan/raptor/blob/master/LICENSE.md
 // -----------------------------------------------------------------------------------------------------
 
+#include <fstream>
+#include <limits>
 #include <random>
 
 #include <seqan3/argument_parser/all.hpp>
 #include <seqan3/core/algorithm/detail/execution_handler_parallel.hpp>
 #include <seqan3/io/sequence_file/input.hpp>
-#include <seqan3/io/sequence_file/output.hpp>
 #include <seqan3/utility/views/chunk.hpp>
+#include <seqan3/utility/views/slice.hpp>
+#include <seqan3/utility/views/to.hpp>
 
 struct cmd_arguments
 {
@@ -21,6 +24,7 @@ struct cmd_arguments
     uint8_t errors{2u};
     uint32_t read_length{100u};
     uint32_t number_of_reads{1ULL<<20};
+    uint64_t seed{42u};
     uint64_t threads{1u};
 };
 
@@ -63,6 +67,62 @@ private:
     bool is_zero_positive{false};
 };
 
+/*!\brief A counter-based random number generator.
+ * \details
+ * The n-th number of a stream is the SplitMix64 hash of the stream's key and n. Each read uses its own stream, which
+ * is derived from the seed and the read's number. Hence, the output does not depend on the number of threads.
+ */
+class counter_rng
+{
+public:
+    using result_type = uint64_t;
+
+    counter_rng(uint64_t const seed, uint64_t const stream) : key{splitmix(seed ^ splitmix(stream))}
+    {}
+
+    static constexpr result_type min()
+    {
+        return std::numeric_limits<result_type>::min();
+    }
+
+    static constexpr result_type max()
+    {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()()
+    {
+        return splitmix(key + ++counter * 0x9E3779B97F4A7C15ULL);
+    }
+
+private:
+    uint64_t key{};
+    uint64_t counter{};
+
+    static constexpr uint64_t splitmix(uint64_t value)
+    {
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+        return value ^ (value >> 31);
+    }
+};
+
+//!\brief Appends a FASTQ record in the format of seqan3::sequence_file_output.
+inline void append_fastq(std::string & buffer,
+                         uint64_t const id,
+                         std::vector<seqan3::dna4> const & read,
+                         std::string const & quality)
+{
+    buffer += '@';
+    buffer += std::to_string(id);
+    buffer += '\n';
+    for (seqan3::dna4 const base : read)
+        buffer += seqan3::to_char(base);
+    buffer += "\n+\n";
+    buffer += quality;
+    buffer += '\n';
+}
+
 inline size_t count_records_in_fasta(std::filesystem::path const & filename)
 {
     seqan3::sequence_file_input<char_traits, seqan3::fields<seqan3::field::id>> fin{filename};
@@ -71,20 +131,20 @@ inline size_t count_records_in_fasta(std::filesystem::path const & filename)
 
 void run_program(cmd_arguments const & arguments)
 {
-    std::uniform_int_distribution<uint32_t> read_error_position_dis(0, arguments.read_length - 1);
-    std::uniform_int_distribution<uint8_t> dna4_rank_dis(0, 3);
-
     size_t const number_of_bins{arguments.bin_path.size()};
     uint32_t const reads_per_bin = arguments.number_of_reads / number_of_bins;
 
-    std::vector<seqan3::phred42> const quality(arguments.read_length, seqan3::assign_rank_to(40u, seqan3::phred42{}));
+    std::string const quality(arguments.read_length, seqan3::phred42{}.assign_rank(40u).to_char());
 
     auto worker = [&] (auto && zipped_view, auto &&)
     {
+        std::uniform_int_distribution<uint32_t> read_error_position_dis(0, arguments.read_length - 1);
+        std::uniform_int_distribution<uint8_t> dna4_rank_dis(0, 3);
+        std::string buffer{};
+
         for (auto && [bin_file, bin_number] : zipped_view)
         {
-            std::mt19937_64 rng(bin_number);
-            uint32_t read_counter{bin_number * reads_per_bin};
+            uint64_t read_counter{static_cast<uint64_t>(bin_number) * reads_per_bin};
             // Immediately invoked initialising lambda expession (IIILE).
             std::filesystem::path const out_file = [&] ()
                                                    {
@@ -101,9 +161,9 @@ void run_program(cmd_arguments const & arguments)
             uint32_t const reads_per_record = (reads_per_bin + number_of_records - 1) / number_of_records;
 
             seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> fin{bin_file};
-            seqan3::sequence_file_output fout{out_file};
+            std::ofstream fout{out_file, std::ios::binary};
 
-            uint16_t bin_read_counter{};
+            uint32_t bin_read_counter{};
 
             for (auto const & [seq] : fin)
             {
@@ -113,6 +173,7 @@ void run_program(cmd_arguments const & arguments)
                     current_read_number < reads_per_record && bin_read_counter < reads_per_bin;
                     ++current_read_number, ++read_counter, ++bin_read_counter)
                 {
+                    counter_rng rng{arguments.seed, read_counter};
                     uint64_t const read_start_pos = read_start_dis(rng);
                     std::vector<seqan3::dna4> read = seq
                                                    | seqan3::views::slice(read_start_pos, read_start_pos + arguments.read_length)
@@ -128,14 +189,23 @@ void run_program(cmd_arguments const & arguments)
                         read[error_pos] = new_base;
                     }
 
-                    fout.emplace_back(read, std::to_string(read_counter), quality);
+                    append_fastq(buffer, read_counter, read, quality);
+
+                    if (buffer.size() >= (1ULL << 20))
+                    {
+                        fout.write(buffer.data(), buffer.size());
+                        buffer.clear();
+                    }
                 }
             }
+
+            fout.write(buffer.data(), buffer.size());
+            buffer.clear();
         }
     };
 
-    size_t const chunk_size = std::bit_ceil(number_of_bins / arguments.threads);
-    auto chunked_view = seqan3::views::zip(arguments.bin_path, std::views::iota(0u)) | seqan3::views::chunk(chunk_size);
+    // Chunks of one bin distribute the bins dynamically over the threads.
+    auto chunked_view = seqan3::views::zip(arguments.bin_path, std::views::iota(0u)) | seqan3::views::chunk(1u);
     seqan3::detail::execution_handler_parallel executioner{arguments.threads};
     executioner.bulk_execute(std::move(worker), std::move(chunked_view), [](){});
 }
@@ -174,6 +244,11 @@ void initialise_argument_parser(seqan3::argument_parser & parser, cmd_arguments
                       "The number of reads.",
                       seqan3::option_spec::standard,
                       positive_integer_validator{});
+    parser.add_option(arguments.seed,
+                      '\0',
+                      "seed",
+                      "The seed of the random number generator. The output only depends on the seed and the input, "
+                      "not on the number of threads.");
     parser.add_option(arguments.threads,
                       '\0',
                       "threads",
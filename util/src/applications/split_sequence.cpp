@@ -6,22 +6,25 @@
 // -----------------------------------------------------------------------------------------------------
 
 #include <seqan3/std/filesystem>
+#include <fstream>
+#include <future>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <string_view>
+#include <vector>
 
 #include <seqan3/argument_parser/all.hpp>
-#include <seqan3/alphabet/nucleotide/dna4.hpp>
 #include <seqan3/io/sequence_file/input.hpp>
-#include <seqan3/io/sequence_file/output.hpp>
-#include <seqan3/utility/views/chunk.hpp>
 
-struct dna4_traits : seqan3::sequence_file_input_default_traits_dna
-{
-    using sequence_alphabet = seqan3::dna4;
-};
+#include <raptor/detail/chunked_sequence_reader.hpp>
+#include <raptor/detail/streaming_minimiser.hpp>
 
 struct config
 {
     uint64_t parts{};
     uint64_t length{};
+    uint64_t overlap{};
     uint64_t sequence_size{};
 
     std::filesystem::path input_path{};
@@ -56,31 +59,179 @@ private:
     bool is_zero_positive{false};
 };
 
-inline void split_sequence(config const & cfg)
+//!\brief The lengths of all records of the input.
+inline std::vector<uint64_t> record_lengths(std::filesystem::path const & input_path)
+{
+    std::vector<uint64_t> lengths{};
+    raptor::detail::chunked_sequence_reader reader{input_path};
+    reader.read([&] (std::string_view) { lengths.push_back(0u); },
+                [&] (std::string_view bases) { lengths.back() += bases.size(); },
+                [] () {});
+    return lengths;
+}
+
+/*!\brief Writes one part in FASTA format.
+ * \details
+ * The sequence is formatted into a buffer. Full buffers are written by a background task while the next buffer is
+ * filled, hence each part holds at most two buffers in memory.
+ */
+class part_writer
 {
-    seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> input_sequence{cfg.input_path};
+public:
+    part_writer() = default;
+    part_writer(part_writer const &) = delete;
+    part_writer(part_writer &&) = delete;
+    part_writer & operator=(part_writer const &) = delete;
+    part_writer & operator=(part_writer &&) = delete;
 
-    std::string id;
-    size_t part{};
+    explicit part_writer(std::filesystem::path const & path) : file{path, std::ios::binary}
+    {}
+
+    ~part_writer()
+    {
+        if (line_length > 0u)
+            buffer += '\n';
+        flush();
+        if (pending.valid())
+            pending.get();
+    }
+
+    void start_record(std::string const & id)
+    {
+        if (line_length > 0u)
+            buffer += '\n';
+        buffer += '>';
+        buffer += id;
+        buffer += '\n';
+        line_length = 0u;
+    }
+
+    void append(std::string_view bases)
+    {
+        while (!bases.empty())
+        {
+            size_t const count = std::min<size_t>(bases.size(), 80u - line_length);
+            for (char const base : bases.substr(0, count))
+                buffer += dna4_chars[raptor::detail::dna4_rank_table[static_cast<uint8_t>(base)]];
+            bases.remove_prefix(count);
+
+            if ((line_length += count) == 80u)
+            {
+                buffer += '\n';
+                line_length = 0u;
+            }
+        }
+
+        if (buffer.size() >= (1ULL << 22))
+            flush();
+    }
+
+private:
+    static constexpr std::string_view dna4_chars{"ACGT"};
+
+    std::ofstream file{};
+    std::string buffer{};
+    std::string writing{};
+    std::future<void> pending{};
+    size_t line_length{};
+
+    void flush()
+    {
+        if (pending.valid())
+            pending.get();
+
+        std::swap(buffer, writing);
+        buffer.clear();
+        pending = std::async(std::launch::async, [this] () { file.write(writing.data(), writing.size()); });
+    }
+};
+
+/*!\brief Splits all records into parts of `cfg.length` bases in a single pass.
+ * \details
+ * The records are treated as one sequence: Part `i` covers the positions `[i * length, (i + 1) * length + overlap)`
+ * of the concatenation of all records. A part contains one FASTA record for each input record it intersects, whose
+ * ID contains the covered global interval. The overlap never extends a part into the next input record.
+ */
+inline void split_sequence(config const & cfg, std::vector<uint64_t> const & lengths)
+{
     size_t const n_zero = std::to_string(cfg.parts).length();
 
-    for (auto && split_sequence : (*input_sequence.begin()).sequence() | seqan3::views::chunk(cfg.length))
+    auto padded = [&] (size_t const part)
     {
         std::string part_as_string = std::to_string(part);
-        std::string padded_parts = std::string(n_zero - part_as_string.length(), '0') + part_as_string;
-        std::string filename = "bin_" + padded_parts + ".fasta";
-        std::filesystem::path out_path = cfg.output_path;
-        out_path /= filename;
-        seqan3::sequence_file_output output_sequence{out_path};
-        output_sequence.options.fasta_blank_before_id = false;
-
-        id = "bin_" + padded_parts;
-        size_t const start = part++ * cfg.length;
-        size_t const end = part * cfg.length;
-        id += "_[" + std::to_string(start) + ',' + std::to_string(end) + ')';
-
-        output_sequence.emplace_back(split_sequence, id);
-    }
+        return std::string(n_zero - part_as_string.length(), '0') + part_as_string;
+    };
+
+    std::map<size_t, std::unique_ptr<part_writer>> writers{};
+    size_t record{};
+    uint64_t record_begin{};
+    uint64_t position{};
+
+    // Starts a record in `part` at `position` if the part does not have one for the current input record yet.
+    std::map<size_t, size_t> current_record{};
+    auto writer_for = [&] (size_t const part) -> part_writer &
+    {
+        auto & writer = writers[part];
+        if (!writer)
+        {
+            // Parts are finished once the current position is behind them.
+            while (!writers.empty() && writers.begin()->first + 1u < part)
+            {
+                current_record.erase(writers.begin()->first);
+                writers.erase(writers.begin());
+            }
+
+            std::filesystem::path out_path = cfg.output_path;
+            out_path /= "bin_" + padded(part) + ".fasta";
+            writer = std::make_unique<part_writer>(out_path);
+        }
+
+        if (auto it = current_record.find(part); it == current_record.end() || it->second != record)
+        {
+            uint64_t const record_end = record_begin + lengths[record];
+            uint64_t const end = part + 1u == cfg.parts ? record_end :
+                                                          std::min(record_end, (part + 1u) * cfg.length + cfg.overlap);
+            writer->start_record("bin_" + padded(part) + "_[" + std::to_string(position) + ',' +
+                                 std::to_string(end) + ')');
+            current_record[part] = record;
+        }
+
+        return *writer;
+    };
+
+    auto on_bases = [&] (std::string_view bases)
+    {
+        while (!bases.empty())
+        {
+            size_t const part = std::min<uint64_t>(position / cfg.length, cfg.parts - 1u);
+            uint64_t const offset = position - part * cfg.length;
+            // The last part also contains the remainder.
+            size_t count = part + 1u == cfg.parts ? bases.size()
+                                                  : std::min<uint64_t>(bases.size(), cfg.length - offset);
+
+            // The first bases of a part are also the overlap of the previous part, if it covers the same record.
+            bool const overlaps = part > 0u && offset < cfg.overlap && record_begin < part * cfg.length;
+            if (overlaps)
+                count = std::min<uint64_t>(count, cfg.overlap - offset);
+
+            if (overlaps)
+                writer_for(part - 1u).append(bases.substr(0, count));
+            writer_for(part).append(bases.substr(0, count));
+
+            bases.remove_prefix(count);
+            position += count;
+        }
+    };
+
+    raptor::detail::chunked_sequence_reader reader{cfg.input_path};
+    reader.read([] (std::string_view) {},
+                on_bases,
+                [&] ()
+                {
+                    record_begin += lengths[record];
+                    position = record_begin;
+                    ++record;
+                });
 }
 
 int main(int argc, char ** argv)
@@ -89,6 +240,8 @@ int main(int argc, char ** argv)
     parser.info.author = "Enrico Seiler";
     parser.info.author = "enrico.seiler@fu-berlin.de";
     parser.info.short_description = "Split a fasta into parts.";
+    parser.info.description.emplace_back("All records are concatenated and split into parts of equal length. The "
+                                         "remainder is added to the last part.");
     parser.info.version = "0.0.1";
 
     config cfg{};
@@ -120,6 +273,14 @@ int main(int argc, char ** argv)
                       seqan3::option_spec::standard,
                       positive_integer_validator{});
 
+    parser.add_option(cfg.overlap,
+                      '\0',
+                      "overlap",
+                      "The number of bases each part extends into the next part. Use the window size minus one to "
+                      "keep all minimisers that span the border of two parts.",
+                      seqan3::option_spec::standard,
+                      positive_integer_validator{true});
+
     try
     {
         parser.parse();
@@ -135,28 +296,23 @@ int main(int argc, char ** argv)
         throw seqan3::validation_error{"Set --length or --parts"};
     }
 
-    // {
-    //     seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> input_sequence{cfg.input_path};
-    //     auto sequence_count = std::ranges::distance(input_sequence);
-    //     if (sequence_count == 0)
-    //         throw seqan3::validation_error{"Empty input sequence."};
-    //     if (sequence_count > 1)
-    //         throw seqan3::validation_error{"Only one sequence per input sequence allowed."};
-    // }
+    if (!raptor::detail::chunked_sequence_reader::is_supported(cfg.input_path))
+        throw seqan3::validation_error{"Only FASTA and FASTQ files are supported."};
+
+    std::vector<uint64_t> const lengths = record_lengths(cfg.input_path);
+    cfg.sequence_size = std::accumulate(lengths.begin(), lengths.end(), uint64_t{});
+
+    if (cfg.sequence_size == 0u)
+        throw seqan3::validation_error{"Empty input sequence."};
 
     if (!parser.is_option_set("length"))
-    {
-        seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> input_sequence{cfg.input_path};
-        cfg.sequence_size = std::ranges::distance((*input_sequence.begin()).sequence());
-        cfg.length = cfg.sequence_size / cfg.parts;
-    }
+        cfg.length = std::max<uint64_t>(1u, cfg.sequence_size / cfg.parts);
 
     if (!parser.is_option_set("parts"))
-    {
-        seqan3::sequence_file_input<dna4_traits, seqan3::fields<seqan3::field::seq>> input_sequence{cfg.input_path};
-        cfg.sequence_size = std::ranges::distance((*input_sequence.begin()).sequence());
-        cfg.parts = cfg.sequence_size / cfg.length;
-    }
+        cfg.parts = std::max<uint64_t>(1u, cfg.sequence_size / cfg.length);
+
+    if (cfg.overlap >= cfg.length)
+        throw seqan3::validation_error{"The overlap must be smaller than the length of one part."};
 
     if (!parser.is_option_set("output"))
     {
@@ -167,5 +323,5 @@ int main(int argc, char ** argv)
 
     seqan3::output_directory_validator{}(cfg.output_path);
 
-    split_sequence(cfg);
+    split_sequence(cfg, lengths);
 }
@@ -27,6 +27,12 @@ struct heuristic_threshold
     std::vector<uint64_t> coverage_begin;
     std::vector<uint64_t> coverage_end;
 
+    // Scratch space. Kept between reads to avoid allocations.
+    std::vector<uint64_t> unique_minimizer_begin;
+    std::vector<uint64_t> unique_minimizer_end;
+    std::vector<uint64_t> newBegin;
+    std::vector<uint64_t> newEnd;
+
     heuristic_threshold() = default;
     heuristic_threshold(heuristic_threshold const &) = default;
     heuristic_threshold & operator=(heuristic_threshold const &) = default;
@@ -38,15 +44,25 @@ struct heuristic_threshold
         minimizer_begin{mini.minimizer_begin}, minimizer_end{mini.minimizer_end}
     {}
 
+    //!\brief Prepares the computation for another read. The memory of the previous read is reused.
+    void reset(minimizer const & mini)
+    {
+        minimizer_begin.assign(mini.minimizer_begin.begin(), mini.minimizer_begin.end());
+        minimizer_end.assign(mini.minimizer_end.begin(), mini.minimizer_end.end());
+        coverage.clear();
+        coverage_begin.clear();
+        coverage_end.clear();
+    }
+
     inline void compute_coverage()
     {
         uint64_t begin_pos{1};
         uint64_t end_pos{0};
 
-        auto unique_minimizer_end = minimizer_end;
+        unique_minimizer_end.assign(minimizer_end.begin(), minimizer_end.end());
         unique_minimizer_end.erase(unique(unique_minimizer_end.begin(), unique_minimizer_end.end()), unique_minimizer_end.end());
 
-        auto unique_minimizer_begin = minimizer_begin;
+        unique_minimizer_begin.assign(minimizer_begin.begin(), minimizer_begin.end());
         unique_minimizer_begin.erase(unique(unique_minimizer_begin.begin(), unique_minimizer_begin.end()), unique_minimizer_begin.end());
 
         coverage_begin.push_back(unique_minimizer_begin[0]);
@@ -107,10 +123,8 @@ struct heuristic_threshold
                 else
                 {
                     destroyed += *max;
-                    std::vector<uint64_t> newBegin;
-                    std::vector<uint64_t> newEnd;
-                    newBegin.reserve(available - destroyed);
-                    newEnd.reserve(available - destroyed);
+                    newBegin.clear();
+                    newEnd.clear();
 
                     auto idx = std::distance(coverage.begin(), max);
                     auto cb = coverage_begin[idx];
@@ -124,8 +138,8 @@ struct heuristic_threshold
                         newBegin.push_back(mb);
                         newEnd.push_back(me);
                     }
-                    minimizer_begin = std::move(newBegin);
-                    minimizer_end = std::move(newEnd);
+                    std::swap(minimizer_begin, newBegin);
+                    std::swap(minimizer_end, newEnd);
                     coverage_begin.clear();
                     coverage_end.clear();
                     coverage.clear();
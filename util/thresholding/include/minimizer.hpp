@@ -12,7 +12,10 @@
 
 #pragma once
 
-#include <deque>
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <vector>
 
 #include <seqan3/alphabet/nucleotide/dna4.hpp>
 #include <seqan3/alphabet/views/complement.hpp>
@@ -92,192 +95,112 @@ public:
 
     void compute(text_t const & text)
     {
-        uint64_t text_length = std::ranges::size(text);
-
-        forward_hashes.clear();
-        reverse_hashes.clear();
         minimizer_hash.clear();
         minimizer_begin.clear();
         minimizer_end.clear();
 
-        // Return empty vector if text is shorter than k.
-        if (k > text_length)
-            return;
-
-        auto rc_text = text | seqan3::views::complement | std::views::reverse;
-        uint64_t possible_minimizers = text_length > w ? text_length - w + 1u : 1u;
-        uint64_t possible_kmers = text_length - k + 1;
-        assert(w >= k);
-        uint64_t kmers_per_window = w - k + 1u;
-
+        compute_window_minima(text);
 
-        // Helper lambda for xor'ing values depending on `do_xor`.
-        auto apply_xor = [this] (uint64_t const val)
+        // Only report a minimizer if its position changes.
+        for (size_t i = 0; i < window_minima.size(); ++i)
         {
-            return val ^ seed;
-        };
-
-        // Compute all k-mer hashes for both forward and reverse strand.
-        forward_hashes = text |
-                         seqan3::views::kmer_hash(seqan3::ungapped{k}) |
-                         std::views::transform(apply_xor) |
-                         seqan3::views::to<std::vector<uint64_t>>;
-
-        reverse_hashes = rc_text |
-                         seqan3::views::kmer_hash(seqan3::ungapped{k}) |
-                         std::views::transform(apply_xor) |
-                         seqan3::views::to<std::vector<uint64_t>>;
-
-        // Choose the minimizers.
-        minimizer_hash.reserve(possible_minimizers);
-        minimizer_begin.reserve(possible_minimizers);
-        minimizer_end.reserve(possible_minimizers);
-
-        // Stores hash, begin and end for all k-mers in the window
-        std::deque<std::tuple<uint64_t, uint64_t, uint64_t>> window_values;
-
-        // Initialisation. We need to compute all hashes for the first window.
-        for (uint64_t i = 0; i < kmers_per_window; ++i)
-        {
-            // Get smallest canonical k-mer.
-            uint64_t forward_hash = forward_hashes[i];
-            uint64_t reverse_hash = reverse_hashes[possible_kmers - i - 1];
-            window_values.emplace_back(std::min(forward_hash, reverse_hash), i, i + k - 1);
-        }
-
-        auto min = std::min_element(std::begin(window_values), std::end(window_values));
-        minimizer_hash.push_back(std::get<0>(*min));
-        minimizer_begin.push_back(std::get<1>(*min));
-        minimizer_end.push_back(std::get<2>(*min));
-
-
-        // For the following windows, we remove the first window k-mer (is now not in window) and add the new k-mer
-        // that results from the window shifting
-        bool minimizer_changed{false};
-        for (uint64_t i = 1; i < possible_minimizers; ++i)
-        {
-            // Shift the window.
-            // If current minimizer leaves the window, we need to decide on a new one.
-            if (min == std::begin(window_values))
+            uint64_t const position = window_minima[i];
+            if (i == 0 || position != window_minima[i - 1])
             {
-                window_values.pop_front();
-                min = std::min_element(std::begin(window_values), std::end(window_values));
-                minimizer_changed = true;
-            }
-            else
-            {
-                window_values.pop_front();
-            }
-
-            uint64_t forward_hash = forward_hashes[kmers_per_window - 1 + i];
-            uint64_t reverse_hash = reverse_hashes[possible_kmers - kmers_per_window - i];
-            window_values.emplace_back(std::min(forward_hash, reverse_hash),
-                                       kmers_per_window + i - 1,
-                                       kmers_per_window + i + k - 2);
-
-            if (std::get<0>(window_values.back()) < std::get<0>(*min))
-            {
-                min = std::prev(std::end(window_values));
-                minimizer_changed = true;
-            }
-
-            if (minimizer_changed)
-            {
-                minimizer_hash.push_back(std::get<0>(*min));
-                minimizer_begin.push_back(std::get<1>(*min));
-                minimizer_end.push_back(std::get<2>(*min));
-                minimizer_changed = false;
+                minimizer_hash.push_back(canonical_hashes[position]);
+                minimizer_begin.push_back(position);
+                minimizer_end.push_back(position + k - 1);
             }
         }
-        return;
     }
 
     void compute_multi(text_t const & text)
     {
-        uint64_t text_length = std::ranges::size(text);
-
-        forward_hashes.clear();
-        reverse_hashes.clear();
         minimizer_hash.clear();
         minimizer_begin.clear();
         minimizer_end.clear();
 
+        compute_window_minima(text);
+
+        minimizer_hash.reserve(window_minima.size());
+        for (uint64_t const position : window_minima)
+            minimizer_hash.push_back(canonical_hashes[position]);
+    }
+
+private:
+    //!\brief Stores the smaller of the forward and reverse complement hash of each k-mer.
+    std::vector<uint64_t> canonical_hashes;
+    //!\brief Scratch space for the sliding window minimum.
+    std::vector<uint64_t> prefix_minima;
+    //!\brief Scratch space for the sliding window minimum.
+    std::vector<uint64_t> suffix_minima;
+    //!\brief Stores the position of the minimizer of each window.
+    std::vector<uint64_t> window_minima;
+
+    /*!\brief Computes the position of the leftmost smallest canonical k-mer hash of each window.
+     * \details
+     * Uses the van Herk/Gil-Werman algorithm: The k-mers are split into blocks of `kmers_per_window` many k-mers.
+     * Each window spans the suffix of one block and the prefix of the next one, hence its minimum is the smaller of
+     * a precomputed suffix minimum and a precomputed prefix minimum. This needs three comparisons per k-mer,
+     * independent of the window size, and no data dependent branches.
+     * The scratch vectors are kept between calls, hence no memory is allocated once they are large enough.
+     */
+    void compute_window_minima(text_t const & text)
+    {
+        uint64_t const text_length = std::ranges::size(text);
+
+        window_minima.clear();
+
         // Return empty vector if text is shorter than k.
         if (k > text_length)
             return;
 
-        auto rc_text = text | seqan3::views::complement | std::views::reverse;
-        uint64_t possible_minimizers = text_length > w ? text_length - w + 1u : 1u;
-        uint64_t possible_kmers = text_length - k + 1;
         assert(w >= k);
-        uint64_t kmers_per_window = w - k + 1u;
+        uint64_t const possible_kmers = text_length - k + 1;
+        uint64_t const kmers_per_window = std::min<uint64_t>(w - k + 1u, possible_kmers);
+        uint64_t const possible_minimizers = possible_kmers - kmers_per_window + 1u;
 
-
-        // Helper lambda for xor'ing values depending on `do_xor`.
         auto apply_xor = [this] (uint64_t const val)
         {
             return val ^ seed;
         };
 
-        // Compute all k-mer hashes for both forward and reverse strand.
-        forward_hashes = text |
-                         seqan3::views::kmer_hash(seqan3::ungapped{k}) |
-                         std::views::transform(apply_xor) |
-                         seqan3::views::to<std::vector<uint64_t>>;
-
-        reverse_hashes = rc_text |
-                         seqan3::views::kmer_hash(seqan3::ungapped{k}) |
-                         std::views::transform(apply_xor) |
-                         seqan3::views::to<std::vector<uint64_t>>;
-
-        // Choose the minimizers.
-        minimizer_hash.reserve(possible_minimizers);
-
-        // Stores hash, begin and end for all k-mers in the window
-        std::deque<std::tuple<uint64_t, uint64_t, uint64_t>> window_values;
-
-        // Initialisation. We need to compute all hashes for the first window.
-        for (uint64_t i = 0; i < kmers_per_window; ++i)
+        forward_hashes.clear();
+        reverse_hashes.clear();
+        std::ranges::copy(text | seqan3::views::kmer_hash(seqan3::ungapped{k}) | std::views::transform(apply_xor),
+                          std::back_inserter(forward_hashes));
+        std::ranges::copy(text | seqan3::views::complement | std::views::reverse
+                               | seqan3::views::kmer_hash(seqan3::ungapped{k}) | std::views::transform(apply_xor),
+                          std::back_inserter(reverse_hashes));
+
+        canonical_hashes.resize(possible_kmers);
+        for (uint64_t i = 0; i < possible_kmers; ++i)
+            canonical_hashes[i] = std::min(forward_hashes[i], reverse_hashes[possible_kmers - i - 1]);
+
+        // Prefers the left position if both hashes are equal.
+        auto smaller = [this] (uint64_t const left, uint64_t const right)
         {
-            // Get smallest canonical k-mer.
-            uint64_t forward_hash = forward_hashes[i];
-            uint64_t reverse_hash = reverse_hashes[possible_kmers - i - 1];
-            window_values.emplace_back(std::min(forward_hash, reverse_hash), i, i + k - 1);
-        }
+            return canonical_hashes[right] < canonical_hashes[left] ? right : left;
+        };
 
-        auto min = std::min_element(std::begin(window_values), std::end(window_values));
-        minimizer_hash.push_back(std::get<0>(*min));
+        prefix_minima.resize(possible_kmers);
+        suffix_minima.resize(possible_kmers);
 
-        // For the following windows, we remove the first window k-mer (is now not in window) and add the new k-mer
-        // that results from the window shifting
-        for (uint64_t i = 1; i < possible_minimizers; ++i)
+        for (uint64_t block_begin = 0; block_begin < possible_kmers; block_begin += kmers_per_window)
         {
-            // Shift the window.
-            // If current minimizer leaves the window, we need to decide on a new one.
-            if (min == std::begin(window_values))
-            {
-                window_values.pop_front();
-                min = std::min_element(std::begin(window_values), std::end(window_values));
-            }
-            else
-            {
-                window_values.pop_front();
-            }
+            uint64_t const block_end = std::min(block_begin + kmers_per_window, possible_kmers);
 
-            uint64_t forward_hash = forward_hashes[kmers_per_window - 1 + i];
-            uint64_t reverse_hash = reverse_hashes[possible_kmers - kmers_per_window - i];
-            window_values.emplace_back(std::min(forward_hash, reverse_hash),
-                                       kmers_per_window + i - 1,
-                                       kmers_per_window + i + k - 2);
+            prefix_minima[block_begin] = block_begin;
+            for (uint64_t i = block_begin + 1; i < block_end; ++i)
+                prefix_minima[i] = smaller(prefix_minima[i - 1], i);
 
-            if (std::get<0>(window_values.back()) < std::get<0>(*min))
-            {
-                min = std::prev(std::end(window_values));
-            }
-
-            minimizer_hash.push_back(std::get<0>(*min));
+            suffix_minima[block_end - 1] = block_end - 1;
+            for (uint64_t i = block_end - 1; i > block_begin; --i)
+                suffix_minima[i - 1] = smaller(i - 1, suffix_minima[i]);
         }
-        return;
-    }
 
+        window_minima.resize(possible_minimizers);
+        for (uint64_t i = 0; i < possible_minimizers; ++i)
+            window_minima[i] = smaller(suffix_minima[i], prefix_minima[i + kmers_per_window - 1]);
+    }
 };
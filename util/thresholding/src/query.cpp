@@ -10,9 +10,11 @@
  * \brief Provides stuff.
  */
 
+#include <atomic>
 #include <chrono>
 #include <seqan3/std/filesystem>
 #include <numeric>
+#include <thread>
 #include <unordered_set>
 #include <set>
 
@@ -21,6 +23,7 @@
 #include <seqan3/core/debug_stream.hpp>
 #include <seqan3/io/sequence_file/input.hpp>
 #include <seqan3/io/views/async_input_buffer.hpp>
+#include <seqan3/utility/views/chunk.hpp>
 
 #include <cereal/types/vector.hpp>
 
@@ -45,6 +48,13 @@ struct cmd_arguments
     double tau{0.99};
     bool from_file{};
     std::vector<std::string> method{};
+    uint64_t threads{1u};
+
+    // All values given on the command line. Every combination is evaluated in a single pass over the queries.
+    std::vector<uint64_t> window_sizes{};
+    std::vector<uint8_t> kmer_sizes{};
+    std::vector<uint8_t> error_counts{};
+    std::vector<double> taus{};
 };
 
 struct threshold_result
@@ -154,139 +164,387 @@ void write_results(cmd_arguments const & args,
     out << result.threshold_time.count() << '\n';
 }
 
-void compute_heuristic_threshold(cmd_arguments const & args)
+//!\brief Calls `worker(thread_id)` on `threads` many threads.
+template <typename worker_t>
+void run_parallel(size_t const threads, worker_t && worker)
 {
-    minimizer mini{window{args.window_size}, kmer{args.kmer_size}};
-    std::unordered_set<uint64_t> reference_hashes = hash_reference(mini, args.reference_file);
-    threshold_result result;
-    result.method = "heuristic";
-    std::vector<uint64_t> threshold_per_count(args.pattern_size, 0);
+    std::vector<std::thread> pool{};
+    for (size_t thread_id = 0; thread_id < threads; ++thread_id)
+        pool.emplace_back(worker, thread_id);
+    for (auto && thread : pool)
+        thread.join();
+}
 
-    // Process the queries.
-    seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> query_in{args.query_file};
-    for (auto & [seq] : query_in | seqan3::views::async_input_buffer(16))
+//!\brief Calls `worker(i)` for all `i` in `[0, count)`, distributed dynamically over the threads.
+template <typename worker_t>
+void parallel_for(size_t const count, size_t const threads, worker_t && worker)
+{
+    std::atomic<size_t> next{};
+    run_parallel(std::min(count, threads), [&] (size_t)
     {
-        size_t minimizer_count = 0;
+        for (size_t i = next++; i < count; i = next++)
+            worker(i);
+    });
+}
 
-        for (auto && hash : mini.hashes(seq))
-            minimizer_count += reference_hashes.count(hash);
+enum class method_kind
+{
+    heuristic,
+    lemma,
+    model
+};
 
-        uint64_t count = mini.minimizer_hash.size();
+//!\brief One method evaluated for one combination of window size, k-mer size, errors and tau.
+struct evaluation
+{
+    cmd_arguments args{};
+    method_kind kind{};
+    bool indirect{};
+    bool overlapping{};
+    //!\brief The heuristic and the lemma do not depend on tau; their results are written once for each tau.
+    std::vector<double> taus{};
+
+    threshold_result result{};
+    std::vector<size_t> precomp_thresholds{};
+    size_t minimal_number_of_minimizers{};
+    size_t maximal_number_of_minimizers{};
+
+    //!\brief The number of minimizers of each read.
+    std::vector<uint64_t> count_per_read{};
+    //!\brief Accumulated per thread.
+    std::vector<size_t> hits{};
+    //!\brief Accumulated per thread.
+    std::vector<std::chrono::duration<double, std::milli>> threshold_time{};
+
+    void precompute()
+    {
+        if (kind != method_kind::model)
+            return;
+
+        size_t const kmers_per_window = args.window_size - args.kmer_size + 1;
+        size_t const kmers_per_pattern = args.pattern_size - args.kmer_size + 1;
+        minimal_number_of_minimizers = kmers_per_window == 1 ? kmers_per_pattern :
+                                                               kmers_per_pattern / (kmers_per_window - 1);
+        maximal_number_of_minimizers = args.pattern_size - args.window_size + 1;
 
         auto start = std::chrono::high_resolution_clock::now();
-        heuristic_threshold heuristic(mini);
-        auto threshold = heuristic.threshold(args.errors);
+
+        if (args.from_file)
+        {
+            do_cerealisation_in(precomp_thresholds, args, result);
+        }
+        else
+        {
+            precomp_thresholds = precompute_threshold(args.pattern_size,
+                                                      args.window_size,
+                                                      args.kmer_size,
+                                                      args.errors,
+                                                      args.tau,
+                                                      indirect,
+                                                      overlapping);
+        }
+
         auto end = std::chrono::high_resolution_clock::now();
-        threshold_per_count[count] = threshold;
-        result.threshold_time += end - start;
-        result.threshold_per_read.push_back(threshold);
-        result.number_of_hits += (threshold <= minimizer_count);
+        result.precompute_time += end - start;
+        if (!args.from_file)
+            do_cerealisation_out(precomp_thresholds, args, result);
     }
 
-    print_results(result);
-    write_results(args, result);
-    seqan3::debug_stream << threshold_per_count << '\n';
-    seqan3::debug_stream << '\n';
-}
+    //!\brief Computes the threshold for the current read of `current`.
+    template <typename scratch_t>
+    size_t threshold(scratch_t & current, size_t const thread_id)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        size_t threshold{};
+
+        switch (kind)
+        {
+            case method_kind::heuristic:
+            {
+                current.heuristic.reset(current.mini);
+                threshold = current.heuristic.threshold(args.errors);
+                break;
+            }
+            case method_kind::lemma:
+            {
+                lemma_threshold lemma{};
+                threshold = lemma.threshold(args.pattern_size, args.window_size, args.errors);
+                break;
+            }
+            case method_kind::model:
+            {
+                size_t const count = current.mini.minimizer_hash.size();
+                size_t index = std::min(count < minimal_number_of_minimizers ? 0 : count - minimal_number_of_minimizers,
+                                        maximal_number_of_minimizers - minimal_number_of_minimizers);
+                threshold = precomp_thresholds[index];
+                break;
+            }
+        }
+
+        auto end = std::chrono::high_resolution_clock::now();
+        threshold_time[thread_id] += end - start;
+        return threshold;
+    }
 
-void compute_lemma_threshold(cmd_arguments const & args)
+    void finish()
+    {
+        for (size_t const thread_hits : hits)
+            result.number_of_hits += thread_hits;
+        for (auto const & thread_time : threshold_time)
+            result.threshold_time += thread_time;
+
+        seqan3::debug_stream << result.method
+                             << " (w=" << args.window_size
+                             << ", k=" << static_cast<size_t>(args.kmer_size)
+                             << ", e=" << static_cast<size_t>(args.errors);
+        if (kind == method_kind::model)
+            seqan3::debug_stream << ", tau=" << args.tau;
+        seqan3::debug_stream << ")\n";
+
+        print_results(result);
+
+        for (double const tau : taus)
+        {
+            cmd_arguments tau_args{args};
+            tau_args.tau = tau;
+            write_results(tau_args, result);
+        }
+
+        if (kind != method_kind::lemma)
+        {
+            // As before, the entry for a count is the threshold of the last read with this count.
+            std::vector<uint64_t> threshold_per_count(args.pattern_size, 0);
+            for (size_t i = 0; i < count_per_read.size(); ++i)
+                if (count_per_read[i] < threshold_per_count.size())
+                    threshold_per_count[count_per_read[i]] = result.threshold_per_read[i];
+
+            seqan3::debug_stream << threshold_per_count << '\n';
+            seqan3::debug_stream << '\n';
+        }
+    }
+};
+
+//!\brief All evaluations that use the same window and k-mer size, and hence the same minimizers.
+struct parameter_group
 {
-    minimizer mini{window{args.window_size}, kmer{args.kmer_size}};
-    std::unordered_set<uint64_t> reference_hashes = hash_reference(mini, args.reference_file);
-    threshold_result result;
-    result.method = "lemma";
+    uint64_t window_size{};
+    uint8_t kmer_size{};
+    std::unordered_set<uint64_t> reference_hashes{};
+    //!\brief The lemma needs the minimizers of all windows, which are computed after the other methods.
+    std::vector<evaluation> evaluations{};
+    std::vector<evaluation> lemma_evaluations{};
+};
 
-    // Process the queries.
-    seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> query_in{args.query_file};
-    for (auto & [seq] : query_in | seqan3::views::async_input_buffer(16))
+//!\brief Per-thread objects that are reused for every read.
+struct scratch
+{
+    minimizer mini{};
+    heuristic_threshold heuristic{};
+};
+
+std::vector<parameter_group> make_groups(cmd_arguments const & args)
+{
+    bool const all = std::ranges::find(args.method, "all") != args.method.end();
+    auto selected = [&] (std::string const & name)
     {
-        size_t minimizer_count = 0;
+        return all || std::ranges::find(args.method, name) != args.method.end();
+    };
 
-        for (auto && hash : mini.hashes_multi(seq))
-            minimizer_count += reference_hashes.count(hash);
+    std::vector<parameter_group> groups{};
 
-        auto start = std::chrono::high_resolution_clock::now();
-        lemma_threshold lemma{};
-        auto threshold = lemma.threshold(args.pattern_size, args.window_size, args.errors);
-        auto end = std::chrono::high_resolution_clock::now();
-        result.threshold_time += end - start;
-        result.threshold_per_read.push_back(threshold);
-        result.number_of_hits += (threshold <= minimizer_count);
+    for (uint64_t const window_size : args.window_sizes)
+    {
+        for (uint8_t const kmer_size : args.kmer_sizes)
+        {
+            if (kmer_size > window_size)
+            {
+                seqan3::debug_stream << "[WARNING] Skipping w=" << window_size
+                                     << ", k=" << static_cast<size_t>(kmer_size)
+                                     << " because k is larger than w.\n";
+                continue;
+            }
+
+            parameter_group & group = groups.emplace_back();
+            group.window_size = window_size;
+            group.kmer_size = kmer_size;
+
+            for (uint8_t const errors : args.error_counts)
+            {
+                evaluation base{};
+                base.args = args;
+                base.args.window_size = window_size;
+                base.args.kmer_size = kmer_size;
+                base.args.errors = errors;
+                base.args.tau = args.taus.front();
+                base.taus = args.taus;
+
+                if (selected("heuristic"))
+                {
+                    evaluation & current = group.evaluations.emplace_back(base);
+                    current.kind = method_kind::heuristic;
+                    current.result.method = "heuristic";
+                }
+                if (selected("lemma"))
+                {
+                    evaluation & current = group.lemma_evaluations.emplace_back(base);
+                    current.kind = method_kind::lemma;
+                    current.result.method = "lemma";
+                }
+
+                for (double const tau : args.taus)
+                {
+                    auto add_model = [&] (bool const indirect, bool const overlapping, std::string method)
+                    {
+                        evaluation & current = group.evaluations.emplace_back(base);
+                        current.kind = method_kind::model;
+                        current.indirect = indirect;
+                        current.overlapping = overlapping;
+                        current.args.tau = tau;
+                        current.taus = {tau};
+                        current.result.method = std::move(method);
+                    };
+
+                    if (selected("simple"))
+                        add_model(false, false, "simple");
+                    if (selected("indirect"))
+                        add_model(true, false, "indirect");
+                    if (selected("overlap"))
+                        add_model(false, true, "overlapping");
+                    if (selected("indirect-overlap"))
+                        add_model(true, true, "indirect_overlapping");
+                }
+            }
+
+            for (auto & current : group.evaluations)
+            {
+                current.hits.assign(args.threads, 0u);
+                current.threshold_time.assign(args.threads, std::chrono::duration<double, std::milli>{0.0});
+            }
+            for (auto & current : group.lemma_evaluations)
+            {
+                current.hits.assign(args.threads, 0u);
+                current.threshold_time.assign(args.threads, std::chrono::duration<double, std::milli>{0.0});
+            }
+        }
     }
 
-    print_results(result);
-    write_results(args, result);
+    return groups;
 }
 
-void compute_simple_model(cmd_arguments const & args,
-                          bool const indirect,
-                          bool const overlapping)
+/*!\brief Evaluates all selected methods for all parameter combinations in a single pass over the queries.
+ * \details
+ * The reference is hashed once per window and k-mer size, and the precomputation of the models runs in parallel.
+ * The queries are read in batches. The reads of a batch are distributed over the threads; each thread computes the
+ * minimizers of a read once per window and k-mer size and evaluates all methods on them.
+ */
+void evaluate(cmd_arguments const & args)
 {
-    minimizer mini{window{args.window_size}, kmer{args.kmer_size}};
-    std::unordered_set<uint64_t> reference_hashes = hash_reference(mini, args.reference_file);
-    threshold_result result;
-    result.method = (indirect && overlapping ? "indirect_overlapping" :
-                    (indirect ? "indirect" :
-                    (overlapping ? "overlapping" :
-                    "simple")));
-
-    std::vector<uint64_t> threshold_per_count(args.pattern_size, 0);
-    size_t kmers_per_window = args.window_size - args.kmer_size + 1;
-    size_t kmers_per_pattern = args.pattern_size - args.kmer_size + 1;
-    size_t minimal_number_of_minimizers = kmers_per_window == 1 ? kmers_per_pattern :
-                                                                  kmers_per_pattern / (kmers_per_window - 1);
-    size_t maximal_number_of_minimizers = args.pattern_size - args.window_size + 1;
-
-    std::vector<size_t> precomp_thresholds;
-    auto start2 = std::chrono::high_resolution_clock::now();
-
-    if (args.from_file)
+    std::vector<parameter_group> groups = make_groups(args);
+
+    parallel_for(groups.size(), args.threads, [&] (size_t const i)
     {
-        do_cerealisation_in(precomp_thresholds, args, result);
-    }
-    else
+        minimizer mini{window{groups[i].window_size}, kmer{groups[i].kmer_size}};
+        groups[i].reference_hashes = hash_reference(mini, args.reference_file);
+    });
+
+    std::vector<evaluation *> models{};
+    for (auto & group : groups)
+        for (auto & current : group.evaluations)
+            if (current.kind == method_kind::model)
+                models.push_back(&current);
+
+    parallel_for(models.size(), args.threads, [&] (size_t const i)
     {
-        precomp_thresholds = precompute_threshold(args.pattern_size,
-                                                  args.window_size,
-                                                  args.kmer_size,
-                                                  args.errors,
-                                                  args.tau,
-                                                  indirect,
-                                                  overlapping);
-    }
+        models[i]->precompute();
+    });
+
+    std::vector<std::vector<scratch>> scratches(groups.size(), std::vector<scratch>(args.threads));
+    for (size_t i = 0; i < groups.size(); ++i)
+        for (auto & current : scratches[i])
+            current.mini.resize(window{groups[i].window_size}, kmer{groups[i].kmer_size});
 
-    auto end2 = std::chrono::high_resolution_clock::now();
-    result.precompute_time += end2 - start2;
-    if (!args.from_file)
-        do_cerealisation_out(precomp_thresholds, args, result);
+    std::vector<seqan3::dna4_vector> reads{};
+    size_t processed_reads{};
 
-    // Process the queries.
     seqan3::sequence_file_input<my_traits, seqan3::fields<seqan3::field::seq>> query_in{args.query_file};
-    for (auto & [seq] : query_in | seqan3::views::async_input_buffer(16))
+    for (auto && batch : query_in | seqan3::views::chunk(1ULL << 16))
     {
-        size_t minimizer_count = 0;
+        reads.clear();
+        for (auto && [seq] : batch)
+            reads.push_back(std::move(seq));
 
-        for (auto && hash : mini.hashes(seq))
-            minimizer_count += reference_hashes.count(hash);
-
-        uint64_t count = mini.minimizer_hash.size();
+        size_t const total_reads = processed_reads + reads.size();
+        for (auto & group : groups)
+        {
+            for (auto * evaluations : {&group.evaluations, &group.lemma_evaluations})
+            {
+                for (auto & current : *evaluations)
+                {
+                    current.result.threshold_per_read.resize(total_reads);
+                    current.count_per_read.resize(total_reads);
+                }
+            }
+        }
 
-        auto start = std::chrono::high_resolution_clock::now();
-        size_t index = std::min(mini.minimizer_hash.size() < minimal_number_of_minimizers ? 0 :
-                                    mini.minimizer_hash.size() - minimal_number_of_minimizers,
-                                maximal_number_of_minimizers - minimal_number_of_minimizers);
-        auto threshold = precomp_thresholds[index];
-        auto end = std::chrono::high_resolution_clock::now();
-        threshold_per_count[count] = threshold;
-        result.threshold_time += end - start;
-        result.threshold_per_read.push_back(threshold);
-        result.number_of_hits += (threshold <= minimizer_count);
+        run_parallel(args.threads, [&] (size_t const thread_id)
+        {
+            size_t const begin = reads.size() * thread_id / args.threads;
+            size_t const end = reads.size() * (thread_id + 1) / args.threads;
+
+            for (size_t read = begin; read < end; ++read)
+            {
+                size_t const read_number = processed_reads + read;
+
+                for (size_t i = 0; i < groups.size(); ++i)
+                {
+                    parameter_group & group = groups[i];
+                    scratch & current = scratches[i][thread_id];
+
+                    auto record = [&] (evaluation & eval, size_t const minimizer_count)
+                    {
+                        size_t const threshold = eval.threshold(current, thread_id);
+                        eval.result.threshold_per_read[read_number] = threshold;
+                        eval.count_per_read[read_number] = current.mini.minimizer_hash.size();
+                        eval.hits[thread_id] += (threshold <= minimizer_count);
+                    };
+
+                    auto count_hits = [&] ()
+                    {
+                        size_t minimizer_count{};
+                        for (uint64_t const hash : current.mini.minimizer_hash)
+                            minimizer_count += group.reference_hashes.count(hash);
+                        return minimizer_count;
+                    };
+
+                    if (!group.evaluations.empty())
+                    {
+                        current.mini.compute(reads[read]);
+                        size_t const minimizer_count = count_hits();
+                        for (auto & eval : group.evaluations)
+                            record(eval, minimizer_count);
+                    }
+
+                    if (!group.lemma_evaluations.empty())
+                    {
+                        current.mini.compute_multi(reads[read]);
+                        size_t const minimizer_count = count_hits();
+                        for (auto & eval : group.lemma_evaluations)
+                            record(eval, minimizer_count);
+                    }
+                }
+            }
+        });
+
+        processed_reads = total_reads;
     }
 
-    print_results(result);
-    write_results(args, result);
-    seqan3::debug_stream << threshold_per_count << '\n';
-    seqan3::debug_stream << '\n';
+    for (auto & group : groups)
+    {
+        for (auto & current : group.evaluations)
+            current.finish();
+        for (auto & current : group.lemma_evaluations)
+            current.finish();
+    }
 }
 
 void initialize_argument_parser(seqan3::argument_parser & parser, cmd_arguments & args)
@@ -301,14 +559,15 @@ void initialize_argument_parser(seqan3::argument_parser & parser, cmd_arguments
                       seqan3::input_file_validator<seqan3::sequence_file_input<>>{});
     parser.add_option(args.output_directory, 'o', "out", "", seqan3::option_spec::required,
                       seqan3::output_directory_validator{});
-    parser.add_option(args.window_size, 'w', "window", "Choose the window size.", seqan3::option_spec::standard,
+    parser.add_option(args.window_sizes, 'w', "window", "Choose the window size. Can be given multiple times to sweep "
+                      "over several values. Default: 26.", seqan3::option_spec::standard,
                       seqan3::arithmetic_range_validator{1, 1000});
-    parser.add_option(args.kmer_size, 'k', "kmer", "Choose the kmer size.", seqan3::option_spec::standard,
-                      seqan3::arithmetic_range_validator{1, 32});
-    parser.add_option(args.errors, 'e', "error", "Choose the number of errors.", seqan3::option_spec::standard,
-                      seqan3::arithmetic_range_validator{0, 5});
-    parser.add_option(args.tau, 't', "tau", "Threshold for probabilistic models.", seqan3::option_spec::standard,
-                      seqan3::arithmetic_range_validator{0, 1});
+    parser.add_option(args.kmer_sizes, 'k', "kmer", "Choose the kmer size. Can be given multiple times. Default: 20.",
+                      seqan3::option_spec::standard, seqan3::arithmetic_range_validator{1, 32});
+    parser.add_option(args.error_counts, 'e', "error", "Choose the number of errors. Can be given multiple times. "
+                      "Default: 3.", seqan3::option_spec::standard, seqan3::arithmetic_range_validator{0, 5});
+    parser.add_option(args.taus, 't', "tau", "Threshold for probabilistic models. Can be given multiple times. "
+                      "Default: 0.99.", seqan3::option_spec::standard, seqan3::arithmetic_range_validator{0, 1});
     parser.add_option(args.pattern_size, 'p', "pattern", "Choose the pattern size. Only needed for methods other than "
                       "heuristic or lemma. Default: Use median of sequence lengths in query file.");
     parser.add_option(args.method, 'm', "method", "Choose the methods to compute the trheshold.",
@@ -316,6 +575,8 @@ void initialize_argument_parser(seqan3::argument_parser & parser, cmd_arguments
                       "indirect", "overlap", "indirect-overlap", "all"});
     parser.add_flag(args.from_file, 'f', "from_file", "Load precomputed threshold from disk. Program must have "
                       "been run without this flag before.");
+    parser.add_option(args.threads, '\0', "threads", "Choose the number of threads.", seqan3::option_spec::standard,
+                      seqan3::arithmetic_range_validator{1, 1024});
 }
 
 int main(int argc, char ** argv)
@@ -347,44 +608,16 @@ int main(int argc, char ** argv)
         args.pattern_size = sequence_lengths[sequence_lengths.size()/2];
     }
 
-    bool all = std::find(args.method.begin(), args.method.end(), "all") != args.method.end();
-    bool heuristic = std::find(args.method.begin(), args.method.end(), "heuristic") != args.method.end();
-    bool lemma = std::find(args.method.begin(), args.method.end(), "lemma") != args.method.end();
-    bool simple = std::find(args.method.begin(), args.method.end(), "simple") != args.method.end();
-    bool indirect = std::find(args.method.begin(), args.method.end(), "indirect") != args.method.end();
-    bool overlap = std::find(args.method.begin(), args.method.end(), "overlap") != args.method.end();
-    bool indirect_overlap = std::find(args.method.begin(), args.method.end(), "indirect-overlap") != args.method.end();
+    if (args.window_sizes.empty())
+        args.window_sizes.push_back(args.window_size);
+    if (args.kmer_sizes.empty())
+        args.kmer_sizes.push_back(args.kmer_size);
+    if (args.error_counts.empty())
+        args.error_counts.push_back(args.errors);
+    if (args.taus.empty())
+        args.taus.push_back(args.tau);
 
-    if (all || heuristic)
-    {
-        seqan3::debug_stream << "Heuristic\n";
-        compute_heuristic_threshold(args);
-    }
-    if (all || lemma)
-    {
-        seqan3::debug_stream << "Lemma\n";
-        compute_lemma_threshold(args);
-    }
-    if (all || simple)
-    {
-        seqan3::debug_stream << "Model\n";
-        compute_simple_model(args, false, false);
-    }
-    if (all || indirect)
-    {
-        seqan3::debug_stream << "Model with indirect\n";
-        compute_simple_model(args, true, false);
-    }
-    if (all || overlap)
-    {
-        seqan3::debug_stream << "Model with overlapping\n";
-        compute_simple_model(args, false, true);
-    }
-    if (all || indirect_overlap)
-    {
-        seqan3::debug_stream << "Model with indirect and overlapping\n";
-        compute_simple_model(args, true, true);
-    }
+    evaluate(args);
 
     return 0;
 }